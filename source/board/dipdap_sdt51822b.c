@@ -20,10 +20,12 @@
  */
  
 #include "flash_manager.h"
+#include "flash_decoder.h"
 
 const char *board_id = "3103";
 
 void prerun_board_config(void)
 {
     flash_manager_set_page_erase(true);
+    flash_decoder_set_sector_erase(true);
 }
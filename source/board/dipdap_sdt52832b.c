@@ -21,6 +21,7 @@
 
 #include "target_config.h"
 #include "flash_manager.h"
+#include "flash_decoder.h"
 
 const char *board_id = "3104";
 
@@ -30,4 +31,5 @@ void prerun_board_config(void)
     target_device = target_device_nrf52;
 
     flash_manager_set_page_erase(true);
+    flash_decoder_set_sector_erase(true);
 }
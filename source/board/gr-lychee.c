@@ -21,6 +21,7 @@
 #include "stdbool.h"
 #include "virtual_fs.h"
 #include "flash_manager.h"
+#include "flash_decoder.h"
 
 const char *board_id = "5501";
 
@@ -35,4 +36,5 @@ const vfs_filename_t daplink_drive_name =     "MBED       ";
 void prerun_board_config(void)
 {
     flash_manager_set_page_erase(true);
+    flash_decoder_set_sector_erase(true);
 }
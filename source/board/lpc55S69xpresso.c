@@ -21,6 +21,7 @@
 
 #include "virtual_fs.h"
 #include "flash_manager.h"
+#include "flash_decoder.h"
 
 const char *board_id = "0236";
 
@@ -39,5 +40,6 @@ const char *const daplink_target_url = "https://os.mbed.com/platforms/LPCXpresso
 void prerun_board_config(void)
 {
     flash_manager_set_page_erase(true);
+    flash_decoder_set_sector_erase(true);
 }
 
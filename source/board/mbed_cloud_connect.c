@@ -19,10 +19,12 @@
  * limitations under the License.
  */
 #include "flash_manager.h"
+#include "flash_decoder.h"
 
 const char *board_id = "2410";
 
 void prerun_board_config(void)
 {
     flash_manager_set_page_erase(true);
+    flash_decoder_set_sector_erase(true);
 }
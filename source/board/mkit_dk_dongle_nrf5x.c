@@ -23,6 +23,7 @@
 #include "target_config.h"
 #include "util.h"
 #include "flash_manager.h"
+#include "flash_decoder.h"
 
 const char *board_id = "";
 
@@ -115,4 +116,5 @@ void prerun_board_config(void)
     PIOB->PIO_PUDR = (1 << 3); // Disable pull-up
 
     flash_manager_set_page_erase(true);
+    flash_decoder_set_sector_erase(true);
 }
@@ -22,10 +22,12 @@
 #include "target_config.h"
 #include "stdbool.h"
 #include "flash_manager.h"
+#include "flash_decoder.h"
 
 const char *board_id = "0457";
 
 void prerun_board_config(void)
 {
     flash_manager_set_page_erase(true);
+    flash_decoder_set_sector_erase(true);
 }
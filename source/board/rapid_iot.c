@@ -21,6 +21,7 @@
 #include "virtual_fs.h"
 #include "stdbool.h"
 #include "flash_manager.h"
+#include "flash_decoder.h"
 
 const char *board_id = "0228";
 // Override default behavior
@@ -36,4 +37,5 @@ const char *const daplink_target_url = "http://www.nxp.com/rapid-iot";
 void prerun_board_config(void)
 {
     flash_manager_set_page_erase(true);
+    flash_decoder_set_sector_erase(true);
 }
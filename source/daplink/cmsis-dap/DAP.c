@@ -129,7 +129,8 @@ static uint8_t DAP_Info(uint8_t id, uint8_t *info) {
                 ((DAP_JTAG != 0)       ? (1U << 1) : 0U) |
                 ((SWO_UART != 0)       ? (1U << 2) : 0U) |
                 ((SWO_MANCHESTER != 0) ? (1U << 3) : 0U) |
-                /* Atomic Commands  */   (1U << 4);
+                /* Atomic Commands  */   (1U << 4)         |
+                ((SWO_STREAM != 0)     ? (1U << 6) : 0U);
       length = 1U;
       break;
     case DAP_ID_SWO_BUFFER_SIZE:
@@ -268,6 +269,8 @@ static uint32_t DAP_Connect(const uint8_t *request, uint8_t *response) {
     port = *request;
   }
   
+  JTAG_InvalidateIR();
+
   switch (port) {
 #if (DAP_SWD != 0)
     case DAP_PORT_SWD:
@@ -298,6 +301,7 @@ static uint32_t DAP_Disconnect(uint8_t *response) {
 
   DAP_Data.debug_port = DAP_PORT_DISABLED;
   PORT_OFF();
+  JTAG_InvalidateIR();
 
   *response = DAP_OK;
   return (1U);
@@ -309,6 +313,8 @@ static uint32_t DAP_Disconnect(uint8_t *response) {
 //   return:   number of bytes in response
 static uint32_t DAP_ResetTarget(uint8_t *response) {
 
+  // Some targets reset their TAPs along with the system
+  JTAG_InvalidateIR();
   *(response+1) = RESET_TARGET();
   *(response+0) = DAP_OK;
   return (2U);
@@ -333,6 +339,9 @@ static uint32_t DAP_SWJ_Pins(const uint8_t *request, uint8_t *response) {
            (*(request+4) << 16) |
            (*(request+5) << 24);
 
+  // Driving the pins directly may move or reset the TAPs
+  JTAG_InvalidateIR();
+
   if (select & (1U << DAP_SWJ_SWCLK_TCK)) {
     if (value & (1U << DAP_SWJ_SWCLK_TCK)) {
       PIN_SWCLK_TCK_SET();
@@ -455,6 +464,7 @@ static uint32_t DAP_SWJ_Sequence(const uint8_t *request, uint8_t *response) {
   if (count == 0U) { count = 256U; }
 
 #if ((DAP_SWD != 0) || (DAP_JTAG != 0))
+  JTAG_InvalidateIR();
   SWJ_Sequence(count, request);
   *response = DAP_OK;
 #else
@@ -558,6 +568,7 @@ static uint32_t DAP_JTAG_Configure(const uint8_t *request, uint8_t *response) {
     bits -= DAP_Data.jtag_dev.ir_length[n];
     DAP_Data.jtag_dev.ir_after[n] = (uint16_t)bits;
   }
+  JTAG_InvalidateIR();
 
   *response = DAP_OK;
 #else
@@ -1593,6 +1604,7 @@ void DAP_Setup(void) {
 #if (DAP_JTAG != 0)
   DAP_Data.jtag_dev.count = 0U;
 #endif
+  JTAG_InvalidateIR();
 
   DAP_SETUP();  // Device specific setup
 }
@@ -100,6 +100,14 @@ extern "C" {
 
 #define ID_DAP_Invalid                  0xFFU
 
+// DAP Vendor Command IDs for streaming memory access
+#define ID_DAP_StreamRead               ID_DAP_Vendor13
+#define ID_DAP_StreamWrite              ID_DAP_Vendor14
+
+// DAP Vendor Command IDs for target memory sampling
+#define ID_DAP_SampleConfigure          ID_DAP_Vendor15
+#define ID_DAP_SampleStart              ID_DAP_Vendor16
+
 // DAP Status Code
 #define DAP_OK                          0U
 #define DAP_ERROR                       0xFFU
@@ -177,6 +185,9 @@ extern "C" {
 #define JTAG_IDCODE                     0x0EU
 #define JTAG_BYPASS                     0x0FU
 
+// JTAG IR shadow value when the IR contents are not known
+#define JTAG_IR_UNKNOWN                 0xFFFFFFFFU
+
 // JTAG Sequence Info
 #define JTAG_SEQUENCE_TCK               0x3FU   // TCK count
 #define JTAG_SEQUENCE_TMS               0x40U   // TMS value
@@ -211,6 +222,7 @@ typedef struct {
     uint8_t   ir_length[DAP_JTAG_DEV_CNT];      // IR Length in bits
     uint16_t  ir_before[DAP_JTAG_DEV_CNT];      // Bits before IR
     uint16_t  ir_after [DAP_JTAG_DEV_CNT];      // Bits after IR
+    uint32_t  ir_value [DAP_JTAG_DEV_CNT];      // IR shadow (JTAG_IR_UNKNOWN if not known)
 #endif
   } jtag_dev;
 #endif
@@ -227,6 +239,7 @@ extern void     JTAG_IR         (uint32_t ir);
 extern uint32_t JTAG_ReadIDCode (void);
 extern void     JTAG_WriteAbort (uint32_t data);
 extern uint8_t  JTAG_Transfer   (uint32_t request, uint32_t *data);
+extern void     JTAG_InvalidateIR (void);
 extern uint8_t  SWD_Transfer    (uint32_t request, uint32_t *data);
 
 extern void     Delayms         (uint32_t delay);
@@ -238,6 +251,15 @@ extern uint32_t SWO_Control     (const uint8_t *request, uint8_t *response);
 extern uint32_t SWO_Status                              (uint8_t *response);
 extern uint32_t SWO_Data        (const uint8_t *request, uint8_t *response);
 
+// SWO background processing, run from the main task
+extern void     SWO_Process          (uint32_t flush);
+
+// SWO streaming trace (transport 2), run from the USB thread
+extern void     SWO_StreamProcess    (uint32_t flush);
+extern void     SWO_TransferComplete (void);
+extern void     SWO_QueueTransfer    (uint8_t *buf, uint32_t num);
+extern void     SWO_AbortTransfer    (void);
+
 extern uint32_t DAP_ProcessVendorCommand (const uint8_t *request, uint8_t *response);
 extern uint32_t DAP_ProcessCommand       (const uint8_t *request, uint8_t *response);
 extern uint32_t DAP_ExecuteCommand       (const uint8_t *request, uint8_t *response);
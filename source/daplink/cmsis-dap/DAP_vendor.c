@@ -35,6 +35,9 @@
 #include "file_stream.h"
 #include "settings.h"
 #include "target_reset.h"
+#include "debug_cm.h"
+#include "tasks.h"
+#include "swd_host.h"
 #include <string.h>
 
 //**************************************************************************************************
@@ -48,6 +51,504 @@ Vendor Commands. Copy this file to the project folder of the Debug Unit and add
 file to the MDK-ARM project under the file group Configuration.
 */
 
+#if (DAP_SWD != 0)
+
+// MEM-AP address auto increment is only guaranteed within a 1KB block
+#define STREAM_TAR_WRAP         0x400U
+
+// Stream read packet: Command ID, status, word count, data
+#define STREAM_READ_HEADER      3U
+#define STREAM_READ_WORDS       ((DAP_PACKET_SIZE - STREAM_READ_HEADER) / 4U)
+
+// Stream write request: Command ID, APSEL, CSW, address, word count, data
+#define STREAM_WRITE_HEADER     11U
+#define STREAM_WRITE_WORDS      ((DAP_PACKET_SIZE - STREAM_WRITE_HEADER) / 4U)
+
+// Sampler: at most this many variables, each naturally aligned
+#define SAMPLE_MAX_ENTRIES      8U
+
+// Sample packet: Command ID, status, record count, records. A record is
+// a timestamp in microseconds followed by the value of each variable.
+#define SAMPLE_HEADER           3U
+#define SAMPLE_TIMESTAMP        4U
+
+// Sample configure request: APSEL, CSW, period, count, count * (address, width)
+#define SAMPLE_CONFIG_HEADER    10U
+#define SAMPLE_CONFIG_ENTRY     5U
+
+// Sampling busy waits for the last part of a tick before each sample, so
+// it runs below every other task
+#define SAMPLE_PRIORITY         LOWEST_PRIORITY
+
+typedef struct {
+  uint8_t  apsel;
+  uint32_t csw;
+  uint32_t period;                      // Sample period in microseconds
+  uint32_t count;                       // Number of variables
+  uint32_t record_size;                 // Bytes per record
+  uint32_t addr[SAMPLE_MAX_ENTRIES];    // Variable addresses, ascending
+  uint8_t  width[SAMPLE_MAX_ENTRIES];   // Variable sizes in bytes
+} sample_config_t;
+
+static sample_config_t sample_config;
+
+extern uint8_t *dap_stream_alloc(void);
+extern void     dap_stream_send(uint8_t *buf, uint32_t len);
+extern void     dap_stream_free(uint8_t *buf);
+
+// Microseconds per RTX tick, OS_TICK in RTX_Config.c
+extern U32 const os_clockrate;
+
+static uint32_t stream_get_word(const uint8_t *data) {
+  return ((uint32_t)data[0] <<  0) |
+         ((uint32_t)data[1] <<  8) |
+         ((uint32_t)data[2] << 16) |
+         ((uint32_t)data[3] << 24);
+}
+
+// SWD transfer retried on WAIT like the standard transfer commands
+static uint8_t stream_transfer(uint32_t request, uint32_t *data) {
+  uint32_t retry = DAP_Data.transfer.retry_count;
+  uint8_t  ack;
+
+  do {
+    ack = SWD_Transfer(request, data);
+  } while ((ack == DAP_TRANSFER_WAIT) && retry-- && !DAP_TransferAbort);
+
+  return (ack);
+}
+
+// Select bank 0 of the AP and set CSW for auto incremented word access
+static uint8_t stream_setup(uint8_t apsel, uint32_t csw) {
+  uint32_t data;
+  uint8_t  ack;
+
+  data = (uint32_t)apsel << 24;
+  ack = stream_transfer(DP_SELECT, &data);
+  if (ack != DAP_TRANSFER_OK) {
+    return (ack);
+  }
+
+  data = (csw & ~(CSW_SIZE | CSW_ADDRINC)) | CSW_SIZE32 | CSW_SADDRINC;
+  return stream_transfer(DAP_TRANSFER_APnDP | AP_CSW, &data);
+}
+
+// Read count words which must not cross a TAR auto increment block.
+// done is incremented for every word stored.
+static uint8_t stream_read_run(uint32_t addr, uint8_t *data, uint32_t count, uint32_t *done) {
+  uint32_t request;
+  uint32_t value;
+  uint8_t  ack;
+
+  ack = stream_transfer(DAP_TRANSFER_APnDP | AP_TAR, &addr);
+  if (ack != DAP_TRANSFER_OK) {
+    return (ack);
+  }
+
+  // Post the first read, each following read returns the previous value
+  ack = stream_transfer(DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | AP_DRW, NULL);
+  while ((ack == DAP_TRANSFER_OK) && count--) {
+    request = count ? (DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | AP_DRW) :
+                      (DP_RDBUFF | DAP_TRANSFER_RnW);
+    ack = stream_transfer(request, &value);
+    if (ack != DAP_TRANSFER_OK) {
+      break;
+    }
+    *data++ = (uint8_t) value;
+    *data++ = (uint8_t)(value >>  8);
+    *data++ = (uint8_t)(value >> 16);
+    *data++ = (uint8_t)(value >> 24);
+    (*done)++;
+  }
+
+  return (ack);
+}
+
+// Process Stream Read command: read a block of memory of any length through
+// a MEM-AP and send it back in as many response packets as needed. TAR is
+// re-issued whenever the address crosses an auto increment block. SELECT and
+// CSW are left set up for the stream so host side caches must be flushed.
+//   request:  APSEL(1) CSW(4) address(4) word count(4)
+//   response: per packet status(1) words in packet(1) data(words * 4)
+//   return:   number of bytes in request (upper 16 bits)
+//             number of bytes in last response packet (lower 16 bits)
+static uint32_t DAP_StreamRead(const uint8_t *request, uint8_t *response) {
+  uint32_t addr;
+  uint32_t count;
+  uint32_t done;
+  uint32_t run;
+  uint32_t n;
+  uint8_t *pkt;
+  uint8_t *body;
+  uint8_t  ack;
+
+  addr  = stream_get_word(request + 5);
+  count = stream_get_word(request + 9);
+
+  DAP_TransferAbort = 0U;
+
+  if (DAP_Data.debug_port == DAP_PORT_SWD) {
+    ack = stream_setup(request[0], stream_get_word(request + 1));
+  } else {
+    ack = DAP_TRANSFER_ERROR;
+  }
+
+  while (1) {
+    n = (count < STREAM_READ_WORDS) ? count : STREAM_READ_WORDS;
+
+    // The last packet goes out in the response buffer of the request
+    pkt  = NULL;
+    body = response;
+    if ((n < count) && (ack == DAP_TRANSFER_OK)) {
+      pkt = dap_stream_alloc();
+      if (pkt == NULL) {
+        ack = DAP_TRANSFER_ERROR;
+      } else {
+        pkt[0] = ID_DAP_StreamRead;
+        body = pkt + 1;
+      }
+    }
+
+    done = 0U;
+    while ((ack == DAP_TRANSFER_OK) && (done < n)) {
+      run = (STREAM_TAR_WRAP - (addr & (STREAM_TAR_WRAP - 1U))) / 4U;
+      if (run > (n - done)) {
+        run = n - done;
+      }
+      ack = stream_read_run(addr, body + 2 + (done * 4U), run, &done);
+      addr += run * 4U;
+    }
+
+    body[0] = ack;
+    body[1] = (uint8_t)done;
+    count  -= done;
+
+    if (pkt == NULL) {
+      break;
+    }
+
+    if (ack != DAP_TRANSFER_OK) {
+      // A failed packet ends the stream
+      memcpy(response, body, 2U + (done * 4U));
+      dap_stream_free(pkt);
+      break;
+    }
+
+    dap_stream_send(pkt, 3U + (done * 4U));
+  }
+
+  return ((13U << 16) | (2U + (done * 4U)));
+}
+
+// Process Stream Write command: write a block of words through a MEM-AP,
+// re-issuing TAR whenever the address crosses an auto increment block.
+// Hosts pipeline these using the packet count to stream large writes.
+//   request:  APSEL(1) CSW(4) address(4) word count(1) data(count * 4)
+//   response: status(1) words written(1)
+//   return:   number of bytes in request (upper 16 bits)
+//             number of bytes in response (lower 16 bits)
+static uint32_t DAP_StreamWrite(const uint8_t *request, uint8_t *response) {
+  uint32_t addr;
+  uint32_t count;
+  uint32_t done;
+  uint32_t data;
+  uint8_t  ack;
+
+  addr  = stream_get_word(request + 5);
+  count = request[9];
+
+  DAP_TransferAbort = 0U;
+
+  if ((DAP_Data.debug_port == DAP_PORT_SWD) && (count <= STREAM_WRITE_WORDS)) {
+    ack = stream_setup(request[0], stream_get_word(request + 1));
+  } else {
+    ack = DAP_TRANSFER_ERROR;
+  }
+
+  done = 0U;
+  while ((ack == DAP_TRANSFER_OK) && (done < count)) {
+    if ((done == 0U) || ((addr & (STREAM_TAR_WRAP - 1U)) == 0U)) {
+      data = addr;
+      ack = stream_transfer(DAP_TRANSFER_APnDP | AP_TAR, &data);
+      if (ack != DAP_TRANSFER_OK) {
+        break;
+      }
+    }
+    data = stream_get_word(request + 10 + (done * 4U));
+    ack = stream_transfer(DAP_TRANSFER_APnDP | AP_DRW, &data);
+    if (ack != DAP_TRANSFER_OK) {
+      break;
+    }
+    addr += 4U;
+    done++;
+  }
+
+  if (ack == DAP_TRANSFER_OK) {
+    // Check last write
+    ack = stream_transfer(DP_RDBUFF | DAP_TRANSFER_RnW, NULL);
+  }
+
+  response[0] = ack;
+  response[1] = (uint8_t)done;
+
+  if (count > STREAM_WRITE_WORDS) {
+    count = 0U;
+  }
+
+  return (((10U + (count * 4U)) << 16) | 2U);
+}
+
+// Microseconds from the RTX tick count and the SysTick count within the tick
+static uint32_t sample_time_us(void) {
+  uint32_t tick;
+  uint32_t val;
+
+  do {
+    tick = os_time_get();
+    val  = SysTick->VAL;
+  } while (tick != os_time_get());
+
+  return ((tick * os_clockrate) + ((SysTick->LOAD - val) / ((SysTick->LOAD + 1U) / os_clockrate)));
+}
+
+// Read every variable once and store a record. Variables in consecutive
+// words are read as one auto increment run with pipelined AP reads.
+static uint8_t sample_take(uint8_t *record) {
+  uint8_t  words[SAMPLE_MAX_ENTRIES * 4U];
+  uint32_t start[SAMPLE_MAX_ENTRIES];
+  uint32_t first;
+  uint32_t word;
+  uint32_t next;
+  uint32_t i;
+  uint32_t n;
+  uint32_t done;
+  uint8_t  ack;
+
+  // Word index in words[] of each variable
+  n = 0U;
+  for (i = 0U; i < sample_config.count; i++) {
+    if ((i == 0U) || ((sample_config.addr[i] & ~3U) != (sample_config.addr[i - 1U] & ~3U))) {
+      n++;
+    }
+    start[i] = n - 1U;
+  }
+
+  // Read runs of consecutive words within a TAR auto increment block
+  first = 0U;
+  done  = 0U;
+  for (i = 0U; i < sample_config.count; i++) {
+    if (i + 1U < sample_config.count) {
+      word = sample_config.addr[i] & ~3U;
+      next = sample_config.addr[i + 1U] & ~3U;
+      if ((next == word) || ((next == (word + 4U)) && ((next & (STREAM_TAR_WRAP - 1U)) != 0U))) {
+        continue;
+      }
+    }
+    ack = stream_read_run(sample_config.addr[first] & ~3U, &words[start[first] * 4U],
+                          start[i] - start[first] + 1U, &done);
+    if (ack != DAP_TRANSFER_OK) {
+      return (ack);
+    }
+    first = i + 1U;
+  }
+
+  for (i = 0U; i < SAMPLE_TIMESTAMP; i++) {
+    *record++ = 0U;
+  }
+  for (i = 0U; i < sample_config.count; i++) {
+    memcpy(record, &words[(start[i] * 4U) + (sample_config.addr[i] & 3U)], sample_config.width[i]);
+    record += sample_config.width[i];
+  }
+
+  return (DAP_TRANSFER_OK);
+}
+
+// Process Sample Configure command: set the variables to sample and the
+// sample period. Variables are sorted by address so that neighbours can
+// be read in one run.
+//   request:  APSEL(1) CSW(4) period in us(4) count(1) count * (address(4) width(1))
+//   response: status(1)
+//   return:   number of bytes in request (upper 16 bits)
+//             number of bytes in response (lower 16 bits)
+static uint32_t DAP_SampleConfigure(const uint8_t *request, uint8_t *response) {
+  sample_config_t config;
+  uint32_t count;
+  uint32_t len;
+  uint32_t addr;
+  uint8_t  width;
+  uint32_t i;
+  uint32_t j;
+
+  // A count byte that does not fit the packet is an error anyway, so the
+  // request length never goes past the end of the packet
+  count = request[9];
+  len = SAMPLE_CONFIG_HEADER + (count * SAMPLE_CONFIG_ENTRY);
+  if (len > DAP_PACKET_SIZE) {
+    len = DAP_PACKET_SIZE;
+  }
+  if (count > SAMPLE_MAX_ENTRIES) {
+    *response = DAP_ERROR;
+    return ((len << 16) | 1U);
+  }
+
+  config.apsel       = request[0];
+  config.csw         = stream_get_word(request + 1);
+  config.period      = stream_get_word(request + 5);
+  config.count       = count;
+  config.record_size = SAMPLE_TIMESTAMP;
+
+  for (i = 0U; i < count; i++) {
+    addr  = stream_get_word(request + SAMPLE_CONFIG_HEADER + (i * SAMPLE_CONFIG_ENTRY));
+    width = request[SAMPLE_CONFIG_HEADER + 4U + (i * SAMPLE_CONFIG_ENTRY)];
+    if (((width != 1U) && (width != 2U) && (width != 4U)) || (addr & (width - 1U))) {
+      count = 0U;
+      break;
+    }
+
+    // Insertion sort by address
+    for (j = i; (j > 0U) && (config.addr[j - 1U] > addr); j--) {
+      config.addr[j]  = config.addr[j - 1U];
+      config.width[j] = config.width[j - 1U];
+    }
+    config.addr[j]  = addr;
+    config.width[j] = width;
+    config.record_size += width;
+  }
+
+  if ((count == 0U) || (config.record_size > (DAP_PACKET_SIZE - SAMPLE_HEADER))) {
+    *response = DAP_ERROR;
+  } else {
+    sample_config = config;
+    *response = DAP_OK;
+  }
+
+  return ((len << 16) | 1U);
+}
+
+// Process Sample Start command: sample the configured variables every
+// period and stream the records back, as many records per packet as fit.
+// Sampling runs until the requested number of records has been taken or
+// the host sends ID_DAP_TransferAbort. The last packet goes out in the
+// response. A record is not taken at the expense of a late one, so the
+// timestamps show where samples were dropped.
+//   request:  record count(4), 0 to sample until aborted
+//   response: per packet status(1) record count(1) records
+//   return:   number of bytes in request (upper 16 bits)
+//             number of bytes in last response packet (lower 16 bits)
+static uint32_t DAP_SampleStart(const uint8_t *request, uint8_t *response) {
+  uint32_t total;
+  uint32_t taken;
+  uint32_t per_packet;
+  uint32_t n;
+  uint32_t now;
+  uint32_t next;
+  uint8_t *pkt;
+  uint8_t *body;
+  uint8_t *record;
+  uint8_t  ack;
+
+  total = stream_get_word(request);
+  DAP_TransferAbort = 0U;
+
+  // Nothing configured, so there is no record size to fit into packets
+  if (sample_config.count == 0U) {
+    response[0] = DAP_TRANSFER_ERROR;
+    response[1] = 0U;
+    return ((4U << 16) | 2U);
+  }
+
+  if (DAP_Data.debug_port == DAP_PORT_SWD) {
+    ack = stream_setup(sample_config.apsel, sample_config.csw);
+  } else {
+    ack = DAP_TRANSFER_ERROR;
+  }
+
+  os_tsk_prio_self(SAMPLE_PRIORITY);
+
+  per_packet = (DAP_PACKET_SIZE - SAMPLE_HEADER) / sample_config.record_size;
+  taken = 0U;
+  next  = sample_time_us();
+  pkt   = NULL;
+  body  = response;
+  n     = 0U;
+
+  while (ack == DAP_TRANSFER_OK) {
+    if (pkt == NULL) {
+      pkt = dap_stream_alloc();
+      if (pkt == NULL) {
+        break;
+      }
+      pkt[0] = ID_DAP_SampleStart;
+      body = pkt + 1;
+      n = 0U;
+    }
+
+    // Wait for the sample time without holding the target, sleeping
+    // through whole ticks. If it has passed start again from now.
+    swd_unlock();
+    for (;;) {
+      now = sample_time_us();
+      if (DAP_TransferAbort || ((int32_t)(now - next) >= 0)) {
+        break;
+      }
+      if ((next - now) > os_clockrate) {
+        os_dly_wait(1);
+      }
+    }
+    swd_lock();
+    if (DAP_TransferAbort) {
+      break;
+    }
+    if ((now - next) >= sample_config.period) {
+      next = now;
+    }
+    next += sample_config.period;
+
+    // The target may have been used while it was released
+    record = body + 2 + (n * sample_config.record_size);
+    ack = stream_setup(sample_config.apsel, sample_config.csw);
+    if (ack == DAP_TRANSFER_OK) {
+      ack = sample_take(record);
+    }
+    if (ack != DAP_TRANSFER_OK) {
+      break;
+    }
+    record[0] = (uint8_t) now;
+    record[1] = (uint8_t)(now >>  8);
+    record[2] = (uint8_t)(now >> 16);
+    record[3] = (uint8_t)(now >> 24);
+    n++;
+    taken++;
+
+    if ((total != 0U) && (taken == total)) {
+      break;
+    }
+
+    if (n == per_packet) {
+      body[0] = DAP_TRANSFER_OK;
+      body[1] = (uint8_t)n;
+      dap_stream_send(pkt, SAMPLE_HEADER + (n * sample_config.record_size));
+      pkt = NULL;
+    }
+  }
+
+  os_tsk_prio_self(DAP_TASK_PRIORITY);
+
+  // Records not yet sent go out in the response
+  if (pkt != NULL) {
+    memcpy(response + 2, body + 2, n * sample_config.record_size);
+    dap_stream_free(pkt);
+  } else {
+    n = 0U;
+  }
+  response[0] = ack;
+  response[1] = (uint8_t)n;
+
+  return ((4U << 16) | (2U + (n * sample_config.record_size)));
+}
+
+#endif
+
 /** Process DAP Vendor Command and prepare Response Data
 \param request   pointer to request data
 \param response  pointer to response data
@@ -153,10 +654,33 @@ uint32_t DAP_ProcessVendorCommand(const uint8_t *request, uint8_t *response) {
         num += ((write_len + 1) << 16) | 1;
         break;
     }
+#if (DAP_SWD != 0)
+    case ID_DAP_StreamRead: {
+        // stream memory read
+        num += DAP_StreamRead(request, response);
+        break;
+    }
+    case ID_DAP_StreamWrite: {
+        // stream memory write
+        num += DAP_StreamWrite(request, response);
+        break;
+    }
+    case ID_DAP_SampleConfigure: {
+        // configure memory sampling
+        num += DAP_SampleConfigure(request, response);
+        break;
+    }
+    case ID_DAP_SampleStart: {
+        // stream memory samples
+        num += DAP_SampleStart(request, response);
+        break;
+    }
+#else
     case ID_DAP_Vendor13: break;
     case ID_DAP_Vendor14: break;
     case ID_DAP_Vendor15: break;
     case ID_DAP_Vendor16: break;
+#endif
     case ID_DAP_Vendor17: break;
     case ID_DAP_Vendor18: break;
     case ID_DAP_Vendor19: break;
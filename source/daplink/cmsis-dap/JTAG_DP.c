@@ -67,6 +67,64 @@
   PIN_TCK_SET();                        \
   PIN_DELAY()
 
+// Unrolled 8 bit versions, LSB first. The TDO ones need a local bit.
+
+#define JTAG_CYCLE_TCK_8()              \
+  JTAG_CYCLE_TCK();                     \
+  JTAG_CYCLE_TCK();                     \
+  JTAG_CYCLE_TCK();                     \
+  JTAG_CYCLE_TCK();                     \
+  JTAG_CYCLE_TCK();                     \
+  JTAG_CYCLE_TCK();                     \
+  JTAG_CYCLE_TCK();                     \
+  JTAG_CYCLE_TCK()
+
+#define JTAG_CYCLE_TDI_8(tdi)           \
+  JTAG_CYCLE_TDI((tdi) >> 0);           \
+  JTAG_CYCLE_TDI((tdi) >> 1);           \
+  JTAG_CYCLE_TDI((tdi) >> 2);           \
+  JTAG_CYCLE_TDI((tdi) >> 3);           \
+  JTAG_CYCLE_TDI((tdi) >> 4);           \
+  JTAG_CYCLE_TDI((tdi) >> 5);           \
+  JTAG_CYCLE_TDI((tdi) >> 6);           \
+  JTAG_CYCLE_TDI((tdi) >> 7)
+
+#define JTAG_CYCLE_TDO_8(tdo,pos)       \
+  JTAG_CYCLE_TDO(bit);                  \
+  tdo |= bit << ((pos) + 0);            \
+  JTAG_CYCLE_TDO(bit);                  \
+  tdo |= bit << ((pos) + 1);            \
+  JTAG_CYCLE_TDO(bit);                  \
+  tdo |= bit << ((pos) + 2);            \
+  JTAG_CYCLE_TDO(bit);                  \
+  tdo |= bit << ((pos) + 3);            \
+  JTAG_CYCLE_TDO(bit);                  \
+  tdo |= bit << ((pos) + 4);            \
+  JTAG_CYCLE_TDO(bit);                  \
+  tdo |= bit << ((pos) + 5);            \
+  JTAG_CYCLE_TDO(bit);                  \
+  tdo |= bit << ((pos) + 6);            \
+  JTAG_CYCLE_TDO(bit);                  \
+  tdo |= bit << ((pos) + 7)
+
+#define JTAG_CYCLE_TDIO_8(tdi,tdo)      \
+  JTAG_CYCLE_TDIO((tdi) >> 0, bit);     \
+  tdo |= bit << 0;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 1, bit);     \
+  tdo |= bit << 1;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 2, bit);     \
+  tdo |= bit << 2;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 3, bit);     \
+  tdo |= bit << 3;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 4, bit);     \
+  tdo |= bit << 4;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 5, bit);     \
+  tdo |= bit << 5;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 6, bit);     \
+  tdo |= bit << 6;                      \
+  JTAG_CYCLE_TDIO((tdi) >> 7, bit);     \
+  tdo |= bit << 7
+
 #define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
 
 
@@ -78,35 +136,46 @@
 //   tdi:    pointer to TDI generated data
 //   tdo:    pointer to TDO captured data
 //   return: none
-void JTAG_Sequence (uint32_t info, const uint8_t *tdi, uint8_t *tdo) {
-  uint32_t i_val;
-  uint32_t o_val;
-  uint32_t bit;
-  uint32_t n, k;
-
-  n = info & JTAG_SEQUENCE_TCK;
-  if (n == 0U) { n = 64U; }
-
-  if (info & JTAG_SEQUENCE_TMS) {
-    PIN_TMS_SET();
-  } else {
-    PIN_TMS_CLR();
-  }
-
-  while (n) {
-    i_val = *tdi++;
-    o_val = 0U;
-    for (k = 8U; k && n; k--, n--) {
-      JTAG_CYCLE_TDIO(i_val, bit);
-      i_val >>= 1;
-      o_val >>= 1;
-      o_val  |= bit << 7;
-    }
-    o_val >>= k;
-    if (info & JTAG_SEQUENCE_TDO) {
-      *tdo++ = (uint8_t)o_val;
-    }
-  }
+#define JTAG_SequenceFunction(speed)        /**/                                \
+static void JTAG_Sequence##speed (uint32_t info, const uint8_t *tdi,            \
+                                  uint8_t *tdo) {                               \
+  uint32_t i_val;                                                               \
+  uint32_t o_val;                                                               \
+  uint32_t bit;                                                                 \
+  uint32_t n, k;                                                                \
+                                                                                \
+  n = info & JTAG_SEQUENCE_TCK;                                                 \
+  if (n == 0U) { n = 64U; }                                                     \
+                                                                                \
+  if (info & JTAG_SEQUENCE_TMS) {                                               \
+    PIN_TMS_SET();                                                              \
+  } else {                                                                      \
+    PIN_TMS_CLR();                                                              \
+  }                                                                             \
+                                                                                \
+  for (; n >= 8U; n -= 8U) {                                                    \
+    i_val = *tdi++;                                                             \
+    o_val = 0U;                                                                 \
+    JTAG_CYCLE_TDIO_8(i_val, o_val);        /* Whole bytes */                   \
+    if (info & JTAG_SEQUENCE_TDO) {                                             \
+      *tdo++ = (uint8_t)o_val;                                                  \
+    }                                                                           \
+  }                                                                             \
+                                                                                \
+  if (n) {                                                                      \
+    i_val = *tdi;                                                               \
+    o_val = 0U;                                                                 \
+    for (k = 8U; n; k--, n--) {                                                 \
+      JTAG_CYCLE_TDIO(i_val, bit);          /* Remaining bits */                \
+      i_val >>= 1;                                                              \
+      o_val >>= 1;                                                              \
+      o_val  |= bit << 7;                                                       \
+    }                                                                           \
+    o_val >>= k;                                                                \
+    if (info & JTAG_SEQUENCE_TDO) {                                             \
+      *tdo = (uint8_t)o_val;                                                    \
+    }                                                                           \
+  }                                                                             \
 }
 
 
@@ -125,7 +194,11 @@ void JTAG_IR_##speed (uint32_t ir) {
   JTAG_CYCLE_TCK();                         /* Shift-IR */                      \
                                                                                 \
   PIN_TDI_OUT(1U);                                                              \
-  for (n = DAP_Data.jtag_dev.ir_before[DAP_Data.jtag_dev.index]; n; n--) {      \
+  n = DAP_Data.jtag_dev.ir_before[DAP_Data.jtag_dev.index];                     \
+  for (; n >= 8U; n -= 8U) {                                                    \
+    JTAG_CYCLE_TCK_8();                     /* Bypass before data */            \
+  }                                                                             \
+  for (; n; n--) {                                                              \
     JTAG_CYCLE_TCK();                       /* Bypass before data */            \
   }                                                                             \
   for (n = DAP_Data.jtag_dev.ir_length[DAP_Data.jtag_dev.index] - 1U; n; n--) { \
@@ -136,7 +209,10 @@ void JTAG_IR_##speed (uint32_t ir) {
   if (n) {                                                                      \
     JTAG_CYCLE_TDI(ir);                     /* Set last IR bit */               \
     PIN_TDI_OUT(1U);                                                            \
-    for (--n; n; n--) {                                                         \
+    for (--n; n >= 8U; n -= 8U) {                                               \
+      JTAG_CYCLE_TCK_8();                   /* Bypass after data */             \
+    }                                                                           \
+    for (; n; n--) {                                                            \
       JTAG_CYCLE_TCK();                     /* Bypass after data */             \
     }                                                                           \
     PIN_TMS_SET();                                                              \
@@ -191,10 +267,12 @@ uint8_t JTAG_Transfer##speed (uint32_t request, uint32_t *data) {
   if (request & DAP_TRANSFER_RnW) {                                             \
     /* Read Transfer */                                                         \
     val = 0U;                                                                   \
-    for (n = 31U; n; n--) {                                                     \
-      JTAG_CYCLE_TDO(bit);                  /* Get D0..D30 */                   \
-      val  |= bit << 31;                                                        \
-      val >>= 1;                                                                \
+    JTAG_CYCLE_TDO_8(val, 0U);              /* Get D0..D7 */                    \
+    JTAG_CYCLE_TDO_8(val, 8U);              /* Get D8..D15 */                   \
+    JTAG_CYCLE_TDO_8(val, 16U);             /* Get D16..D23 */                  \
+    for (n = 24U; n < 31U; n++) {                                               \
+      JTAG_CYCLE_TDO(bit);                  /* Get D24..D30 */                  \
+      val |= bit << n;                                                          \
     }                                                                           \
     n = DAP_Data.jtag_dev.count - DAP_Data.jtag_dev.index - 1U;                 \
     if (n) {                                                                    \
@@ -213,8 +291,12 @@ uint8_t JTAG_Transfer##speed (uint32_t request, uint32_t *data) {
   } else {                                                                      \
     /* Write Transfer */                                                        \
     val = *data;                                                                \
-    for (n = 31U; n; n--) {                                                     \
-      JTAG_CYCLE_TDI(val);                  /* Set D0..D30 */                   \
+    JTAG_CYCLE_TDI_8(val);                  /* Set D0..D7 */                    \
+    JTAG_CYCLE_TDI_8(val >> 8);             /* Set D8..D15 */                   \
+    JTAG_CYCLE_TDI_8(val >> 16);            /* Set D16..D23 */                  \
+    val >>= 24;                                                                 \
+    for (n = 7U; n; n--) {                                                      \
+      JTAG_CYCLE_TDI(val);                  /* Set D24..D30 */                  \
       val >>= 1;                                                                \
     }                                                                           \
     n = DAP_Data.jtag_dev.count - DAP_Data.jtag_dev.index - 1u;                 \
@@ -249,11 +331,13 @@ exit:
 
 #undef  PIN_DELAY
 #define PIN_DELAY() PIN_DELAY_FAST()
+JTAG_SequenceFunction(Fast);
 JTAG_IR_Function(Fast);
 JTAG_TransferFunction(Fast);
 
 #undef  PIN_DELAY
 #define PIN_DELAY() PIN_DELAY_SLOW(DAP_Data.clock_delay)
+JTAG_SequenceFunction(Slow);
 JTAG_IR_Function(Slow);
 JTAG_TransferFunction(Slow);
 
@@ -338,15 +422,43 @@ void JTAG_WriteAbort (uint32_t data) {
 }
 
 
-// JTAG Set IR
+// Generate JTAG Sequence
+//   info:   sequence information
+//   tdi:    pointer to TDI generated data
+//   tdo:    pointer to TDO captured data
+//   return: none
+void JTAG_Sequence (uint32_t info, const uint8_t *tdi, uint8_t *tdo) {
+  // The sequence may take the TAPs anywhere
+  JTAG_InvalidateIR();
+  if (DAP_Data.fast_clock) {
+    JTAG_SequenceFast(info, tdi, tdo);
+  } else {
+    JTAG_SequenceSlow(info, tdi, tdo);
+  }
+}
+
+
+// JTAG Set IR, skipped when the device already holds the value
 //   ir:     IR value
 //   return: none
 void JTAG_IR (uint32_t ir) {
+  uint32_t n;
+
+  if (DAP_Data.jtag_dev.ir_value[DAP_Data.jtag_dev.index] == ir) {
+    return;
+  }
+
   if (DAP_Data.fast_clock) {
     JTAG_IR_Fast(ir);
   } else {
     JTAG_IR_Slow(ir);
   }
+
+  // The scan puts all other devices in BYPASS
+  for (n = 0U; n < DAP_Data.jtag_dev.count; n++) {
+    DAP_Data.jtag_dev.ir_value[n] = JTAG_IR_UNKNOWN;
+  }
+  DAP_Data.jtag_dev.ir_value[DAP_Data.jtag_dev.index] = ir;
 }
 
 
@@ -355,12 +467,34 @@ void JTAG_IR (uint32_t ir) {
 //   data:    DATA[31:0]
 //   return:  ACK[2:0]
 uint8_t  JTAG_Transfer(uint32_t request, uint32_t *data) {
+  uint8_t ack;
+
   if (DAP_Data.fast_clock) {
-    return JTAG_TransferFast(request, data);
+    ack = JTAG_TransferFast(request, data);
   } else {
-    return JTAG_TransferSlow(request, data);
+    ack = JTAG_TransferSlow(request, data);
   }
+
+  // A device that does not answer may have lost its IR
+  if ((ack != DAP_TRANSFER_OK) && (ack != DAP_TRANSFER_WAIT)) {
+    JTAG_InvalidateIR();
+  }
+
+  return (ack);
 }
 
 
 #endif  /* (DAP_JTAG != 0) */
+
+
+// JTAG Invalidate IR shadow, forcing the next JTAG_IR() to scan
+//   return: none
+void JTAG_InvalidateIR (void) {
+#if (DAP_JTAG != 0)
+  uint32_t n;
+
+  for (n = 0U; n < DAP_JTAG_DEV_CNT; n++) {
+    DAP_Data.jtag_dev.ir_value[n] = JTAG_IR_UNKNOWN;
+  }
+#endif
+}
@@ -27,12 +27,24 @@
 
 #include "DAP_config.h"
 #include "DAP.h"
-#if (SWO_UART != 0)
+#if (SWO_UART != 0) && (SWO_UART_NATIVE == 0)
 #include "Driver_USART.h"
 #endif
+#if (SWO_UART != 0) && (SWO_UART_NATIVE != 0)
+#include "swo_uart.h"
+#endif
+#if (SWO_MANCHESTER != 0)
+#include "swo_manchester.h"
+#endif
+#if ((SWO_UART != 0) && (SWO_UART_NATIVE != 0)) || (SWO_STREAM != 0)
+#include "cortex_m.h"
+#endif
+#if (SWO_STREAM != 0) || (SWO_MANCHESTER != 0)
+#include "main.h"
+#endif
 
 
-#if (SWO_UART != 0)
+#if (SWO_UART != 0) && (SWO_UART_NATIVE == 0)
 
 #ifndef  SWO_USART_PORT
 #define  SWO_USART_PORT 0           /* USART Port Number */
@@ -44,10 +56,38 @@
 extern ARM_DRIVER_USART    USART_Driver_(SWO_USART_PORT);
 #define pUSART           (&USART_Driver_(SWO_USART_PORT))
 
+#endif  /* (SWO_UART != 0) && (SWO_UART_NATIVE == 0) */
+
+#if (SWO_UART != 0)
+
+#ifndef  SWO_UART_BLOCK_SIZE
+#define  SWO_UART_BLOCK_SIZE (SWO_BUFFER_SIZE/8U) /* Native capture size */
+#endif
+
 static uint8_t  USART_Ready;
 
 #endif  /* (SWO_UART != 0) */
 
+#if (SWO_MANCHESTER != 0)
+
+// Manchester Decoder States
+#define MANCHESTER_IDLE   0U        /* Waiting for a start bit */
+#define MANCHESTER_START  1U        /* In the first half of the start bit */
+#define MANCHESTER_DATA   2U        /* Receiving data bits */
+
+// Manchester Decoder, only used by the main task
+static uint8_t  ManchesterState;    /* Decoder State */
+static uint8_t  ManchesterLevel;    /* Line level after the last edge */
+static uint8_t  ManchesterData;     /* Byte being received, LSB first */
+static uint8_t  ManchesterBits;     /* Number of bits in ManchesterData */
+static uint16_t ManchesterEdge;     /* Time of the last mid-bit edge */
+static uint16_t ManchesterPeriod;   /* Measured bit period in ticks */
+static uint16_t ManchesterMinHalf;  /* Shortest valid start bit half */
+static uint16_t ManchesterMaxHalf;  /* Longest valid start bit half */
+static volatile uint8_t ManchesterReset; /* Reset request from the DAP task */
+
+#endif  /* (SWO_MANCHESTER != 0) */
+
 
 #if ((SWO_UART != 0) || (SWO_MANCHESTER != 0))
 
@@ -65,30 +105,58 @@ static volatile uint32_t TraceIn      = 0U; /* Incoming Trace Index */
 static volatile uint32_t TraceOut     = 0U; /* Outgoing Trace Index */
 static volatile uint32_t TracePending = 0U; /* Pending Trace Count */
 
+#if (SWO_STREAM != 0)
+// Trace Streaming
+static volatile uint8_t  TransferBusy  = 0U; /* Transfer Busy Flag */
+static volatile uint8_t  TransferAbort = 0U; /* Transfer Abort Flag */
+static          uint32_t TransferSize  = 0U; /* Current Transfer Size */
+#endif
+
 // Trace Helper functions
 static void     ClearTrace     (void);
 static uint32_t GetTraceSpace  (void);
 static uint32_t GetTraceCount  (void);
 static uint8_t  GetTraceStatus (void);
 static void     SetTraceError  (uint8_t flag);
+static void     UpdateTrace    (void);
+static void     ResumeTrace    (void);
+
+#if (SWO_UART != 0)
+void UART_SWO_Capture (uint8_t *buf, uint32_t count);
+#endif
 
 
 #if (SWO_UART != 0)
 
+// Account for a completed UART capture and start the next one
+//   count: number of bytes captured
+static void UART_CaptureComplete (uint32_t count) {
+  TracePending = 0U;
+  TraceIn += count;
+  count = GetTraceSpace();
+  if (count != 0U) {
+    UART_SWO_Capture(&TraceBuf[TraceIn & (SWO_BUFFER_SIZE-1U)], count);
+  } else {
+    TraceStatus = DAP_SWO_CAPTURE_ACTIVE | DAP_SWO_CAPTURE_PAUSED;
+  }
+#if (SWO_STREAM != 0)
+  if (TraceTransport == 2U) {
+    main_swo_event();
+  }
+#endif
+}
+
+#endif  /* (SWO_UART != 0) */
+
+
+#if (SWO_UART != 0) && (SWO_UART_NATIVE == 0)
+
 // USART Driver Callback function
 //   event: event mask
 static void USART_Callback (uint32_t event) {
-  uint32_t count;
 
   if (event &  ARM_USART_EVENT_RECEIVE_COMPLETE) {
-    TracePending = 0U;
-    TraceIn += pUSART->GetRxCount();
-    count = GetTraceSpace();
-    if (count != 0U) {
-      pUSART->Receive(&TraceBuf[TraceIn & (SWO_BUFFER_SIZE-1U)], count);
-    } else {
-      TraceStatus = DAP_SWO_CAPTURE_ACTIVE | DAP_SWO_CAPTURE_PAUSED;
-    }
+    UART_CaptureComplete(pUSART->GetRxCount());
   }
   if (event &  ARM_USART_EVENT_RX_OVERFLOW) {
     SetTraceError(DAP_SWO_BUFFER_OVERRUN);
@@ -205,40 +273,298 @@ __weak void UART_SWO_Update (void) {
   TracePending = pUSART->GetRxCount();
 }
 
-#endif  /* (SWO_UART != 0) */
+#endif  /* (SWO_UART != 0) && (SWO_UART_NATIVE == 0) */
+
+
+#if (SWO_UART != 0) && (SWO_UART_NATIVE != 0)
+
+// Native SWO UART driver receive complete callback (interrupt context)
+//   count: number of bytes received
+void swo_uart_receive_done (uint32_t count) {
+  UART_CaptureComplete(count);
+}
+
+// Native SWO UART driver error callback (interrupt context)
+//   flags: DAP_SWO_STREAM_ERROR and/or DAP_SWO_BUFFER_OVERRUN
+void swo_uart_error (uint8_t flags) {
+  SetTraceError(flags);
+}
+
+// Enable or disable UART SWO Mode
+//   enable: enable flag
+//   return: 1 - Success, 0 - Error
+uint32_t UART_SWO_Mode (uint32_t enable) {
+
+  USART_Ready = 0U;
+
+  if (enable) {
+    return (swo_uart_initialize());
+  }
+  swo_uart_uninitialize();
+  return (1U);
+}
+
+// Configure UART SWO Baudrate
+//   baudrate: requested baudrate
+//   return:   actual baudrate or 0 when not configured
+uint32_t UART_SWO_Baudrate (uint32_t baudrate) {
+  uint32_t count;
+
+  if (baudrate > SWO_UART_MAX_BAUDRATE) {
+    baudrate = SWO_UART_MAX_BAUDRATE;
+  }
+
+  if (TraceStatus & DAP_SWO_CAPTURE_ACTIVE) {
+    TracePending = 0U;
+    TraceIn += swo_uart_abort();
+  }
+
+  baudrate = swo_uart_set_baudrate(baudrate);
+  USART_Ready = (baudrate != 0U) ? 1U : 0U;
+
+  if ((TraceStatus & DAP_SWO_CAPTURE_ACTIVE) && USART_Ready) {
+    count = GetTraceSpace();
+    if (count != 0U) {
+      UART_SWO_Capture(&TraceBuf[TraceIn & (SWO_BUFFER_SIZE-1U)], count);
+      TraceStatus = DAP_SWO_CAPTURE_ACTIVE;
+    } else {
+      TraceStatus = DAP_SWO_CAPTURE_ACTIVE | DAP_SWO_CAPTURE_PAUSED;
+    }
+  }
+
+  return (baudrate);
+}
+
+// Control UART SWO Capture
+//   active: active flag
+//   return: 1 - Success, 0 - Error
+uint32_t UART_SWO_Control (uint32_t active) {
+
+  if (active) {
+    if (!USART_Ready) { return (0U); }
+    UART_SWO_Capture(TraceBuf, SWO_BUFFER_SIZE);
+  } else {
+    TracePending = 0U;
+    TraceIn += swo_uart_abort();
+  }
+  return (1U);
+}
+
+// Start UART SWO Capture
+//   buf:   pointer to buffer for capturing
+//   count: number of bytes to capture
+void UART_SWO_Capture (uint8_t *buf, uint32_t count) {
+  // Completing in blocks keeps TraceIn current for streaming
+  if (count > SWO_UART_BLOCK_SIZE) {
+    count = SWO_UART_BLOCK_SIZE;
+  }
+  swo_uart_receive(buf, count);
+}
+
+// Update UART SWO Trace Info
+void UART_SWO_Update (void) {
+  cortex_int_state_t state;
+
+  // A completion in between would count the same bytes twice
+  state = cortex_int_get_and_disable();
+  TracePending = swo_uart_rx_count();
+  cortex_int_restore(state);
+}
+
+#endif  /* (SWO_UART != 0) && (SWO_UART_NATIVE != 0) */
 
 
 #if (SWO_MANCHESTER != 0)
 
+// Manchester SWO edge capture block completed (interrupt context)
+void swo_manchester_event (void) {
+  main_swo_event();
+}
+
 // Enable or disable Manchester SWO Mode
 //   enable: enable flag
 //   return: 1 - Success, 0 - Error
-__weak uint32_t Manchester_SWO_Mode (uint32_t enable) {
-  return (0U);
+uint32_t Manchester_SWO_Mode (uint32_t enable) {
+  uint32_t clock;
+
+  if (enable) {
+    // Start bits up to twice the maximum rate are accepted. The longest
+    // edge gap in a packet, a period and a quarter, has to stay below
+    // the half timestamp wrap the driver reports as the line idling.
+    clock = swo_manchester_clock();
+    ManchesterMinHalf = (uint16_t)(clock / (4U * SWO_MANCHESTER_MAX_BAUDRATE));
+    if (ManchesterMinHalf < 2U) {
+      ManchesterMinHalf = 2U;
+    }
+    ManchesterMaxHalf = 0xFFFFU / 8U;
+    ManchesterReset = 1U;
+    return (swo_manchester_initialize());
+  }
+  swo_manchester_uninitialize();
+  return (1U);
 }
 
 // Configure Manchester SWO Baudrate
 //   baudrate: requested baudrate
 //   return:   actual baudrate or 0 when not configured
-__weak uint32_t Manchester_SWO_Baudrate (uint32_t baudrate) {
-  return (0U);
+uint32_t Manchester_SWO_Baudrate (uint32_t baudrate) {
+  uint32_t min;
+
+  // The bit period is measured from the start bit of every packet,
+  // so any rate in range is received without reconfiguring
+  min = swo_manchester_clock() / (2U * ManchesterMaxHalf) + 1U;
+  if (baudrate > SWO_MANCHESTER_MAX_BAUDRATE) {
+    baudrate = SWO_MANCHESTER_MAX_BAUDRATE;
+  }
+  if (baudrate < min) {
+    baudrate = min;
+  }
+  return (baudrate);
 }
 
 // Control Manchester SWO Capture
 //   active: active flag
 //   return: 1 - Success, 0 - Error
-__weak uint32_t Manchester_SWO_Control (uint32_t active) {
-  return (0U);
+uint32_t Manchester_SWO_Control (uint32_t active) {
+
+  if (active) {
+    ManchesterReset = 1U;
+    swo_manchester_start();
+  } else {
+    swo_manchester_stop();
+  }
+  return (1U);
 }
 
 // Start Manchester SWO Capture
 //   buf:   pointer to buffer for capturing
 //   count: number of bytes to capture
-__weak void Manchester_SWO_Capture (uint8_t *buf, uint32_t count) {
+void Manchester_SWO_Capture (uint8_t *buf, uint32_t count) {
+  // Edges are still being captured, the next decode picks them up
 }
 
 // Update Manchester SWO Trace Info
-__weak void Manchester_SWO_Update (void) {
+void Manchester_SWO_Update (void) {
+  // Bytes are placed in the trace buffer as they are decoded
+  TracePending = 0U;
+}
+
+// End the packet being received, the line is idle
+static void Manchester_SWO_Idle (void) {
+  if (ManchesterBits != 0U) {
+    SetTraceError(DAP_SWO_STREAM_ERROR);
+  }
+  ManchesterState = MANCHESTER_IDLE;
+  ManchesterLevel = 0U;
+  ManchesterBits  = 0U;
+}
+
+// Decode captured Manchester SWO edges into the trace buffer. Runs in
+// the main task; the bit period is taken from the start bit of each
+// packet and then tracked over its mid-bit edges.
+static void Manchester_SWO_Decode (void) {
+  const uint16_t *edges;
+  uint32_t count;
+  uint32_t space;
+  uint32_t n;
+  uint16_t t;
+  uint16_t d;
+  uint16_t q;
+
+  if (ManchesterReset) {
+    ManchesterReset = 0U;
+    ManchesterBits  = 0U;
+    Manchester_SWO_Idle();
+  }
+
+  if ((TraceMode != DAP_SWO_MANCHESTER) || (TraceStatus != DAP_SWO_CAPTURE_ACTIVE)) {
+    return;
+  }
+
+  space = SWO_BUFFER_SIZE - (TraceIn - TraceOut);
+
+  for (;;) {
+    // Timestamps wrap, the time since the last edge can't be told
+    // once the line has been quiet for long
+    if (swo_manchester_idle()) {
+      Manchester_SWO_Idle();
+    }
+    count = swo_manchester_read(&edges);
+    if (swo_manchester_overrun()) {
+      SetTraceError(DAP_SWO_BUFFER_OVERRUN);
+      ManchesterBits = 0U;
+      Manchester_SWO_Idle();
+    }
+    if (count == 0U) {
+      break;
+    }
+
+    for (n = 0U; n < count; n++) {
+      if (space == 0U) {
+        TraceStatus = DAP_SWO_CAPTURE_ACTIVE | DAP_SWO_CAPTURE_PAUSED;
+        break;
+      }
+      t = edges[n];
+      d = (uint16_t)(t - ManchesterEdge);
+      ManchesterLevel ^= 1U;
+      switch (ManchesterState) {
+        case MANCHESTER_IDLE:
+          // The line idles low, a packet starts with a rising edge
+          ManchesterLevel = 1U;
+          ManchesterEdge  = t;
+          ManchesterState = MANCHESTER_START;
+          break;
+        case MANCHESTER_START:
+          // Falling in the middle of the start bit gives the bit period
+          if ((d < ManchesterMinHalf) || (d > ManchesterMaxHalf)) {
+            ManchesterLevel = 1U;
+            ManchesterEdge  = t;
+            break;
+          }
+          ManchesterPeriod = 2U * d;
+          ManchesterEdge   = t;
+          ManchesterData   = 0U;
+          ManchesterBits   = 0U;
+          ManchesterState  = MANCHESTER_DATA;
+          break;
+        default:
+          q = ManchesterPeriod / 4U;
+          if (d < q) {
+            // Glitch, wait for the next packet
+            SetTraceError(DAP_SWO_STREAM_ERROR);
+            ManchesterBits = 0U;
+            Manchester_SWO_Idle();
+          } else if (d < (ManchesterPeriod - q)) {
+            // Edge between two bits
+          } else if (d < (ManchesterPeriod + q)) {
+            // Mid-bit edge: falling is a 1, rising a 0
+            ManchesterData >>= 1;
+            if (ManchesterLevel == 0U) {
+              ManchesterData |= 0x80U;
+            }
+            ManchesterPeriod = (uint16_t)((3U * ManchesterPeriod + d) / 4U);
+            ManchesterEdge   = t;
+            if (++ManchesterBits == 8U) {
+              ManchesterBits = 0U;
+              TraceBuf[TraceIn & (SWO_BUFFER_SIZE-1U)] = ManchesterData;
+              TraceIn++;
+              space--;
+            }
+          } else {
+            // The packet has ended, this edge starts the next one
+            Manchester_SWO_Idle();
+            ManchesterLevel = 1U;
+            ManchesterEdge  = t;
+            ManchesterState = MANCHESTER_START;
+          }
+          break;
+      }
+    }
+    swo_manchester_release(n);
+    if (n != count) {
+      break;
+    }
+  }
 }
 
 #endif  /* (SWO_MANCHESTER != 0) */
@@ -308,6 +634,63 @@ static void SetTraceError (uint8_t flag) {
   TraceError[TraceError_n] |= flag;
 }
 
+// Update Trace Pending Count from the capture in progress
+static void UpdateTrace (void) {
+
+  if (TraceStatus == DAP_SWO_CAPTURE_ACTIVE) {
+    switch (TraceMode) {
+#if (SWO_UART != 0)
+      case DAP_SWO_UART:
+        UART_SWO_Update();
+        break;
+#endif
+#if (SWO_MANCHESTER != 0)
+      case DAP_SWO_MANCHESTER:
+        Manchester_SWO_Update();
+        break;
+#endif
+      default:
+        break;
+    }
+  }
+}
+
+// Resume a Trace Capture paused on a full buffer
+static void ResumeTrace (void) {
+  uint32_t n;
+
+  if (TraceStatus == (DAP_SWO_CAPTURE_ACTIVE | DAP_SWO_CAPTURE_PAUSED)) {
+    n = GetTraceSpace();
+    if (n != 0U) {
+      switch (TraceMode) {
+#if (SWO_UART != 0)
+        case DAP_SWO_UART:
+          UART_SWO_Capture(&TraceBuf[TraceIn & (SWO_BUFFER_SIZE-1U)], n);
+          TraceStatus = DAP_SWO_CAPTURE_ACTIVE;
+          break;
+#endif
+#if (SWO_MANCHESTER != 0)
+        case DAP_SWO_MANCHESTER:
+          Manchester_SWO_Capture(&TraceBuf[TraceIn & (SWO_BUFFER_SIZE-1U)], n);
+          TraceStatus = DAP_SWO_CAPTURE_ACTIVE;
+          break;
+#endif
+        default:
+          break;
+      }
+    }
+  }
+}
+
+// Stop streaming, the transfer in progress is dropped
+static void StopTransfer (void) {
+#if (SWO_STREAM != 0)
+  if (TransferBusy) {
+    TransferAbort = 1U;
+  }
+#endif
+}
+
 
 // Process SWO Transport command and prepare response
 //   request:  pointer to request data
@@ -323,6 +706,9 @@ uint32_t SWO_Transport (const uint8_t *request, uint8_t *response) {
     switch (transport) {
       case 0:
       case 1:
+#if (SWO_STREAM != 0)
+      case 2:
+#endif
         TraceTransport = transport;
         result = 1U;
         break;
@@ -369,6 +755,7 @@ uint32_t SWO_Mode (const uint8_t *request, uint8_t *response) {
     default:
       break;
   }
+  StopTransfer();
   switch (mode) {
     case DAP_SWO_OFF:
       result = 1U;
@@ -461,6 +848,8 @@ uint32_t SWO_Control (const uint8_t *request, uint8_t *response) {
   if (active != (TraceStatus & DAP_SWO_CAPTURE_ACTIVE)) {
     if (active) {
       ClearTrace();
+    } else {
+      StopTransfer();
     }
     switch (TraceMode) {
 #if (SWO_UART != 0)
@@ -501,22 +890,7 @@ uint32_t SWO_Status (uint8_t *response) {
   uint8_t  status;
   uint32_t count;
 
-  if (TraceStatus == DAP_SWO_CAPTURE_ACTIVE) {
-    switch (TraceMode) {
-#if (SWO_UART != 0)
-      case DAP_SWO_UART:
-        UART_SWO_Update();
-        break;
-#endif
-#if (SWO_MANCHESTER != 0)
-      case DAP_SWO_MANCHESTER:
-        Manchester_SWO_Update();
-        break;
-#endif
-      default:
-        break;
-    }
-  }
+  UpdateTrace();
 
   status = GetTraceStatus();
   count  = GetTraceCount();
@@ -541,22 +915,7 @@ uint32_t SWO_Data (const uint8_t *request, uint8_t *response) {
   uint32_t count;
   uint32_t n;
 
-  if (TraceStatus == DAP_SWO_CAPTURE_ACTIVE) {
-    switch (TraceMode) {
-#if (SWO_UART != 0)
-      case DAP_SWO_UART:
-        UART_SWO_Update();
-        break;
-#endif
-#if (SWO_MANCHESTER != 0)
-      case DAP_SWO_MANCHESTER:
-        Manchester_SWO_Update();
-        break;
-#endif
-      default:
-        break;
-    }
-  }
+  UpdateTrace();
 
   status = GetTraceStatus();
   count  = GetTraceCount();
@@ -579,30 +938,99 @@ uint32_t SWO_Data (const uint8_t *request, uint8_t *response) {
     *response++ = TraceBuf[TraceOut++ & (SWO_BUFFER_SIZE-1U)];
   }
 
-  if (TraceStatus == (DAP_SWO_CAPTURE_ACTIVE | DAP_SWO_CAPTURE_PAUSED)) {
-    n = GetTraceSpace();
-    if (n != 0U) {
-      switch (TraceMode) {
-#if (SWO_UART != 0)
-        case DAP_SWO_UART:
-          UART_SWO_Capture(&TraceBuf[TraceIn & (SWO_BUFFER_SIZE-1U)], n);
-          TraceStatus = DAP_SWO_CAPTURE_ACTIVE;
-          break;
-#endif
-#if (SWO_MANCHESTER != 0)
-        case DAP_SWO_MANCHESTER:
-          Manchester_SWO_Capture(&TraceBuf[TraceIn & (SWO_BUFFER_SIZE-1U)], n);
-          TraceStatus = DAP_SWO_CAPTURE_ACTIVE;
-          break;
-#endif
-        default:
-          break;
-      }
-    }
+  // The streaming side resumes capture itself
+  if (TraceTransport != 2U) {
+    ResumeTrace();
   }
 
   return ((2U << 16) | (3U + count));
 }
 
 
+#if (SWO_STREAM != 0)
+
+// Send captured trace data over the streaming endpoint. Called from the
+// USB thread when data was captured, when a transfer completed and
+// periodically to flush data that does not fill a whole packet.
+//   flush: also send data that does not end on a packet boundary
+void SWO_StreamProcess (uint32_t flush) {
+  uint32_t index;
+  uint32_t count;
+  uint32_t n;
+
+  if (TransferAbort) {
+    if (TransferBusy) {
+      SWO_AbortTransfer();
+      return;
+    }
+    TransferAbort = 0U;
+  }
+
+  if ((TraceTransport != 2U) || TransferBusy ||
+      !(TraceStatus & DAP_SWO_CAPTURE_ACTIVE)) {
+    return;
+  }
+
+  UpdateTrace();
+
+  count = GetTraceCount();
+  if (count == 0U) {
+    return;
+  }
+
+  index = TraceOut & (SWO_BUFFER_SIZE-1U);
+  n = SWO_BUFFER_SIZE - index;
+  if (count > n) {
+    count = n;
+  }
+  if (!flush) {
+    n = index & (DAP_PACKET_SIZE-1U);
+    if (n == 0U) {
+      count &= ~(DAP_PACKET_SIZE-1U);
+    } else {
+      n = DAP_PACKET_SIZE - n;
+      count = (count >= n) ? n : 0U;
+    }
+  }
+
+  if (count != 0U) {
+    TransferSize = count;
+    TransferBusy = 1U;
+    SWO_QueueTransfer(&TraceBuf[index], count);
+  }
+}
+
+// Streaming transfer completed, called from the USB thread
+void SWO_TransferComplete (void) {
+  cortex_int_state_t state;
+
+  // The DAP task may stop and restart the trace in between
+  state = cortex_int_get_and_disable();
+  if (!TransferAbort) {
+    TraceOut += TransferSize;
+  }
+  TransferAbort = 0U;
+  TransferBusy  = 0U;
+  ResumeTrace();
+  cortex_int_restore(state);
+
+  SWO_StreamProcess(0U);
+}
+
+#endif  /* (SWO_STREAM != 0) */
+
+
 #endif  /* ((SWO_UART != 0) || (SWO_MANCHESTER != 0)) */
+
+
+// Run the SWO work that is done outside of the DAP commands. Called from
+// the main task when trace data was captured and periodically.
+//   flush: periodic call, also handles data that is not complete yet
+void SWO_Process (uint32_t flush) {
+#if (SWO_MANCHESTER != 0)
+  Manchester_SWO_Decode();
+#endif
+#if (SWO_STREAM != 0)
+  SWO_StreamProcess(flush);
+#endif
+}
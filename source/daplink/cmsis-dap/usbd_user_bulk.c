@@ -0,0 +1,231 @@
+/**
+ * @file    usbd_user_bulk.c
+ * @brief   Bulk driver for CMSIS-DAP packet processing
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "string.h"
+#include "RTL.h"
+#include "rl_usb.h"
+#include "usb.h"
+#define __NO_USB_LIB_C
+#include "usb_config.c"
+#include "DAP_config.h"
+#include "DAP.h"
+#include "util.h"
+
+#if (SWO_STREAM != 0) && !((USBD_BULK_ENABLE) && (USBD_BULK_EP_SWOIN != 0))
+#error "SWO streaming needs the bulk SWO trace endpoint"
+#endif
+
+#if (USBD_BULK_ENABLE)
+
+#if (USBD_BULK_WMAXPACKETSIZE < DAP_PACKET_SIZE)
+#error "USB Bulk Max Packet Size must hold a whole DAP Packet"
+#endif
+
+#define FREE_COUNT_INIT          (DAP_PACKET_COUNT)
+#define SEND_COUNT_INIT          0
+
+static uint8_t USB_BulkRequest [DAP_PACKET_COUNT][DAP_PACKET_SIZE];  // Request  Buffer
+
+// Request buffers free for the USB thread, given back by the DAP task
+static OS_SEM bulk_free_sem;
+
+// Only used on USB thread
+static uint32_t send_count;
+static uint32_t recv_idx;
+static uint32_t send_idx;
+static uint8_t *send_queue[DAP_RESPONSE_COUNT];
+static uint16_t send_len[DAP_RESPONSE_COUNT];
+static uint8_t *bulk_in_buf;
+static uint8_t  bulk_out_pending;
+
+#if (SWO_STREAM != 0)
+// SWO trace transfer in progress, only used on USB thread
+static uint8_t *swo_buf;
+static uint32_t swo_remaining;
+static uint8_t  swo_busy;
+#endif
+
+extern void dap_queue_request(U8 *buf);
+extern void dap_response_release(U8 *buf);
+
+static void bulk_send_packet(void)
+{
+    if (send_count) {
+        send_count--;
+        bulk_in_buf = send_queue[send_idx];
+        // Bulk transfers end with a short packet, so only the
+        // response itself is sent
+        usbd_bulk_write(bulk_in_buf, send_len[send_idx]);
+        send_idx = (send_idx + 1) % DAP_RESPONSE_COUNT;
+    } else {
+        bulk_in_buf = NULL;
+    }
+}
+
+// USB Bulk Callback: when system initializes
+void usbd_bulk_init(void)
+{
+    recv_idx = 0;
+    send_idx = 0;
+    bulk_in_buf = NULL;
+    bulk_out_pending = 0;
+    send_count = SEND_COUNT_INIT;
+    os_sem_init(&bulk_free_sem, FREE_COUNT_INIT);
+
+#if (SWO_STREAM != 0)
+    // A transfer cut by a bus reset will never complete
+    swo_remaining = 0;
+    if (swo_busy) {
+        swo_busy = 0;
+        SWO_TransferComplete();
+    }
+#endif
+}
+
+// USB Bulk Callback: when data is received from the host
+void usbd_bulk_data_received(void)
+{
+    U32 len;
+
+    // Leave the packet in the endpoint so the host is NAKed until
+    // a request buffer is free again
+    if (OS_R_TMO == os_sem_wait(&bulk_free_sem, 0)) {
+        bulk_out_pending = 1;
+        return;
+    }
+
+    bulk_out_pending = 0;
+    len = usbd_bulk_read(USB_BulkRequest[recv_idx], DAP_PACKET_SIZE);
+
+    if ((len == 0) || (USB_BulkRequest[recv_idx][0] == ID_DAP_TransferAbort)) {
+        if (len != 0) {
+            DAP_TransferAbort = 1;
+        }
+        os_sem_send(&bulk_free_sem);
+        return;
+    }
+
+    dap_queue_request(USB_BulkRequest[recv_idx]);
+    recv_idx = (recv_idx + 1) % DAP_PACKET_COUNT;
+}
+
+// USB Bulk Callback: when the host has taken a response
+void usbd_bulk_data_sent(void)
+{
+    // The buffer holding the response is free again
+    if (bulk_in_buf) {
+        dap_response_release(bulk_in_buf);
+    }
+
+    bulk_send_packet();
+}
+
+// Called from the USB thread with a response of len bytes completed by
+// the DAP task. owner is the request the response belongs to. Returns
+// __FALSE if the request did not come in over the bulk transport.
+BOOL bulk_send_response(U8 *buf, U8 *owner, U32 len)
+{
+    if ((owner < USB_BulkRequest[0]) || (owner >= USB_BulkRequest[DAP_PACKET_COUNT])) {
+        return (__FALSE);
+    }
+
+    send_len[(send_idx + send_count) % DAP_RESPONSE_COUNT] = len;
+    send_queue[(send_idx + send_count) % DAP_RESPONSE_COUNT] = buf;
+    send_count++;
+
+    if (bulk_in_buf == NULL) {
+        bulk_send_packet();
+    }
+
+    return (__TRUE);
+}
+
+// Called from the DAP task once it is done with a request buffer.
+// Returns __FALSE if the buffer does not belong to the bulk transport.
+BOOL bulk_release_request(U8 *buf)
+{
+    if ((buf < USB_BulkRequest[0]) || (buf >= USB_BulkRequest[DAP_PACKET_COUNT])) {
+        return (__FALSE);
+    }
+
+    os_sem_send(&bulk_free_sem);
+    return (__TRUE);
+}
+
+// Called from the USB thread to read a packet the host was NAKed for
+void bulk_receive_pending(void)
+{
+    if (bulk_out_pending) {
+        usbd_bulk_data_received();
+    }
+}
+
+#if (SWO_STREAM != 0)
+
+static void bulk_swo_send_packet(void)
+{
+    uint32_t max = USBD_HighSpeed ? USBD_BULK_HS_WMAXPACKETSIZE : USBD_BULK_WMAXPACKETSIZE;
+    uint32_t len = swo_remaining;
+
+    if (len > max) {
+        len = max;
+    }
+
+    swo_busy = 1;
+    usbd_bulk_swo_write(swo_buf, len);
+    swo_buf += len;
+    swo_remaining -= len;
+}
+
+// Called from the USB thread by SWO.c to send captured trace data
+void SWO_QueueTransfer(uint8_t *buf, uint32_t num)
+{
+    swo_buf = buf;
+    swo_remaining = num;
+
+    if (!swo_busy) {
+        bulk_swo_send_packet();
+    }
+}
+
+// Called from the USB thread by SWO.c to drop the rest of the transfer.
+// Completion is still reported once the packet on the endpoint is gone.
+void SWO_AbortTransfer(void)
+{
+    swo_remaining = 0;
+}
+
+// USB Bulk Callback: when the host has taken trace data
+void usbd_bulk_swo_sent(void)
+{
+    swo_busy = 0;
+
+    if (swo_remaining) {
+        bulk_swo_send_packet();
+        return;
+    }
+
+    SWO_TransferComplete();
+}
+
+#endif
+
+#endif
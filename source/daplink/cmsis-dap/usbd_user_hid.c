@@ -28,6 +28,8 @@
 #include "DAP_config.h"
 #include "DAP.h"
 #include "util.h"
+#include "rtt.h"
+#include "swd_host.h"
 
 #include "main.h"
 
@@ -38,37 +40,96 @@
 #error "USB HID Input Report Size must match DAP Packet Size"
 #endif
 
+#if (DAP_RESPONSE_COUNT < 2)
+#error "DAP Response Count must be at least 2 for streaming commands"
+#endif
+
 #define FREE_COUNT_INIT          (DAP_PACKET_COUNT)
 #define SEND_COUNT_INIT          0
 
-static uint8_t USB_Request [DAP_PACKET_COUNT][DAP_PACKET_SIZE];  // Request  Buffer
+static uint8_t USB_Request [DAP_PACKET_COUNT][DAP_PACKET_SIZE];      // Request  Buffer
+static uint8_t DAP_Response[DAP_RESPONSE_COUNT][DAP_PACKET_SIZE];    // Response Buffer
 
-static uint32_t free_count;
-static uint32_t send_count;
+// Requests queued for the DAP task, responses it has completed and
+// response buffers free for it to use. The bulk transport shares the
+// DAP task and the response buffers.
+#define DAP_QUEUE_COUNT          (DAP_PACKET_COUNT * (1 + USBD_BULK_ENABLE))
+
+static os_mbx_declare(dap_request_mbx, DAP_QUEUE_COUNT);
+static os_mbx_declare(dap_response_mbx, DAP_RESPONSE_COUNT);
+static os_mbx_declare(dap_free_mbx, DAP_RESPONSE_COUNT);
+
+// Request buffers free for the USB thread, given back by the DAP task
+static OS_SEM request_free_sem;
+
+// Request each response buffer was filled for, so the response
+// goes back over the transport the request came from
+static uint8_t *dap_response_owner[DAP_RESPONSE_COUNT];
+// Number of bytes in each response, HID always sends whole reports
+static uint16_t dap_response_len[DAP_RESPONSE_COUNT];
+
+// Only used on DAP thread
+static uint8_t *dap_current;
+static uint8_t *dap_queued[DAP_PACKET_COUNT];
+static uint32_t dap_queued_count;
 
 // Only used on USB thread
+static uint32_t send_count;
 static uint32_t recv_idx;
 static uint32_t send_idx;
+static uint8_t *send_queue[DAP_RESPONSE_COUNT];
 static volatile uint8_t  USB_ResponseIdle;
 
+void dap_queue_request(U8 *buf);
+#if (USBD_BULK_ENABLE)
+extern BOOL bulk_send_response(U8 *buf, U8 *owner, U32 len);
+extern BOOL bulk_release_request(U8 *buf);
+extern void bulk_receive_pending(void);
+#endif
+
+// Return a response buffer to the DAP task once it has been sent
+void dap_response_release(U8 *buf)
+{
+    os_mbx_send(&dap_free_mbx, buf, 0);
+}
+
+static uint8_t *hid_next_response(void)
+{
+    uint8_t *buf = send_queue[send_idx];
+
+    send_count--;
+    send_idx = (send_idx + 1) % DAP_RESPONSE_COUNT;
+    return buf;
+}
+
 void hid_send_packet()
 {
+    uint8_t *buf;
+
     if (send_count) {
-        send_count--;
-        usbd_hid_get_report_trigger(0, USB_Request[send_idx], DAP_PACKET_SIZE);
-        send_idx = (send_idx + 1) % DAP_PACKET_COUNT;
-        free_count++;
+        buf = hid_next_response();
+        usbd_hid_get_report_trigger(0, buf, DAP_PACKET_SIZE);
+        dap_response_release(buf);
     }
 }
 
 // USB HID Callback: when system initializes
 void usbd_hid_init(void)
 {
+    uint32_t i;
+
     recv_idx = 0;
     send_idx = 0;
     USB_ResponseIdle = 1;
-    free_count = FREE_COUNT_INIT;
     send_count = SEND_COUNT_INIT;
+    os_sem_init(&request_free_sem, FREE_COUNT_INIT);
+    os_mbx_init(&dap_request_mbx, sizeof(dap_request_mbx));
+    os_mbx_init(&dap_response_mbx, sizeof(dap_response_mbx));
+    os_mbx_init(&dap_free_mbx, sizeof(dap_free_mbx));
+
+    for (i = 0; i < DAP_RESPONSE_COUNT; i++) {
+        os_mbx_send(&dap_free_mbx, DAP_Response[i], 0);
+    }
 }
 
 // USB HID Callback: when data needs to be prepared for the host
@@ -83,10 +144,9 @@ int usbd_hid_get_report(U8 rtype, U8 rid, U8 *buf, U8 req)
                 case USBD_HID_REQ_EP_CTRL:
                 case USBD_HID_REQ_EP_INT:
                     if (send_count > 0) {
-                        send_count--;
-                        memcpy(buf, USB_Request[send_idx], DAP_PACKET_SIZE);
-                        send_idx = (send_idx + 1) % DAP_PACKET_COUNT;
-                        free_count++;
+                        uint8_t *response = hid_next_response();
+                        memcpy(buf, response, DAP_PACKET_SIZE);
+                        dap_response_release(response);
                         return (DAP_PACKET_SIZE);
                     } else if (req == USBD_HID_REQ_EP_INT) {
                         USB_ResponseIdle = 1;
@@ -113,7 +173,6 @@ uint8_t usbd_hid_no_activity(U8 *buf)
 // USB HID Callback: when data is received from the host
 void usbd_hid_set_report(U8 rtype, U8 rid, U8 *buf, int len, U8 req)
 {
-    main_led_state_t led_next_state = MAIN_LED_FLASH;
     switch (rtype) {
         case HID_REPORT_OUTPUT:
             if (len == 0) {
@@ -125,27 +184,15 @@ void usbd_hid_set_report(U8 rtype, U8 rid, U8 *buf, int len, U8 req)
                 break;
             }
 
-            // Store data into request packet buffer
+            // Store data into request packet buffer and hand it to the DAP task
             // If there are no free buffers discard the data
-            if (free_count > 0) {
-                free_count--;
+            if (OS_R_TMO != os_sem_wait(&request_free_sem, 0)) {
                 memcpy(USB_Request[recv_idx], buf, len);
-                DAP_ExecuteCommand(buf, USB_Request[recv_idx]);
-                if(usbd_hid_no_activity(USB_Request[recv_idx]) == 1){
-                    //revert HID LED to default if the response is null
-                    led_next_state = MAIN_LED_DEF;
-                }
+                dap_queue_request(USB_Request[recv_idx]);
                 recv_idx = (recv_idx + 1) % DAP_PACKET_COUNT;
-                send_count++;
-                if (USB_ResponseIdle) {
-                    hid_send_packet();
-                    USB_ResponseIdle = 0;
-                }
             } else {
                 util_assert(0);
             }
-            
-            main_blink_hid_led(led_next_state);
 
             break;
 
@@ -154,4 +201,172 @@ void usbd_hid_set_report(U8 rtype, U8 rid, U8 *buf, int len, U8 req)
     }
 }
 
+// Called from the USB thread to hand a request buffer to the DAP task
+void dap_queue_request(U8 *buf)
+{
+    os_mbx_send(&dap_request_mbx, buf, 0);
+}
+
+// Called from the USB thread when the DAP task has completed responses.
+// Responses are returned to the transport the request came from.
+void hid_send_responses(void)
+{
+    void *response;
+
+    while (OS_R_OK == os_mbx_wait(&dap_response_mbx, &response, 0)) {
+#if (USBD_BULK_ENABLE)
+        uint32_t index = ((uint8_t *)response - DAP_Response[0]) / DAP_PACKET_SIZE;
+
+        if (bulk_send_response(response, dap_response_owner[index], dap_response_len[index])) {
+            continue;
+        }
+#endif
+        send_queue[(send_idx + send_count) % DAP_RESPONSE_COUNT] = response;
+        send_count++;
+    }
+
+#if (USBD_BULK_ENABLE)
+    // Request buffers may have been freed since the host was NAKed
+    bulk_receive_pending();
+#endif
+
+    if (send_count && USB_ResponseIdle) {
+        hid_send_packet();
+        USB_ResponseIdle = 0;
+    }
+}
+
+// Get a free response buffer for the request being executed
+static uint8_t *dap_response_alloc(uint16_t timeout)
+{
+    void *buf;
+
+    if (OS_R_OK != os_mbx_wait(&dap_free_mbx, &buf, timeout)) {
+        return NULL;
+    }
+
+    dap_response_owner[((uint8_t *)buf - DAP_Response[0]) / DAP_PACKET_SIZE] = dap_current;
+    return buf;
+}
+
+// Give a request buffer back to the transport it came from
+static void dap_request_release(uint8_t *buf)
+{
+#if (USBD_BULK_ENABLE)
+    if (bulk_release_request(buf)) {
+        return;
+    }
+#endif
+    os_sem_send(&request_free_sem);
+}
+
+static void dap_execute(uint8_t *request)
+{
+    uint8_t *response;
+    uint32_t len;
+    main_led_state_t led_next_state;
+
+    dap_current = request;
+    response = dap_response_alloc(0xFFFF);
+
+    // The response buffer is taken first since the USB thread frees them
+    // and may itself be waiting for the lock
+    swd_lock();
+    len = DAP_ExecuteCommand(request, response) & 0xFFFF;
+    swd_unlock();
+    dap_response_len[(response - DAP_Response[0]) / DAP_PACKET_SIZE] = len;
+    dap_request_release(request);
+    led_next_state = MAIN_LED_FLASH;
+    if (usbd_hid_no_activity(response) == 1) {
+        //revert HID LED to default if the response is null
+        led_next_state = MAIN_LED_DEF;
+    }
+    main_blink_hid_led(led_next_state);
+    os_mbx_send(&dap_response_mbx, response, 0xFFFF);
+    main_hid_send_event();
+}
+
+// Execute DAP commands so long running commands do not hold up USB.
+// Requests are completed in the order they were received, so responses
+// are sent in the same order as the requests arrived.
+//
+// Queued commands are held until a packet that is not queued arrives and
+// then executed back to back with it. They are answered like
+// ID_DAP_ExecuteCommands. The queue is also run once it holds as many
+// packets as the host may have outstanding, since no more can arrive.
+//
+// The RTT bridge is polled while there are no requests, so it never uses
+// SWD in the middle of a command.
+__task void hid_process(void)
+{
+    uint8_t *buf;
+    uint32_t i;
+    uint16_t timeout = 0;
+
+    while (1) {
+        if (OS_R_TMO == os_mbx_wait(&dap_request_mbx, (void **)&buf, timeout)) {
+            if (dap_queued_count == 0) {
+                swd_lock();
+                timeout = rtt_process();
+                swd_unlock();
+            } else {
+                timeout = 0xFFFF;
+            }
+            continue;
+        }
 
+        if (buf[0] == ID_DAP_QueueCommands) {
+            buf[0] = ID_DAP_ExecuteCommands;
+            dap_queued[dap_queued_count++] = buf;
+            if (dap_queued_count < DAP_PACKET_COUNT) {
+                continue;
+            }
+            buf = NULL;
+        }
+
+        for (i = 0; i < dap_queued_count; i++) {
+            dap_execute(dap_queued[i]);
+        }
+        dap_queued_count = 0;
+
+        if (buf != NULL) {
+            dap_execute(buf);
+        }
+    }
+}
+
+// Called from the DAP task by a streaming command to get a buffer for
+// an extra response packet. Returns NULL if the transfer was aborted
+// while waiting for the host to take earlier packets.
+uint8_t *dap_stream_alloc(void)
+{
+    uint8_t *buf;
+
+    while ((buf = dap_response_alloc(10)) == NULL) {
+        if (DAP_TransferAbort) {
+            return NULL;
+        }
+
+        // Buffers are freed by the USB thread, so let it have the
+        // target if it is waiting for it
+        swd_unlock();
+        swd_lock();
+    }
+
+    return buf;
+}
+
+// Called from the DAP task to send a stream buffer holding len bytes
+// ahead of the response to the request being executed
+void dap_stream_send(uint8_t *buf, uint32_t len)
+{
+    dap_response_len[(buf - DAP_Response[0]) / DAP_PACKET_SIZE] = len;
+    os_mbx_send(&dap_response_mbx, buf, 0xFFFF);
+    main_hid_send_event();
+}
+
+// Called from the DAP task to give back a stream buffer it will not send
+void dap_stream_free(uint8_t *buf)
+{
+    os_mbx_send(&dap_free_mbx, buf, 0xFFFF);
+}
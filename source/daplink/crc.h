@@ -27,7 +27,15 @@
 extern "C" {
 #endif
 
+// Incremental CRC-32 for data that arrives in parts
+typedef struct {
+    uint32_t remainder;
+} crc32_ctx_t;
+
 uint16_t crc16(const void *data, int nBytes);
+void crc32_init(crc32_ctx_t *ctx);
+void crc32_update(crc32_ctx_t *ctx, const void *data, uint32_t nBytes);
+uint32_t crc32_final(const crc32_ctx_t *ctx);
 uint32_t crc32(const void *data, int nBytes);
 uint32_t crc32_continue(uint32_t prev_crc, const void *data, int nBytes);
 
@@ -60,12 +60,121 @@ typedef struct {
 
 typedef struct {
     bool parsing_complete;
-    uint8_t bin_buffer[256];
+    error_t status;                 // Last result of the flash decoder
 } hex_state_t;
 
+// ELF32 header and program header layout
+#define ELF_HEADER_SIZE     52
+#define ELF_E_PHOFF         28
+#define ELF_E_PHENTSIZE     42
+#define ELF_E_PHNUM         44
+#define ELF_PHDR_SIZE       32
+#define ELF_P_TYPE          0
+#define ELF_P_OFFSET        4
+#define ELF_P_PADDR         12
+#define ELF_P_FILESZ        16
+#define ELF_PT_LOAD         1
+
+#define ELF_MAX_SEGMENTS    16
+
+typedef struct {
+    uint32_t offset;                // In the file
+    uint32_t addr;                  // Physical address it is loaded at
+    uint32_t size;                  // Bytes in the file
+} elf_segment_t;
+
+typedef struct {
+    uint8_t header_buf[ELF_HEADER_SIZE];    // ELF header, then one program header at a time
+    uint8_t buf_pos;
+    uint8_t segment_count;
+    uint8_t segment;                // Segment being programmed
+    uint16_t phdr_size;
+    uint16_t phdr_left;             // Program headers not parsed yet
+    uint32_t phdr_offset;           // Of the next program header
+    uint32_t phdr_end;
+    uint32_t file_pos;              // Offset of the next byte written
+    elf_segment_t segments[ELF_MAX_SEGMENTS];
+} elf_state_t;
+
+// UF2 block layout
+#define UF2_BLOCK_SIZE              512
+#define UF2_PAYLOAD_MAX             476
+#define UF2_FLAG_NOT_MAIN_FLASH     0x00000001
+
+// At 256 bytes per block this covers a 512 KByte image
+#define UF2_MAX_BLOCKS              2048
+
+typedef struct {
+    uint32_t magic_start0;
+    uint32_t magic_start1;
+    uint32_t flags;
+    uint32_t target_addr;
+    uint32_t payload_size;
+    uint32_t block_no;
+    uint32_t num_blocks;
+    uint32_t file_size;             // Or the family ID
+} uf2_header_t;
+
+typedef struct {
+    uint32_t block_count;           // Blocks in the file, 0 until the first one arrives
+    uint32_t blocks_left;           // Blocks not seen yet
+    uint8_t block_seen[UF2_MAX_BLOCKS / 8];
+} uf2_state_t;
+
+// Compressed image header. The header is followed by an LZSS bit stream
+// in the heatshrink format, most significant bit first. A 1 bit is followed
+// by an 8 bit literal. A 0 bit is followed by the distance back minus one in
+// window_bits and the length minus one in lookahead_bits. The window starts
+// out as zeros. tools/compress_image.py creates these files.
+#define LZ_MAGIC                "DLZS"
+#define LZ_WINDOW_BITS          4
+#define LZ_LOOKAHEAD_BITS       5
+#define LZ_FLAGS                6
+#define LZ_ADDR                 8
+#define LZ_SIZE                 12
+#define LZ_HEADER_SIZE          16
+#define LZ_FLAG_ADDR_VALID      0x01
+
+#define LZ_WINDOW_BITS_MIN      4
+#define LZ_LOOKAHEAD_BITS_MIN   3
+// Sets the RAM used for the window. The default keeps lz_state_t close to
+// the other stream states in shared_state_t, including in bootloaders.
+// HICs with spare RAM raise it in their record.
+#ifndef LZ_WINDOW_BITS_MAX
+#define LZ_WINDOW_BITS_MAX      8
+#endif
+
+typedef enum {
+    LZ_FIELD_TAG,
+    LZ_FIELD_LITERAL,
+    LZ_FIELD_INDEX,
+    LZ_FIELD_COUNT,
+    LZ_FIELD_COPY
+} lz_field_t;
+
+typedef struct {
+    bin_state_t bin;                // Decoded data is written like a bin file
+    uint8_t header_buf[LZ_HEADER_SIZE];
+    uint8_t header_pos;
+    uint8_t window_bits;
+    uint8_t lookahead_bits;
+    uint8_t field;                  // Next field of the bit stream
+    uint8_t bit_count;
+    uint32_t bit_buf;               // Bits not decoded yet, most significant first
+    uint32_t copy_distance;
+    uint32_t copy_left;
+    uint32_t head;                  // Bytes decoded
+    uint32_t flushed;               // Bytes passed on
+    uint32_t size;                  // Bytes in the image
+    uint8_t window[1 << LZ_WINDOW_BITS_MAX];
+} lz_state_t;
+
 typedef union {
     bin_state_t bin;
     hex_state_t hex;
+    elf_state_t elf;
+    uf2_state_t uf2;
+    lz_state_t lz;
 } shared_state_t;
 
 static bool detect_bin(const uint8_t *data, uint32_t size);
@@ -78,9 +187,27 @@ static error_t open_hex(void *state);
 static error_t write_hex(void *state, const uint8_t *data, uint32_t size);
 static error_t close_hex(void *state);
 
+static bool detect_elf(const uint8_t *data, uint32_t size);
+static error_t open_elf(void *state);
+static error_t write_elf(void *state, const uint8_t *data, uint32_t size);
+static error_t close_elf(void *state);
+
+static bool detect_uf2(const uint8_t *data, uint32_t size);
+static error_t open_uf2(void *state);
+static error_t write_uf2(void *state, const uint8_t *data, uint32_t size);
+static error_t close_uf2(void *state);
+
+static bool detect_lz(const uint8_t *data, uint32_t size);
+static error_t open_lz(void *state);
+static error_t write_lz(void *state, const uint8_t *data, uint32_t size);
+static error_t close_lz(void *state);
+
 stream_t stream[] = {
     {detect_bin, open_bin, write_bin, close_bin},   // STREAM_TYPE_BIN
     {detect_hex, open_hex, write_hex, close_hex},   // STREAM_TYPE_HEX
+    {detect_elf, open_elf, write_elf, close_elf},   // STREAM_TYPE_ELF
+    {detect_uf2, open_uf2, write_uf2, close_uf2},   // STREAM_TYPE_UF2
+    {detect_lz, open_lz, write_lz, close_lz},       // STREAM_TYPE_LZ
 };
 COMPILER_ASSERT(ELEMENTS_IN_ARRAY(stream) == STREAM_TYPE_COUNT);
 // STREAM_TYPE_NONE must not be included in count
@@ -122,6 +249,12 @@ stream_type_t stream_type_from_name(const vfs_filename_t filename)
         return STREAM_TYPE_BIN;
     } else if (0 == strncmp("HEX", &filename[8], 3)) {
         return STREAM_TYPE_HEX;
+    } else if ((0 == strncmp("ELF", &filename[8], 3)) || (0 == strncmp("AXF", &filename[8], 3))) {
+        return STREAM_TYPE_ELF;
+    } else if (0 == strncmp("UF2", &filename[8], 3)) {
+        return STREAM_TYPE_UF2;
+    } else if (0 == strncmp("LZ ", &filename[8], 3)) {
+        return STREAM_TYPE_LZ;
     } else {
         return STREAM_TYPE_NONE;
     }
@@ -216,6 +349,15 @@ error_t stream_close(void)
     return status;
 }
 
+uint32_t stream_uf2_size(void)
+{
+    if (current_stream != &stream[STREAM_TYPE_UF2]) {
+        return 0;
+    }
+
+    return (shared_state.uf2.block_count - shared_state.uf2.blocks_left) * UF2_BLOCK_SIZE;
+}
+
 /* Binary file processing */
 
 static bool detect_bin(const uint8_t *data, uint32_t size)
@@ -318,67 +460,526 @@ static error_t open_hex(void *state)
 }
 
 
+static uint8_t *hex_span(void *context, uint32_t addr, uint32_t size, uint32_t *span_size)
+{
+    hex_state_t *hex_state = (hex_state_t *)context;
+    uint8_t *span = 0;
+
+    hex_state->status = flash_decoder_get_span(addr, size, &span, span_size);
+    return (ERROR_SUCCESS == hex_state->status) ? span : 0;
+}
+
+static bool hex_commit(void *context, uint32_t addr, uint32_t size)
+{
+    hex_state_t *hex_state = (hex_state_t *)context;
+
+    // Stop at the end of the image as well as on errors
+    hex_state->status = flash_decoder_commit(addr, size);
+    return ERROR_SUCCESS == hex_state->status;
+}
+
 static error_t write_hex(void *state, const uint8_t *data, uint32_t size)
 {
-	
-    error_t status = ERROR_SUCCESS;
     hex_state_t *hex_state = (hex_state_t *)state;
-    hexfile_parse_status_t parse_status = HEX_PARSE_UNINIT;
-    uint32_t bin_start_address = 0; // Decoded from the hex file, the binary buffer data starts at this address
-    uint32_t bin_buf_written = 0;   // The amount of data in the binary buffer starting at address above
-    uint32_t block_amt_parsed = 0;  // amount of data parsed in the block on the last call
-
-    while (1) {
-        // try to decode a block of hex data into bin data
-        parse_status = parse_hex_blob(data, size, &block_amt_parsed, hex_state->bin_buffer, sizeof(hex_state->bin_buffer), &bin_start_address, &bin_buf_written);
-
-        // the entire block of hex was decoded. This is a simple state
-        if (HEX_PARSE_OK == parse_status) {
-            if (bin_buf_written > 0) {
-								status = flash_decoder_write(bin_start_address, hex_state->bin_buffer, bin_buf_written);
+    const hex_output_t output = {hex_span, hex_commit, hex_state};
+    hexfile_parse_status_t parse_status;
+    uint32_t block_amt_parsed = 0;  // amount of data parsed in the block
+
+    // Records are decoded straight into the flash page buffer
+    hex_state->status = ERROR_SUCCESS;
+    parse_status = hex_decode(data, size, &block_amt_parsed, &output);
+
+    switch (parse_status) {
+        case HEX_PARSE_OK:
+            return ERROR_SUCCESS;
+
+        case HEX_PARSE_EOF:
+            return ERROR_SUCCESS_DONE;
+
+        case HEX_PARSE_OUTPUT_STOP:
+            return hex_state->status;
+
+        case HEX_PARSE_CKSUM_FAIL:
+            return ERROR_HEX_CKSUM;
+
+        default:
+            util_assert(HEX_PARSE_FAILURE == parse_status);
+            return ERROR_HEX_PARSER;
+    }
+}
+
+static error_t close_hex(void *state)
+{
+    error_t status;
+    status = flash_decoder_close();
+    return status;
+}
+
+/* ELF file processing */
+
+static uint32_t read_le32(const uint8_t *data)
+{
+    return (data[0] << 0) | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static uint16_t read_le16(const uint8_t *data)
+{
+    return (data[0] << 0) | (data[1] << 8);
+}
+
+static bool detect_elf(const uint8_t *data, uint32_t size)
+{
+    return (size >= ELF_HEADER_SIZE) && (1 == validate_elffile(data));
+}
+
+static error_t open_elf(void *state)
+{
+    error_t status;
+    elf_state_t *elf_state = (elf_state_t *)state;
+    memset(elf_state, 0, sizeof(*elf_state));
+    status = flash_decoder_open();
+    return status;
+}
+
+// Parse the ELF header once it has been buffered
+static error_t elf_parse_header(elf_state_t *elf_state)
+{
+    const uint8_t *header = elf_state->header_buf;
+    uint32_t phdr_end;
+
+    elf_state->phdr_offset = read_le32(header + ELF_E_PHOFF);
+    elf_state->phdr_size = read_le16(header + ELF_E_PHENTSIZE);
+    elf_state->phdr_left = read_le16(header + ELF_E_PHNUM);
+    phdr_end = elf_state->phdr_offset + (uint32_t)elf_state->phdr_size * elf_state->phdr_left;
+
+    if ((elf_state->phdr_offset < ELF_HEADER_SIZE) || (elf_state->phdr_size < ELF_PHDR_SIZE) ||
+            (0 == elf_state->phdr_left) || (phdr_end < elf_state->phdr_offset)) {
+        return ERROR_ELF_PARSER;
+    }
+
+    elf_state->phdr_end = phdr_end;
+    return ERROR_SUCCESS;
+}
+
+// Parse a program header once it has been buffered. Segments to be
+// programmed are kept in the order they appear in the file.
+static error_t elf_parse_phdr(elf_state_t *elf_state)
+{
+    const uint8_t *phdr = elf_state->header_buf;
+    elf_segment_t segment;
+    uint32_t i;
+
+    segment.offset = read_le32(phdr + ELF_P_OFFSET);
+    segment.addr = read_le32(phdr + ELF_P_PADDR);
+    segment.size = read_le32(phdr + ELF_P_FILESZ);
+
+    // Only loadable segments with data in the file are programmed
+    if ((ELF_PT_LOAD != read_le32(phdr + ELF_P_TYPE)) || (0 == segment.size)) {
+        return ERROR_SUCCESS;
+    }
+
+    // The file is streamed once so the data must come after the headers
+    if ((segment.offset < elf_state->phdr_end) || (segment.offset + segment.size < segment.offset) ||
+            (elf_state->segment_count >= ELF_MAX_SEGMENTS)) {
+        return ERROR_ELF_UNSUPPORTED;
+    }
+
+    for (i = elf_state->segment_count; (i > 0) && (elf_state->segments[i - 1].offset > segment.offset); i--) {
+        elf_state->segments[i] = elf_state->segments[i - 1];
+    }
+
+    elf_state->segments[i] = segment;
+    elf_state->segment_count++;
+    return ERROR_SUCCESS;
+}
+
+// Check the segments once all program headers have been parsed
+static error_t elf_parse_done(elf_state_t *elf_state)
+{
+    const elf_segment_t *segment = elf_state->segments;
+    uint32_t image_size = 0;
+    bool contiguous = true;
+    uint32_t i;
+
+    if (0 == elf_state->segment_count) {
+        return ERROR_ELF_UNSUPPORTED;
+    }
+
+    for (i = 0; i < elf_state->segment_count; i++) {
+        if (i > 0) {
+            if (segment[i].offset < segment[i - 1].offset + segment[i - 1].size) {
+                return ERROR_ELF_UNSUPPORTED;
             }
 
-            break;
-        } else if (HEX_PARSE_UNALIGNED == parse_status) {
-            if (bin_buf_written > 0) {
-                status = flash_decoder_write(bin_start_address, hex_state->bin_buffer, bin_buf_written);
+            if (segment[i].addr != segment[i - 1].addr + segment[i - 1].size) {
+                contiguous = false;
+            }
+        }
 
-                if (ERROR_SUCCESS != status) {
-                    break;
+        image_size += segment[i].size;
+    }
+
+    // Let the flash decoder pick an erase strategy from the load size
+    flash_decoder_set_image_size(image_size, contiguous);
+    return ERROR_SUCCESS;
+}
+
+static error_t write_elf(void *state, const uint8_t *data, uint32_t size)
+{
+    error_t status = ERROR_SUCCESS;
+    elf_state_t *elf_state = (elf_state_t *)state;
+    const elf_segment_t *segment;
+    uint32_t copy_size;
+
+    while (size > 0) {
+        if (elf_state->file_pos < ELF_HEADER_SIZE) {
+            // Buffer the ELF header
+            copy_size = MIN(size, ELF_HEADER_SIZE - elf_state->buf_pos);
+            memcpy(elf_state->header_buf + elf_state->buf_pos, data, copy_size);
+            elf_state->buf_pos += copy_size;
+
+            if (ELF_HEADER_SIZE == elf_state->buf_pos) {
+                elf_state->buf_pos = 0;
+                status = elf_parse_header(elf_state);
+            }
+        } else if (elf_state->phdr_left > 0) {
+            if (elf_state->file_pos < elf_state->phdr_offset) {
+                // Skip to the next program header
+                copy_size = MIN(size, elf_state->phdr_offset - elf_state->file_pos);
+            } else {
+                // Buffer the program header, anything after the fields
+                // used is skipped
+                copy_size = MIN(size, ELF_PHDR_SIZE - elf_state->buf_pos);
+                memcpy(elf_state->header_buf + elf_state->buf_pos, data, copy_size);
+                elf_state->buf_pos += copy_size;
+
+                if (ELF_PHDR_SIZE == elf_state->buf_pos) {
+                    elf_state->buf_pos = 0;
+                    elf_state->phdr_offset += elf_state->phdr_size;
+                    elf_state->phdr_left--;
+                    status = elf_parse_phdr(elf_state);
+
+                    if ((ERROR_SUCCESS == status) && (0 == elf_state->phdr_left)) {
+                        status = elf_parse_done(elf_state);
+                    }
                 }
             }
+        } else {
+            segment = &elf_state->segments[elf_state->segment];
+
+            if (elf_state->file_pos < segment->offset) {
+                // Sections not loaded, such as debug information, are skipped
+                copy_size = MIN(size, segment->offset - elf_state->file_pos);
+            } else {
+                copy_size = MIN(size, segment->offset + segment->size - elf_state->file_pos);
+                status = flash_decoder_write(segment->addr + (elf_state->file_pos - segment->offset), data, copy_size);
+
+                if ((ERROR_SUCCESS == status) && (elf_state->file_pos + copy_size == segment->offset + segment->size)) {
+                    elf_state->segment++;
+
+                    // The rest of the file is not needed
+                    if (elf_state->segment == elf_state->segment_count) {
+                        status = ERROR_SUCCESS_DONE;
+                    }
+                }
+            }
+        }
+
+        if (ERROR_SUCCESS != status) {
+            break;
+        }
+
+        elf_state->file_pos += copy_size;
+        data += copy_size;
+        size -= copy_size;
+    }
+
+    return status;
+}
+
+static error_t close_elf(void *state)
+{
+    error_t status;
+    status = flash_decoder_close();
+    return status;
+}
+
+/* UF2 file processing */
+
+static bool detect_uf2(const uint8_t *data, uint32_t size)
+{
+    return (size >= UF2_BLOCK_SIZE) && (1 == validate_uf2block(data));
+}
 
-            // incrememntal offset to finish the block
-            size -= block_amt_parsed;
-            data += block_amt_parsed;
-        } else if (HEX_PARSE_EOF == parse_status) {
-            if (bin_buf_written > 0) {
-                status = flash_decoder_write(bin_start_address, hex_state->bin_buffer, bin_buf_written);
+static error_t open_uf2(void *state)
+{
+    error_t status;
+    uf2_state_t *uf2_state = (uf2_state_t *)state;
+    memset(uf2_state, 0, sizeof(*uf2_state));
+    status = flash_decoder_open();
+    // Blocks carry their own address so they can be programmed as they come
+    flash_decoder_set_random_access(true);
+    return status;
+}
+
+static error_t write_uf2(void *state, const uint8_t *data, uint32_t size)
+{
+    error_t status = ERROR_SUCCESS;
+    uf2_state_t *uf2_state = (uf2_state_t *)state;
+    uf2_header_t header;
+    uint8_t mask;
+
+    // Every block is self contained, so the order blocks arrive in does
+    // not matter and blocks seen before are dropped
+    for (; size >= UF2_BLOCK_SIZE; data += UF2_BLOCK_SIZE, size -= UF2_BLOCK_SIZE) {
+        // Anything else the host writes in between is not part of the file
+        if (1 != validate_uf2block(data)) {
+            continue;
+        }
+
+        memcpy(&header, data, sizeof(header));
+
+        if ((header.payload_size > UF2_PAYLOAD_MAX) || (header.block_no >= header.num_blocks)) {
+            return ERROR_UF2_INVALID;
+        }
+
+        if (0 == uf2_state->block_count) {
+            if ((0 == header.num_blocks) || (header.num_blocks > UF2_MAX_BLOCKS)) {
+                return ERROR_UF2_INVALID;
             }
 
-            if (ERROR_SUCCESS == status) {
-                status = ERROR_SUCCESS_DONE;
+            uf2_state->block_count = header.num_blocks;
+            uf2_state->blocks_left = header.num_blocks;
+            // Let the flash decoder pick an erase strategy from the load size
+            flash_decoder_set_image_size(header.num_blocks * header.payload_size, false);
+        } else if (header.num_blocks != uf2_state->block_count) {
+            return ERROR_UF2_INVALID;
+        }
+
+        mask = 1 << (header.block_no % 8);
+
+        if (uf2_state->block_seen[header.block_no / 8] & mask) {
+            continue;
+        }
+
+        uf2_state->block_seen[header.block_no / 8] |= mask;
+        uf2_state->blocks_left--;
+
+        if (!(header.flags & UF2_FLAG_NOT_MAIN_FLASH) && (header.payload_size > 0)) {
+            status = flash_decoder_write(header.target_addr, data + sizeof(header), header.payload_size);
+
+            if (ERROR_SUCCESS != status) {
+                return status;
             }
-						
-					
+        }
+    }
 
-            break;
-        } else if (HEX_PARSE_CKSUM_FAIL == parse_status) {
-            status = ERROR_HEX_CKSUM;
-            break;
-        } else if ((HEX_PARSE_UNINIT == parse_status) || (HEX_PARSE_FAILURE == parse_status)) {
-            util_assert(HEX_PARSE_UNINIT != parse_status);
-            status = ERROR_HEX_PARSER;
+    // The file is complete once every block has been seen
+    if ((uf2_state->block_count > 0) && (0 == uf2_state->blocks_left)) {
+        status = ERROR_SUCCESS_DONE;
+    }
+
+    return status;
+}
+
+static error_t close_uf2(void *state)
+{
+    error_t status;
+    status = flash_decoder_close();
+    return status;
+}
+
+/* Compressed image processing */
+
+static bool detect_lz(const uint8_t *data, uint32_t size)
+{
+    return (size >= LZ_HEADER_SIZE) && (0 == memcmp(data, LZ_MAGIC, sizeof(LZ_MAGIC) - 1));
+}
+
+static error_t open_lz(void *state)
+{
+    error_t status;
+    lz_state_t *lz_state = (lz_state_t *)state;
+    memset(lz_state, 0, sizeof(*lz_state));
+    status = flash_decoder_open();
+    return status;
+}
+
+// Parse the header once it has been buffered
+static error_t lz_parse_header(lz_state_t *lz_state)
+{
+    const uint8_t *header = lz_state->header_buf;
+
+    lz_state->window_bits = header[LZ_WINDOW_BITS];
+    lz_state->lookahead_bits = header[LZ_LOOKAHEAD_BITS];
+    lz_state->size = read_le32(header + LZ_SIZE);
+
+    if ((lz_state->window_bits < LZ_WINDOW_BITS_MIN) || (lz_state->window_bits > LZ_WINDOW_BITS_MAX) ||
+            (lz_state->lookahead_bits < LZ_LOOKAHEAD_BITS_MIN) || (lz_state->lookahead_bits >= lz_state->window_bits) ||
+            (0 == lz_state->size)) {
+        return ERROR_LZ_INVALID;
+    }
+
+    // An image with its address given is written as is, otherwise it is
+    // handled like a bin file with the address taken from its contents
+    if (header[LZ_FLAGS] & LZ_FLAG_ADDR_VALID) {
+        lz_state->bin.flash_addr = read_le32(header + LZ_ADDR);
+        lz_state->bin.buf_pos = FLASH_DECODER_MIN_SIZE;
+    }
+
+    flash_decoder_set_image_size(lz_state->size, true);
+    return ERROR_SUCCESS;
+}
+
+// Pass the bytes decoded since the last flush on
+static error_t lz_flush(lz_state_t *lz_state)
+{
+    uint32_t mask = (1 << lz_state->window_bits) - 1;
+    uint32_t size = lz_state->head - lz_state->flushed;
+    error_t status;
+
+    if (0 == size) {
+        return ERROR_SUCCESS;
+    }
+
+    status = write_bin(&lz_state->bin, &lz_state->window[lz_state->flushed & mask], size);
+    lz_state->flushed = lz_state->head;
+
+    if (ERROR_SUCCESS_DONE_OR_CONTINUE == status) {
+        status = ERROR_SUCCESS;
+    }
+
+    return status;
+}
+
+static error_t write_lz(void *state, const uint8_t *data, uint32_t size)
+{
+    error_t status = ERROR_SUCCESS;
+    lz_state_t *lz_state = (lz_state_t *)state;
+    uint32_t copy_size;
+    uint32_t mask;
+    uint32_t bits;
+    uint32_t value;
+    uint8_t byte;
+
+    if (lz_state->header_pos < LZ_HEADER_SIZE) {
+        copy_size = MIN(size, LZ_HEADER_SIZE - lz_state->header_pos);
+        memcpy(lz_state->header_buf + lz_state->header_pos, data, copy_size);
+        lz_state->header_pos += copy_size;
+        data += copy_size;
+        size -= copy_size;
+
+        if (lz_state->header_pos < LZ_HEADER_SIZE) {
+            return ERROR_SUCCESS;
+        }
+
+        status = lz_parse_header(lz_state);
+
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+    }
+
+    mask = (1 << lz_state->window_bits) - 1;
+
+    while (lz_state->head < lz_state->size) {
+        // Keep at least a field worth of bits buffered
+        while ((lz_state->bit_count <= 24) && (size > 0)) {
+            lz_state->bit_buf |= (uint32_t)*data++ << (24 - lz_state->bit_count);
+            lz_state->bit_count += 8;
+            size--;
+        }
+
+        switch (lz_state->field) {
+            case LZ_FIELD_TAG:
+                bits = 1;
+                break;
+
+            case LZ_FIELD_LITERAL:
+                bits = 8;
+                break;
+
+            case LZ_FIELD_INDEX:
+                bits = lz_state->window_bits;
+                break;
+
+            case LZ_FIELD_COUNT:
+                bits = lz_state->lookahead_bits;
+                break;
+
+            default:
+                bits = 0;
+                break;
+        }
+
+        if (bits > lz_state->bit_count) {
+            // Wait for more data
             break;
         }
+
+        value = bits ? lz_state->bit_buf >> (32 - bits) : 0;
+        lz_state->bit_buf <<= bits;
+        lz_state->bit_count -= bits;
+
+        switch (lz_state->field) {
+            case LZ_FIELD_TAG:
+                lz_state->field = value ? LZ_FIELD_LITERAL : LZ_FIELD_INDEX;
+                continue;
+
+            case LZ_FIELD_INDEX:
+                lz_state->copy_distance = value + 1;
+                lz_state->field = LZ_FIELD_COUNT;
+                continue;
+
+            case LZ_FIELD_COUNT:
+                lz_state->copy_left = value + 1;
+                lz_state->field = LZ_FIELD_COPY;
+                continue;
+
+            case LZ_FIELD_LITERAL:
+                lz_state->copy_left = 1;
+                break;
+
+            default:
+                break;
+        }
+
+        // Bytes are decoded into the window, which is passed on each time
+        // it wraps around
+        while ((lz_state->copy_left > 0) && (lz_state->head < lz_state->size)) {
+            if (LZ_FIELD_LITERAL == lz_state->field) {
+                byte = value;
+            } else {
+                byte = lz_state->window[(lz_state->head - lz_state->copy_distance) & mask];
+            }
+
+            lz_state->window[lz_state->head & mask] = byte;
+            lz_state->head++;
+            lz_state->copy_left--;
+
+            if (0 == (lz_state->head & mask)) {
+                status = lz_flush(lz_state);
+
+                if (ERROR_SUCCESS != status) {
+                    return status;
+                }
+            }
+        }
+
+        lz_state->field = LZ_FIELD_TAG;
+    }
+
+    status = lz_flush(lz_state);
+
+    // Padding after the last byte is ignored
+    if ((ERROR_SUCCESS == status) && (lz_state->head == lz_state->size)) {
+        status = ERROR_SUCCESS_DONE;
     }
-		
-					
 
     return status;
 }
 
-static error_t close_hex(void *state)
+static error_t close_lz(void *state)
 {
     error_t status;
     status = flash_decoder_close();
@@ -36,6 +36,9 @@ typedef enum {
 
     STREAM_TYPE_BIN = STREAM_TYPE_START,
     STREAM_TYPE_HEX,
+    STREAM_TYPE_ELF,
+    STREAM_TYPE_UF2,
+    STREAM_TYPE_LZ,
 
     // Add new stream types here
 
@@ -56,6 +59,9 @@ error_t stream_write(const uint8_t *data, uint32_t size);
 
 error_t stream_close(void);
 
+// Bytes of the last UF2 file written, counting each block only once
+uint32_t stream_uf2_size(void);
+
 #ifdef __cplusplus
 }
 #endif
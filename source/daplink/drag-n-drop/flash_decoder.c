@@ -44,6 +44,14 @@
 #define flash_decoder_printf(...)
 #endif
 
+// When enabled by the board, erase sector by sector when an image covers
+// less than 1/N of the target's sectors.  A chip erase is cheaper per byte
+// but a fixed cost regardless of image size.  Erasing ahead hides most of the
+// sector erase time behind USB transfers so it pays off for larger images.
+// Sector erase leaves flash outside the image untouched, so it stays opt-in.
+#define ERASE_SECTOR_RATIO          4
+#define ERASE_SECTOR_AHEAD_RATIO    2
+
 typedef enum {
     DECODER_STATE_CLOSED,
     DECODER_STATE_OPEN,
@@ -59,8 +67,15 @@ static uint32_t initial_addr;
 static uint32_t current_addr;
 static bool flash_initialized;
 static bool initial_addr_set;
+static uint32_t image_size;
+static bool image_contiguous;
+static bool sector_erase_enabled = false;
+static bool random_access = false;
 
-static bool flash_decoder_is_at_end(uint32_t addr, const uint8_t *data, uint32_t size);
+static bool flash_decoder_is_at_end(uint32_t addr, uint32_t size);
+static error_t flash_decoder_start(flash_decoder_type_t type);
+static void flash_decoder_select_erase(const flash_intf_t *flash_intf);
+static uint32_t flash_decoder_count_sectors(const flash_intf_t *flash_intf, uint32_t start, uint32_t end);
 
 flash_decoder_type_t flash_decoder_detect_type(const uint8_t *data, uint32_t size, uint32_t addr, bool addr_valid)
 {
@@ -167,6 +182,22 @@ error_t flash_decoder_get_flash(flash_decoder_type_t type, uint32_t addr, bool a
     return status;
 }
 
+void flash_decoder_set_image_size(uint32_t size, bool contiguous)
+{
+    image_size = size;
+    image_contiguous = contiguous;
+}
+
+void flash_decoder_set_sector_erase(bool enabled)
+{
+    sector_erase_enabled = enabled;
+}
+
+void flash_decoder_set_random_access(bool enabled)
+{
+    random_access = enabled;
+}
+
 error_t flash_decoder_open(void)
 {
     flash_decoder_printf("flash_decoder_open()\r\n");
@@ -190,9 +221,37 @@ error_t flash_decoder_open(void)
 
 error_t flash_decoder_write(uint32_t addr, const uint8_t *data, uint32_t size)
 {
-    error_t status;
+    uint8_t *span;
+    uint32_t span_size;
+    error_t status = ERROR_SUCCESS;
     flash_decoder_printf("flash_decoder_write(addr=0x%x, size=0x%x)\r\n", addr, size);
 
+    while (size > 0) {
+        status = flash_decoder_get_span(addr, size, &span, &span_size);
+
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+
+        memcpy(span, data, span_size);
+        status = flash_decoder_commit(addr, span_size);
+
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+
+        addr += span_size;
+        data += span_size;
+        size -= span_size;
+    }
+
+    return status;
+}
+
+error_t flash_decoder_get_span(uint32_t addr, uint32_t size, uint8_t **span, uint32_t *span_size)
+{
+    error_t status;
+
     if (DECODER_STATE_OPEN != state) {
         util_assert(0);
         return ERROR_INTERNAL;
@@ -207,87 +266,62 @@ error_t flash_decoder_write(uint32_t addr, const uint8_t *data, uint32_t size)
     }
 
     if (!flash_initialized) {
-        uint32_t copy_size;
-        bool flash_type_known = false;
-        bool sequential;
-        // Check if the data is sequential
-        sequential = addr == current_addr;
-        current_addr += size;
-
         // Buffer data until the flash type is known
-        if (sequential) {
-            // Copy data into buffer
-            copy_size = MIN(size, sizeof(flash_buf) - flash_buf_pos);
-            memcpy(&flash_buf[flash_buf_pos], data, copy_size);
-            flash_buf_pos += copy_size;
-            flash_decoder_printf("    buffering %i bytes\r\n", copy_size);
-            // Update vars so they no longer include the buffered data
-            data += copy_size;
-            size -= copy_size;
-            addr += copy_size;
-
-            // If enough data has been buffered then determine the type
-            if (flash_buf_pos >= sizeof(flash_buf)) {
-                util_assert(sizeof(flash_buf) == flash_buf_pos);
-                // Determine flash type and get info for it
-                flash_type = flash_decoder_detect_type(flash_buf, flash_buf_pos, initial_addr, true);
-                flash_decoder_printf("    Buffering complete, setting flash_type=%i\r\n", flash_type);
-                flash_type_known = true;
-            }
-        } else {
-            flash_type = FLASH_DECODER_TYPE_TARGET;
-            flash_decoder_printf("    Non sequential addr, setting flash_type=%i\r\n", flash_type);
-            flash_type_known = true;
+        if (addr == current_addr) {
+            util_assert(flash_buf_pos < sizeof(flash_buf));
+            *span = &flash_buf[flash_buf_pos];
+            *span_size = MIN(size, sizeof(flash_buf) - flash_buf_pos);
+            return ERROR_SUCCESS;
         }
 
-        // If flash type is known initialize the flash manager
-        if (flash_type_known) {
-            const flash_intf_t *flash_intf;
-            uint32_t flash_start_addr;
-            status = flash_decoder_get_flash(flash_type, initial_addr, true, &flash_start_addr, &flash_intf);
+        flash_decoder_printf("    Non sequential addr, setting flash_type=%i\r\n", FLASH_DECODER_TYPE_TARGET);
+        status = flash_decoder_start(FLASH_DECODER_TYPE_TARGET);
 
-            if (ERROR_SUCCESS != status) {
-                state = DECODER_STATE_ERROR;
-                return status;
-            }
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+    }
 
-            flash_decoder_printf("    flash_start_addr=0x%x\r\n", flash_start_addr);
-            // Initialize flash manager
-            util_assert(!flash_initialized);
-            status = flash_manager_init(flash_intf);
-            flash_decoder_printf("    flash_manager_init ret %i\r\n", status);
+    status = flash_manager_get_span(addr, size, span, span_size);
 
-            if (ERROR_SUCCESS != status) {
-                state = DECODER_STATE_ERROR;
-                return status;
-            }
+    if (ERROR_SUCCESS != status) {
+        state = DECODER_STATE_ERROR;
+    }
 
-            flash_initialized = true;
-        }
+    return status;
+}
+
+error_t flash_decoder_commit(uint32_t addr, uint32_t size)
+{
+    error_t status;
+
+    if (DECODER_STATE_OPEN != state) {
+        util_assert(0);
+        return ERROR_INTERNAL;
+    }
+
+    if (!flash_initialized) {
+        // The data went into the buffer
+        flash_buf_pos += size;
+        current_addr += size;
+        flash_decoder_printf("    buffering %i bytes\r\n", size);
+
+        // If enough data has been buffered then determine the type
+        if (flash_buf_pos >= sizeof(flash_buf)) {
+            util_assert(sizeof(flash_buf) == flash_buf_pos);
+            flash_type = flash_decoder_detect_type(flash_buf, flash_buf_pos, initial_addr, true);
+            flash_decoder_printf("    Buffering complete, setting flash_type=%i\r\n", flash_type);
+            status = flash_decoder_start(flash_type);
 
-        // If flash has been initalized then write out buffered data
-        if (flash_initialized) {
-            status = flash_manager_data(initial_addr, flash_buf, flash_buf_pos);
-            flash_decoder_printf("    Flushing buffer initial_addr=0x%x, flash_buf_pos=%i, flash_manager_data ret=%i\r\n",
-                                 initial_addr, flash_buf_pos, status);
-					
-//					uint8_t buf[6] = "START";
-//					USBD_CDC_ACM_DataSend(buf, 6);
-					
             if (ERROR_SUCCESS != status) {
-                state = DECODER_STATE_ERROR;
                 return status;
             }
         }
-    }
-
-    // Write data as normal if flash has been initialized
-    if (flash_initialized) {
-        status = flash_manager_data(addr, data, size);
-        flash_decoder_printf("    Writing data, addr=0x%x, size=0x%x, flash_manager_data ret %i\r\n",
+    } else {
+        status = flash_manager_commit(addr, size);
+        flash_decoder_printf("    Writing data, addr=0x%x, size=0x%x, flash_manager_commit ret %i\r\n",
                              addr, size, status);
-//								uint8_t buf[6] = "DATEN";
-//								USBD_CDC_ACM_DataSend(buf, 6);
+
         if (ERROR_SUCCESS != status) {
             state = DECODER_STATE_ERROR;
             return status;
@@ -295,9 +329,7 @@ error_t flash_decoder_write(uint32_t addr, const uint8_t *data, uint32_t size)
     }
 
     // Check if this is the end of data
-    if (flash_decoder_is_at_end(addr, data, size)) {
-//								uint8_t buf[6] = "ENDE!";
-//								USBD_CDC_ACM_DataSend(buf, 6);
+    if (flash_decoder_is_at_end(addr, size)) {
         flash_decoder_printf("    End of transfer detected - addr 0x%08x, size 0x%08x\r\n",
                              addr, size);
         state = DECODER_STATE_DONE;
@@ -319,6 +351,9 @@ error_t flash_decoder_close(void)
     }
 
     state = DECODER_STATE_CLOSED;
+    image_size = 0;
+    image_contiguous = false;
+    random_access = false;
 
     if (flash_initialized) {
         status = flash_manager_uninit();
@@ -334,10 +369,16 @@ error_t flash_decoder_close(void)
     return status;
 }
 
-static bool flash_decoder_is_at_end(uint32_t addr, const uint8_t *data, uint32_t size)
+static bool flash_decoder_is_at_end(uint32_t addr, uint32_t size)
 {
     uint32_t end_addr;
 
+    // Data in any order can reach the end of flash early, so the stream
+    // decides when the image is complete
+    if (random_access) {
+        return false;
+    }
+
     switch (flash_type) {
         case FLASH_DECODER_TYPE_BOOTLOADER:
             end_addr = DAPLINK_ROM_BL_START + DAPLINK_ROM_BL_SIZE;
@@ -361,3 +402,96 @@ static bool flash_decoder_is_at_end(uint32_t addr, const uint8_t *data, uint32_t
         return false;
     }
 }
+
+// Initialize the flash manager for the type of image and write out
+// the data buffered while the type was not known
+static error_t flash_decoder_start(flash_decoder_type_t type)
+{
+    const flash_intf_t *flash_intf;
+    uint32_t flash_start_addr;
+    error_t status;
+
+    flash_type = type;
+    status = flash_decoder_get_flash(flash_type, initial_addr, true, &flash_start_addr, &flash_intf);
+
+    if (ERROR_SUCCESS != status) {
+        state = DECODER_STATE_ERROR;
+        return status;
+    }
+
+    flash_decoder_printf("    flash_start_addr=0x%x\r\n", flash_start_addr);
+    // Initialize flash manager
+    util_assert(!flash_initialized);
+    flash_decoder_select_erase(flash_intf);
+    flash_manager_set_random_access(random_access, flash_start_addr);
+    status = flash_manager_init(flash_intf);
+    flash_decoder_printf("    flash_manager_init ret %i\r\n", status);
+
+    if (ERROR_SUCCESS != status) {
+        state = DECODER_STATE_ERROR;
+        return status;
+    }
+
+    flash_initialized = true;
+    status = flash_manager_data(initial_addr, flash_buf, flash_buf_pos);
+    flash_decoder_printf("    Flushing buffer initial_addr=0x%x, flash_buf_pos=%i, flash_manager_data ret=%i\r\n",
+                         initial_addr, flash_buf_pos, status);
+
+    if (ERROR_SUCCESS != status) {
+        state = DECODER_STATE_ERROR;
+    }
+
+    return status;
+}
+
+// Choose how flash is erased for a target image from its size and the
+// target's sector layout
+static void flash_decoder_select_erase(const flash_intf_t *flash_intf)
+{
+    uint32_t image_end;
+    uint32_t image_sectors;
+    uint32_t total_sectors;
+    flash_erase_mode_t mode = FLASH_ERASE_CHIP;
+
+    // Interface and bootloader updates keep using the default erase, as do
+    // boards that have not opted in to sector erase
+    if (!sector_erase_enabled || (FLASH_DECODER_TYPE_TARGET != flash_type) || (0 == image_size) ||
+            (initial_addr < target_device.flash_start) || (initial_addr >= target_device.flash_end)) {
+        flash_manager_set_erase_mode(FLASH_ERASE_CHIP, 0);
+        return;
+    }
+
+    image_end = MIN(target_device.flash_end - initial_addr, image_size) + initial_addr;
+    image_sectors = flash_decoder_count_sectors(flash_intf, initial_addr, image_end);
+    total_sectors = flash_decoder_count_sectors(flash_intf, target_device.flash_start, target_device.flash_end);
+
+    if (image_contiguous && (image_sectors * ERASE_SECTOR_AHEAD_RATIO < total_sectors)) {
+        // Only erase ahead within the image so data after it is left alone
+        mode = FLASH_ERASE_SECTOR_AHEAD;
+    } else if (image_sectors * ERASE_SECTOR_RATIO < total_sectors) {
+        mode = FLASH_ERASE_SECTOR;
+    }
+
+    flash_decoder_printf("    image sectors=%i, total sectors=%i, erase mode=%i\r\n",
+                         image_sectors, total_sectors, mode);
+    flash_manager_set_erase_mode(mode, image_end);
+}
+
+static uint32_t flash_decoder_count_sectors(const flash_intf_t *flash_intf, uint32_t start, uint32_t end)
+{
+    uint32_t count = 0;
+    uint32_t addr = start;
+
+    while (addr < end) {
+        uint32_t sector_size = flash_intf->erase_sector_size(addr);
+
+        if (0 == sector_size) {
+            break;
+        }
+
+        addr = ROUND_DOWN(addr, sector_size) + sector_size;
+        count++;
+    }
+
+    return count;
+}
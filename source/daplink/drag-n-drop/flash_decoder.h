@@ -45,8 +45,23 @@ typedef enum {
 flash_decoder_type_t flash_decoder_detect_type(const uint8_t *data, uint32_t size, uint32_t addr, bool addr_valid);
 error_t flash_decoder_get_flash(flash_decoder_type_t type, uint32_t addr, bool addr_valid, uint32_t *start_addr, const flash_intf_t **flash_intf);
 
+// Size of the next image as reported by the filesystem, 0 if unknown.  Set
+// contiguous if every byte between the start and the end is part of the image.
+void flash_decoder_set_image_size(uint32_t size, bool contiguous);
+// Let small target images be erased sector by sector instead of with a chip
+// erase.  Disabled by default; boards enable it from their config hook.
+void flash_decoder_set_sector_erase(bool enabled);
+// Data of the next image may arrive for any address in any order.  The end
+// of the image is then up to the stream.  Cleared when the decoder is closed.
+void flash_decoder_set_random_access(bool enabled);
+
 error_t flash_decoder_open(void);
 error_t flash_decoder_write(uint32_t addr, const uint8_t *data, uint32_t size);
+// Get space for up to size bytes of data at addr to be decoded into in
+// place, then commit it. Returns ERROR_SUCCESS_DONE from the commit once
+// the end of the image is reached, like flash_decoder_write().
+error_t flash_decoder_get_span(uint32_t addr, uint32_t size, uint8_t **span, uint32_t *span_size);
+error_t flash_decoder_commit(uint32_t addr, uint32_t size);
 error_t flash_decoder_close(void);
 
 #ifdef __cplusplus
@@ -38,6 +38,7 @@ typedef error_t (*flash_intf_erase_chip_cb_t)(void);
 typedef uint32_t (*flash_program_page_min_size_cb_t)(uint32_t addr);
 typedef uint32_t (*flash_erase_sector_size_cb_t)(uint32_t addr);
 typedef uint8_t (*flash_busy_cb_t)(void);
+typedef error_t (*flash_intf_erase_sector_start_cb_t)(uint32_t sector);
 
 typedef struct {
     flash_intf_init_cb_t init;
@@ -48,6 +49,9 @@ typedef struct {
     flash_program_page_min_size_cb_t program_page_min_size;
     flash_erase_sector_size_cb_t erase_sector_size;
     flash_busy_cb_t flash_busy;
+    // Optional - start erasing a sector and return without waiting for it
+    // to finish.  The next call into the interface waits for completion.
+    flash_intf_erase_sector_start_cb_t erase_sector_start;
 } flash_intf_t;
 
 // All flash interfaces.  Unsupported interfaces are NULL.
@@ -26,6 +26,7 @@
 #include "util.h"
 #include "macro.h"
 #include "error.h"
+#include "compiler.h"
 
 #include "RTL.h"
 #include "rl_usb.h"
@@ -41,31 +42,107 @@
 #define flash_manager_printf(...)
 #endif
 
+
+// Number of write blocks that can be buffered at once.  Data may arrive
+// out of order as long as it lands in a buffered block or in a block of
+// the previous or current sector that has not been programmed yet.
+#ifndef FLASH_MANAGER_PAGE_COUNT
+#define FLASH_MANAGER_PAGE_COUNT    2
+#endif
+
+// Largest write block.  Each buffered block gets a full one so in order
+// data is programmed in blocks as large as without reassembly.
+#ifndef FLASH_MANAGER_BLOCK_SIZE
+#define FLASH_MANAGER_BLOCK_SIZE    1024
+#endif
+
+// A block is programmed as soon as all of its chunks have been written
+#define PAGE_CHUNK_COUNT            32
+
+// Smallest write block used for random access.  This is the usual UF2
+// payload size so each UF2 block fills whole write blocks.
+#ifndef FLASH_MANAGER_RANDOM_BLOCK_SIZE
+#define FLASH_MANAGER_RANDOM_BLOCK_SIZE     256
+#endif
+
+// Number of write blocks from the base address that random access keeps
+// track of.  At 256 byte blocks this covers 512 KByte.
+#ifndef FLASH_MANAGER_RANDOM_BLOCK_COUNT
+#define FLASH_MANAGER_RANDOM_BLOCK_COUNT    2048
+#endif
+
 typedef enum {
     STATE_CLOSED,
     STATE_OPEN,
     STATE_ERROR
 } state_t;
 
+typedef struct {
+    uint32_t addr;
+    uint32_t filled;                // Bitmap of chunks that have been completely written
+    uint32_t dirty;                 // Bitmap of chunks that hold any data
+    uint32_t programmed;            // Bitmap of chunks that are already in flash
+    bool valid;
+    uint8_t fill[PAGE_CHUNK_COUNT]; // Bytes written without a gap from the start of each chunk
+} page_t;
+
 // Target programming expects buffer
 // passed in to be 4 byte aligned
 __attribute__((aligned(4)))
-static uint8_t buf[1024];
-static bool buf_empty;
+static uint8_t buf[FLASH_MANAGER_PAGE_COUNT * FLASH_MANAGER_BLOCK_SIZE];
+// page_t.fill must hold the largest chunk
+COMPILER_ASSERT(sizeof(buf) / PAGE_CHUNK_COUNT <= 0xFF);
+static page_t pages[FLASH_MANAGER_PAGE_COUNT];
+// Blocks that had to be programmed before all of their data arrived.  The
+// parts that were never programmed can still be filled in later.
+static page_t evicted[FLASH_MANAGER_PAGE_COUNT];
+static uint32_t evicted_next;
+static uint32_t page_count;
+static uint32_t page_chunk_size;
+static uint32_t page_unit_chunks;
+static uint32_t page_full_mask;
+static uint32_t span_index;
 static bool current_sector_valid;
+static bool prev_sector_valid;
 static bool page_erase_enabled = false;
-static uint32_t current_write_block_addr;
+static flash_erase_mode_t requested_erase_mode = FLASH_ERASE_CHIP;
+static uint32_t requested_erase_end_addr;
+static flash_erase_mode_t erase_mode;
+static uint32_t erase_end_addr;
+static bool erase_ahead_valid;
+static uint32_t erase_ahead_addr;
 static uint32_t current_write_block_size;
+static uint32_t current_min_prog_size;
 static uint32_t current_sector_addr;
 static uint32_t current_sector_size;
+static uint32_t prev_sector_addr;
+static uint32_t prev_sector_size;
 static uint32_t last_addr;
+static bool requested_random_access = false;
+static uint32_t requested_random_base;
+static bool random_access;
+static uint32_t random_base;
+// Write blocks that have been programmed at least in part
+static uint32_t random_programmed[FLASH_MANAGER_RANDOM_BLOCK_COUNT / 32];
 static const flash_intf_t *intf;
 static state_t state = STATE_CLOSED;
 
 static bool flash_intf_valid(const flash_intf_t *flash_intf);
 static error_t setup_next_sector(uint32_t addr);
-
-extern uint8_t flash_start_writing;
+static error_t setup_random_sector(uint32_t addr);
+static error_t set_block_size(uint32_t write_block_size, uint32_t min_prog_size);
+static void reset_pages(void);
+static error_t get_page(uint32_t addr, uint32_t *index);
+static bool take_evicted_page(uint32_t page_addr, page_t *page);
+static bool mark_page_filled(page_t *page, uint32_t pos, uint32_t size);
+static error_t program_page_units(page_t *page, uint8_t *page_buf);
+static error_t program_lowest_page(bool only_if_full, bool *programmed);
+static error_t erase_next_sector_start(void);
+static bool random_block_index(uint32_t page_addr, uint32_t *index);
+static bool random_block_programmed(uint32_t page_addr);
+static error_t random_erase_sector(uint32_t page_addr);
+static error_t program_full_pages(void);
+static error_t program_all_pages(void);
 
 error_t flash_manager_init(const flash_intf_t *flash_intf)
 {
@@ -85,15 +162,35 @@ error_t flash_manager_init(const flash_intf_t *flash_intf)
     }
 
     // Initialize variables
-    memset(buf, 0xFF, sizeof(buf));
-    buf_empty = true;
+    reset_pages();
     current_sector_valid = false;
-    current_write_block_addr = 0;
+    prev_sector_valid = false;
     current_write_block_size = 0;
+    current_min_prog_size = 0;
     current_sector_addr = 0;
     current_sector_size = 0;
+    prev_sector_addr = 0;
+    prev_sector_size = 0;
     last_addr = 0;
+    erase_ahead_valid = false;
+    erase_ahead_addr = 0;
+    random_access = requested_random_access;
+    random_base = requested_random_base;
+    memset(random_programmed, 0, sizeof(random_programmed));
     intf = flash_intf;
+    // Pick the erase mode for this image.  Boards that enable page erase
+    // never allow a chip erase, and erase ahead needs interface support
+    // and data that arrives in order.
+    erase_mode = requested_erase_mode;
+    erase_end_addr = requested_erase_end_addr;
+    if (page_erase_enabled && (FLASH_ERASE_CHIP == erase_mode)) {
+        erase_mode = FLASH_ERASE_SECTOR;
+    }
+    if ((FLASH_ERASE_SECTOR_AHEAD == erase_mode) && ((0 == intf->erase_sector_start) || random_access)) {
+        erase_mode = FLASH_ERASE_SECTOR;
+    }
+    flash_manager_printf("    erase_mode=%i, erase_end_addr=0x%x, random_access=%i\r\n",
+                         erase_mode, erase_end_addr, random_access);
     // Initialize flash
     status = intf->init();
     flash_manager_printf("    intf->init ret=%i\r\n", status);
@@ -102,7 +199,7 @@ error_t flash_manager_init(const flash_intf_t *flash_intf)
         return status;
     }
 
-    if (!page_erase_enabled) {
+    if (FLASH_ERASE_CHIP == erase_mode) {
         // Erase flash and unint if there are errors
         status = intf->erase_chip();
         flash_manager_printf("    intf->erase_chip ret=%i\r\n", status);
@@ -119,28 +216,58 @@ error_t flash_manager_init(const flash_intf_t *flash_intf)
 
 error_t flash_manager_data(uint32_t addr, const uint8_t *data, uint32_t size)
 {
-    uint32_t size_left;
-    uint32_t copy_size;
-    uint32_t pos;
+    uint8_t *span;
+    uint32_t span_size;
     error_t status = ERROR_SUCCESS;
     flash_manager_printf("flash_manager_data(addr=0x%x size=0x%x)\r\n", addr, size);
 
-    if (state != STATE_OPEN) {
-        util_assert(0);
-        return ERROR_INTERNAL;
+    while (size > 0) {
+        status = flash_manager_get_span(addr, size, &span, &span_size);
+
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+
+        memcpy(span, data, span_size);
+        status = flash_manager_commit(addr, span_size);
+
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+
+        addr += span_size;
+        data += span_size;
+        size -= span_size;
     }
 
-    // Enforce that addresses are sequential.  Currently flash manager
-    // only supports sequential addresses.  In the future flash manager
-    // could be updated to support this.
-    if (addr < last_addr) {
+    return status;
+}
+
+error_t flash_manager_get_span(uint32_t addr, uint32_t size, uint8_t **span, uint32_t *span_size)
+{
+    uint32_t index;
+    uint32_t pos;
+    error_t status;
+
+    if (state != STATE_OPEN) {
         util_assert(0);
-        state = STATE_ERROR;
         return ERROR_INTERNAL;
     }
 
-    // Setup the current sector if it is not setup already
-    if (!current_sector_valid) {
+    if (random_access) {
+        // Data can go anywhere, the sector only sets the block size
+        if (!current_sector_valid || (addr < current_sector_addr) ||
+                (addr >= current_sector_addr + current_sector_size)) {
+            status = setup_random_sector(addr);
+
+            if (ERROR_SUCCESS != status) {
+                state = STATE_ERROR;
+                return status;
+            }
+            current_sector_valid = true;
+        }
+    } else if (!current_sector_valid) {
+        // Setup the current sector if it is not setup already
         status = setup_next_sector(addr);
 
         if (ERROR_SUCCESS != status) {
@@ -148,71 +275,66 @@ error_t flash_manager_data(uint32_t addr, const uint8_t *data, uint32_t size)
             return status;
         }
         current_sector_valid = true;
-    }
-		
-		
-		
-    while (true) {
-        // flush if necessary
-        if (addr >= current_write_block_addr + current_write_block_size) {
-
-            // Write out current buffer if there is data in it
-            if (!buf_empty) {
-							
-							if(flash_start_writing){//WRITE FLASH
-
-							}else{//PROGRAMMIERE
-									
-							}
-							status = intf->program_page(current_write_block_addr, buf, current_write_block_size);
-							
-							
-	//			USBD_CDC_ACM_DataSend(entry.filename, 11);
-	//	USBD_CDC_ACM_DataSend(entry.filename+11, 4);
-							
-              
-							flash_manager_printf("    intf->program_page(addr=0x%x, size=0x%x) ret=%i\r\n", current_write_block_addr, current_write_block_size, status);
-
-                if (ERROR_SUCCESS != status) {
-                    state = STATE_ERROR;
-                    return status;
-                }
-                buf_empty = true;
-            }
+        // Earlier blocks of the first sector can still arrive
+        last_addr = current_sector_addr;
+    } else if (addr >= current_sector_addr + current_sector_size) {
+        // Change sector if necessary
+        status = setup_next_sector(addr);
 
-            // Setup for next page
-            memset(buf, 0xFF, current_write_block_size);
-            current_write_block_addr = ROUND_DOWN(addr,current_write_block_size);
+        if (ERROR_SUCCESS != status) {
+            state = STATE_ERROR;
+            return status;
         }
+    }
 
-        // Check for end
-        if (size <= 0) {
-            break;
-        }
+    // Find or allocate the block this data belongs to
+    status = get_page(addr, &index);
 
-        // Change sector if necessary
-        if (addr >= current_sector_addr + current_sector_size) {
-            status = setup_next_sector(addr);
+    if (ERROR_SUCCESS != status) {
+        state = STATE_ERROR;
+        return status;
+    }
 
-            if (ERROR_SUCCESS != status) {
-                state = STATE_ERROR;
-                return status;
-            }
-        }
+    pos = addr - pages[index].addr;
+    *span = buf + index * current_write_block_size + pos;
+    *span_size = MIN(size, current_write_block_size - pos);
+    span_index = index;
+    return ERROR_SUCCESS;
+}
+
+error_t flash_manager_commit(uint32_t addr, uint32_t size)
+{
+    page_t *page = &pages[span_index];
+    error_t status;
 
-        // write buffer
-        pos = addr - current_write_block_addr;
-        size_left = current_write_block_size - pos;
-        copy_size = MIN(size, size_left);
-        memcpy(buf + pos, data, copy_size);
-        buf_empty = copy_size == 0;
-        // Update variables
-        addr += copy_size;
-        data += copy_size;
-        size -= copy_size;
+    if (state != STATE_OPEN) {
+        util_assert(0);
+        return ERROR_INTERNAL;
+    }
+
+    // Must be inside the block of the last span
+    if (!page->valid || (addr < page->addr) ||
+            (addr + size > page->addr + current_write_block_size)) {
+        util_assert(0);
+        state = STATE_ERROR;
+        return ERROR_INTERNAL;
+    }
+
+    if (!mark_page_filled(page, addr - page->addr, size)) {
+        // Part of the data lands on flash that has already been programmed
+        flash_manager_printf("    addr=0x%x already programmed\r\n", addr);
+        util_assert(0);
+        state = STATE_ERROR;
+        return ERROR_INTERNAL;
+    }
+
+    // Program blocks that are complete
+    status = program_full_pages();
+
+    if (ERROR_SUCCESS != status) {
+        state = STATE_ERROR;
     }
 
-    last_addr = addr;
     return status;
 }
 
@@ -227,26 +349,35 @@ error_t flash_manager_uninit(void)
         return ERROR_INTERNAL;
     }
 
-    // Write out current page
-    if ((STATE_OPEN == state) && (!buf_empty)) {
-        flash_write_error = intf->program_page(current_write_block_addr, buf, current_write_block_size);
-        flash_manager_printf("    intf->program_page(addr=0x%x, size=0x%x) ret=%i\r\n",
-                             current_write_block_addr, current_write_block_size, flash_write_error);
+    // Write out all buffered pages
+    if (STATE_OPEN == state) {
+        flash_write_error = program_all_pages();
     }
 
     // Close flash interface (even if there was an error during program_page)
     flash_uninit_error = intf->uninit();
     flash_manager_printf("    intf->uninit() ret=%i\r\n", flash_uninit_error);
     // Reset variables to catch accidental use
-    memset(buf, 0xFF, sizeof(buf));
-    buf_empty = true;
+    reset_pages();
     current_sector_valid = false;
-    current_write_block_addr = 0;
+    prev_sector_valid = false;
     current_write_block_size = 0;
+    current_min_prog_size = 0;
     current_sector_addr = 0;
     current_sector_size = 0;
+    prev_sector_addr = 0;
+    prev_sector_size = 0;
     last_addr = 0;
+    erase_ahead_valid = false;
+    erase_ahead_addr = 0;
+    random_access = false;
+    random_base = 0;
     state = STATE_CLOSED;
+    // Erase mode and random access only apply to a single image
+    requested_erase_mode = FLASH_ERASE_CHIP;
+    requested_erase_end_addr = 0;
+    requested_random_access = false;
+    requested_random_base = 0;
 
     // Make sure an error from a page write or from an
     // uninit gets propagated
@@ -266,6 +397,20 @@ void flash_manager_set_page_erase(bool enabled)
     page_erase_enabled = enabled;
 }
 
+void flash_manager_set_erase_mode(flash_erase_mode_t mode, uint32_t end_addr)
+{
+    // Takes effect on the next flash_manager_init
+    requested_erase_mode = mode;
+    requested_erase_end_addr = end_addr;
+}
+
+void flash_manager_set_random_access(bool enabled, uint32_t base_addr)
+{
+    // Takes effect on the next flash_manager_init
+    requested_random_access = enabled;
+    requested_random_base = base_addr;
+}
+
 static bool flash_intf_valid(const flash_intf_t *flash_intf)
 {
     // Check for all requried members
@@ -308,6 +453,7 @@ static error_t setup_next_sector(uint32_t addr)
 {
     uint32_t min_prog_size;
     uint32_t sector_size;
+    uint32_t write_block_size;
     error_t status;
     min_prog_size = intf->program_page_min_size(addr);
     sector_size = intf->erase_sector_size(addr);
@@ -318,32 +464,499 @@ static error_t setup_next_sector(uint32_t addr)
         return ERROR_INTERNAL;
     }
 
+    // Each buffered block is a full write block
+    write_block_size = MIN(sector_size, FLASH_MANAGER_BLOCK_SIZE);
+    write_block_size = MAX(write_block_size, min_prog_size);
     // Assert required size and alignment
     util_assert(sizeof(buf) >= min_prog_size);
     util_assert(sizeof(buf) % min_prog_size == 0);
     util_assert(sector_size >= min_prog_size);
     util_assert(sector_size % min_prog_size == 0);
+    util_assert(sector_size % write_block_size == 0);
+    util_assert(write_block_size % min_prog_size == 0);
+
+    if ((write_block_size != current_write_block_size) || (min_prog_size != current_min_prog_size)) {
+        status = set_block_size(write_block_size, min_prog_size);
+
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+
+        prev_sector_valid = false;
+    } else {
+        // Unprogrammed blocks of the sector being left can still be filled in
+        prev_sector_valid = current_sector_valid;
+        prev_sector_addr = current_sector_addr;
+        prev_sector_size = current_sector_size;
+    }
+
     // Setup global variables
     current_sector_addr = ROUND_DOWN(addr, sector_size);
     current_sector_size = sector_size;
-    current_write_block_addr = current_sector_addr;
-    current_write_block_size = MIN(sector_size, sizeof(buf));
 
-    if(page_erase_enabled) {
-        // Erase the current sector
-        status = intf->erase_sector(current_sector_addr);
-        flash_manager_printf("    intf->erase_sector(addr=0x%x) ret=%i\r\n", current_sector_addr);
+    if (FLASH_ERASE_CHIP != erase_mode) {
+        // Erase the current sector unless it was already erased ahead
+        if (!erase_ahead_valid || (erase_ahead_addr != current_sector_addr)) {
+            status = intf->erase_sector(current_sector_addr);
+            flash_manager_printf("    intf->erase_sector(addr=0x%x) ret=%i\r\n", current_sector_addr, status);
+            if (ERROR_SUCCESS != status) {
+                intf->uninit();
+                return status;
+            }
+        }
+        erase_ahead_valid = false;
+    }
+
+    flash_manager_printf("    setup_next_sector(addr=0x%x) sect_addr=0x%x,\r\n",
+                         addr, current_sector_addr);
+    flash_manager_printf("        actual_write_size=0x%x, sector_size=0x%x, min_write=0x%x, pages=%i\r\n",
+                         current_write_block_size, current_sector_size, min_prog_size, page_count);
+    return ERROR_SUCCESS;
+}
+
+static error_t setup_random_sector(uint32_t addr)
+{
+    uint32_t min_prog_size;
+    uint32_t sector_size;
+    uint32_t write_block_size;
+    error_t status;
+    min_prog_size = intf->program_page_min_size(addr);
+    sector_size = intf->erase_sector_size(addr);
+
+    if ((min_prog_size <= 0) || (sector_size <= 0)) {
+        // Either of these conditions could cause divide by 0 error
+        util_assert(0);
+        return ERROR_INTERNAL;
+    }
+
+    // Small blocks so that blocks of random data are rarely shared
+    write_block_size = MIN(sector_size, MAX(min_prog_size, FLASH_MANAGER_RANDOM_BLOCK_SIZE));
+    util_assert(sizeof(buf) >= write_block_size);
+    util_assert(sector_size % write_block_size == 0);
+    util_assert(write_block_size % min_prog_size == 0);
+
+    if (0 == current_write_block_size) {
+        status = set_block_size(write_block_size, min_prog_size);
+
+        if (ERROR_SUCCESS != status) {
+            return status;
+        }
+    } else if ((write_block_size != current_write_block_size) || (min_prog_size != current_min_prog_size)) {
+        // The map of programmed blocks is indexed by block size
+        flash_manager_printf("    addr=0x%x changes the block size of a random access image\r\n", addr);
+        return ERROR_INTERNAL;
+    }
+
+    current_sector_addr = ROUND_DOWN(addr, sector_size);
+    current_sector_size = sector_size;
+    flash_manager_printf("    setup_random_sector(addr=0x%x) sect_addr=0x%x, sector_size=0x%x\r\n",
+                         addr, current_sector_addr, current_sector_size);
+    return ERROR_SUCCESS;
+}
+
+static error_t set_block_size(uint32_t write_block_size, uint32_t min_prog_size)
+{
+    error_t status;
+
+    // Buffered blocks cannot be kept if the block size changes
+    status = program_all_pages();
+
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
+
+    reset_pages();
+    current_write_block_size = write_block_size;
+    current_min_prog_size = min_prog_size;
+    page_count = MIN(FLASH_MANAGER_PAGE_COUNT, sizeof(buf) / write_block_size);
+    page_chunk_size = util_div_round_up(write_block_size, PAGE_CHUNK_COUNT);
+    page_full_mask = util_div_round_up(write_block_size, page_chunk_size) >= 32 ? 0xFFFFFFFF :
+                     (1u << util_div_round_up(write_block_size, page_chunk_size)) - 1;
+
+    // Blocks are programmed in units of whole chunks and whole minimum
+    // program sizes so no part of flash is ever programmed twice
+    if (page_chunk_size % min_prog_size == 0) {
+        page_unit_chunks = 1;
+    } else if (min_prog_size % page_chunk_size == 0) {
+        page_unit_chunks = min_prog_size / page_chunk_size;
+    } else {
+        page_unit_chunks = PAGE_CHUNK_COUNT;
+    }
+
+    return ERROR_SUCCESS;
+}
+
+static void reset_pages(void)
+{
+    uint32_t i;
+    memset(buf, 0xFF, sizeof(buf));
+
+    for (i = 0; i < FLASH_MANAGER_PAGE_COUNT; i++) {
+        pages[i].addr = 0;
+        pages[i].filled = 0;
+        pages[i].dirty = 0;
+        pages[i].programmed = 0;
+        pages[i].valid = false;
+        memset(pages[i].fill, 0, sizeof(pages[i].fill));
+        evicted[i] = pages[i];
+    }
+
+    evicted_next = 0;
+}
+
+static error_t get_page(uint32_t addr, uint32_t *index)
+{
+    uint32_t i;
+    uint32_t lowest = 0;
+    bool free_found = false;
+    uint32_t free_index = 0;
+    uint32_t valid_count = 0;
+    uint32_t page_addr = ROUND_DOWN(addr, current_write_block_size);
+    page_t page = {page_addr, 0, 0, 0, true, {0}};
+    bool reopened;
+    bool in_current = (addr >= current_sector_addr) && (addr < current_sector_addr + current_sector_size);
+    bool in_prev = prev_sector_valid && (addr >= prev_sector_addr) && (addr < prev_sector_addr + prev_sector_size);
+
+    for (i = 0; i < page_count; i++) {
+        if (!pages[i].valid) {
+            if (!free_found) {
+                free_found = true;
+                free_index = i;
+            }
+            continue;
+        }
+
+        if (pages[i].addr == page_addr) {
+            *index = i;
+            return ERROR_SUCCESS;
+        }
+
+        if ((0 == valid_count) || (pages[i].addr < pages[lowest].addr)) {
+            lowest = i;
+        }
+        valid_count++;
+    }
+
+    if (random_access) {
+        // Any block that has not been programmed yet can be started
+        reopened = take_evicted_page(page_addr, &page);
+
+        if (!reopened && !random_block_index(page_addr, &i)) {
+            flash_manager_printf("    addr=0x%x outside of random access range\r\n", addr);
+            return ERROR_INTERNAL;
+        }
+
+        if (!reopened && random_block_programmed(page_addr)) {
+            flash_manager_printf("    addr=0x%x already programmed\r\n", addr);
+            return ERROR_INTERNAL;
+        }
+    } else {
+        // New blocks must be in a sector that has been erased.  Blocks below
+        // last_addr have been programmed already unless they were evicted early.
+        if (!in_current && !in_prev) {
+            flash_manager_printf("    addr=0x%x outside of reassembly window\r\n", addr);
+            util_assert(0);
+            return ERROR_INTERNAL;
+        }
+
+        reopened = take_evicted_page(page_addr, &page);
+
+        if (!reopened && (page_addr < last_addr)) {
+            flash_manager_printf("    addr=0x%x already programmed\r\n", addr);
+            util_assert(0);
+            return ERROR_INTERNAL;
+        }
+    }
+
+    if (!free_found) {
+        bool programmed;
+        error_t status;
+
+        // Blocks are programmed in ascending order so the lowest one can
+        // only make room for data that comes after it or for an evicted block
+        if (!random_access && !reopened && (page_addr < pages[lowest].addr)) {
+            flash_manager_printf("    addr=0x%x below buffered blocks\r\n", addr);
+            util_assert(0);
+            return ERROR_INTERNAL;
+        }
+
+        status = program_lowest_page(false, &programmed);
+
         if (ERROR_SUCCESS != status) {
-            intf->uninit();
             return status;
-        }         
+        }
+
+        free_index = lowest;
     }
 
-    // Clear out buffer in case block size changed
-    memset(buf, 0xFF, current_write_block_size);
-    flash_manager_printf("    setup_next_sector(addr=0x%x) sect_addr=0x%x, write_addr=0x%x,\r\n",
-                         addr, current_sector_addr, current_write_block_addr);
-    flash_manager_printf("        actual_write_size=0x%x, sector_size=0x%x, min_write=0x%x\r\n",
-                         current_write_block_size, current_sector_size, min_prog_size);
+    pages[free_index] = page;
+    *index = free_index;
     return ERROR_SUCCESS;
 }
+
+// Remove the evicted block at page_addr from the list so the rest of
+// its data can be merged into it
+static bool take_evicted_page(uint32_t page_addr, page_t *page)
+{
+    uint32_t i;
+
+    for (i = 0; i < FLASH_MANAGER_PAGE_COUNT; i++) {
+        if (evicted[i].valid && (evicted[i].addr == page_addr)) {
+            *page = evicted[i];
+            evicted[i].valid = false;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool mark_page_filled(page_t *page, uint32_t pos, uint32_t size)
+{
+    uint32_t first = pos / page_chunk_size;
+    uint32_t end = pos + size;
+    uint32_t touched = 0;
+    uint32_t start;
+    uint32_t stop;
+    uint32_t i;
+
+    for (i = first; (i < PAGE_CHUNK_COUNT) && (i * page_chunk_size < end); i++) {
+        touched |= 1u << i;
+    }
+
+    if (touched & page->programmed) {
+        return false;
+    }
+
+    page->dirty |= touched;
+
+    // Only chunks that are written in full count towards a complete block.
+    // That can take several writes, such as 16 byte Intel HEX records, so
+    // each chunk keeps how far it has been written without a gap.
+    for (i = first; (i < PAGE_CHUNK_COUNT) && (touched & (1u << i)); i++) {
+        start = i * page_chunk_size;
+        stop = MIN(start + page_chunk_size, current_write_block_size);
+
+        if (pos <= start + page->fill[i]) {
+            page->fill[i] = MAX(page->fill[i], MIN(end, stop) - start);
+        }
+
+        if (start + page->fill[i] >= stop) {
+            page->filled |= 1u << i;
+        }
+    }
+
+    return true;
+}
+
+// Program the units of a block that hold new data.  A complete block is
+// programmed with a single call.
+static error_t program_page_units(page_t *page, uint8_t *page_buf)
+{
+    uint32_t unit_mask = page_unit_chunks >= 32 ? 0xFFFFFFFF : (1u << page_unit_chunks) - 1;
+    uint32_t unit_size = page_unit_chunks * page_chunk_size;
+    uint32_t run_start = 0;
+    uint32_t run_size = 0;
+    uint32_t pos;
+    error_t status = ERROR_SUCCESS;
+
+    for (pos = 0; pos <= current_write_block_size; pos += unit_size) {
+        uint32_t mask = 0;
+        uint32_t size = 0;
+
+        if (pos < current_write_block_size) {
+            mask = (unit_mask << (pos / page_chunk_size)) & page_full_mask;
+            size = MIN(unit_size, current_write_block_size - pos);
+        }
+
+        if (mask & page->dirty & ~page->programmed) {
+            if (0 == run_size) {
+                run_start = pos;
+            }
+
+            run_size += size;
+            page->programmed |= mask;
+            continue;
+        }
+
+        if (run_size > 0) {
+            status = intf->program_page(page->addr + run_start, page_buf + run_start, run_size);
+            flash_manager_printf("    intf->program_page(addr=0x%x, size=0x%x) ret=%i\r\n",
+                                 page->addr + run_start, run_size, status);
+            run_size = 0;
+
+            if (ERROR_SUCCESS != status) {
+                break;
+            }
+        }
+    }
+
+    return status;
+}
+
+static error_t program_lowest_page(bool only_if_full, bool *programmed)
+{
+    uint32_t i;
+    uint32_t lowest = 0;
+    bool found = false;
+    uint8_t *page_buf;
+    error_t status;
+    *programmed = false;
+
+    for (i = 0; i < page_count; i++) {
+        // A complete block is only programmed once nothing can come before
+        // it, which is right away for random access
+        if (only_if_full && ((pages[i].filled != page_full_mask) ||
+                             (!random_access && (pages[i].addr > last_addr)))) {
+            continue;
+        }
+
+        if (pages[i].valid && (!found || (pages[i].addr < pages[lowest].addr))) {
+            lowest = i;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        return ERROR_SUCCESS;
+    }
+
+    page_buf = buf + lowest * current_write_block_size;
+    status = ERROR_SUCCESS;
+
+    if (random_access) {
+        status = random_erase_sector(pages[lowest].addr);
+
+        if (random_block_index(pages[lowest].addr, &i)) {
+            random_programmed[i / 32] |= 1u << (i % 32);
+        }
+    }
+
+    if (ERROR_SUCCESS == status) {
+        status = program_page_units(&pages[lowest], page_buf);
+    }
+
+    last_addr = MAX(last_addr, pages[lowest].addr + current_write_block_size);
+    pages[lowest].valid = false;
+    memset(page_buf, 0xFF, current_write_block_size);
+
+    // Remember which parts of a partially written block are still erased
+    if ((ERROR_SUCCESS == status) && (pages[lowest].programmed != page_full_mask)) {
+        evicted[evicted_next] = pages[lowest];
+        evicted[evicted_next].valid = true;
+        evicted[evicted_next].filled = pages[lowest].programmed;
+        evicted[evicted_next].dirty = pages[lowest].programmed;
+        evicted_next = (evicted_next + 1) % FLASH_MANAGER_PAGE_COUNT;
+    }
+
+    if (ERROR_SUCCESS == status) {
+        status = erase_next_sector_start();
+    }
+
+    *programmed = ERROR_SUCCESS == status;
+    return status;
+}
+
+static error_t erase_next_sector_start(void)
+{
+    uint32_t next_sector_addr = current_sector_addr + current_sector_size;
+    error_t status;
+
+    // Once the current sector is fully programmed start erasing the next
+    // one, so the erase runs while its data is still being received.
+    // Starting any earlier would only stall programming of this sector.
+    if ((FLASH_ERASE_SECTOR_AHEAD != erase_mode) || erase_ahead_valid ||
+            (last_addr != next_sector_addr) || (next_sector_addr <= current_sector_addr) ||
+            (next_sector_addr >= erase_end_addr)) {
+        return ERROR_SUCCESS;
+    }
+
+    status = intf->erase_sector_start(next_sector_addr);
+    flash_manager_printf("    intf->erase_sector_start(addr=0x%x) ret=%i\r\n", next_sector_addr, status);
+
+    if (ERROR_SUCCESS == status) {
+        erase_ahead_valid = true;
+        erase_ahead_addr = next_sector_addr;
+    }
+
+    return status;
+}
+
+// Index of the block at page_addr in the map of programmed blocks
+static bool random_block_index(uint32_t page_addr, uint32_t *index)
+{
+    if (page_addr < random_base) {
+        return false;
+    }
+
+    *index = (page_addr - random_base) / current_write_block_size;
+    return *index < FLASH_MANAGER_RANDOM_BLOCK_COUNT;
+}
+
+static bool random_block_programmed(uint32_t page_addr)
+{
+    uint32_t index;
+
+    if (!random_block_index(page_addr, &index)) {
+        return false;
+    }
+
+    return (random_programmed[index / 32] & (1u << (index % 32))) != 0;
+}
+
+// Erase the sector of a block right before the first block in it is
+// programmed.  A sector with a programmed block was erased already.
+static error_t random_erase_sector(uint32_t page_addr)
+{
+    uint32_t sector_size;
+    uint32_t sector_addr;
+    uint32_t addr;
+    error_t status;
+
+    if (FLASH_ERASE_CHIP == erase_mode) {
+        return ERROR_SUCCESS;
+    }
+
+    sector_size = intf->erase_sector_size(page_addr);
+
+    if (0 == sector_size) {
+        util_assert(0);
+        return ERROR_INTERNAL;
+    }
+
+    sector_addr = ROUND_DOWN(page_addr, sector_size);
+
+    for (addr = sector_addr; addr < sector_addr + sector_size; addr += current_write_block_size) {
+        if (random_block_programmed(addr)) {
+            return ERROR_SUCCESS;
+        }
+    }
+
+    status = intf->erase_sector(sector_addr);
+    flash_manager_printf("    intf->erase_sector(addr=0x%x) ret=%i\r\n", sector_addr, status);
+    return status;
+}
+
+static error_t program_full_pages(void)
+{
+    bool programmed = true;
+    error_t status = ERROR_SUCCESS;
+
+    while (programmed && (ERROR_SUCCESS == status)) {
+        status = program_lowest_page(true, &programmed);
+    }
+
+    return status;
+}
+
+static error_t program_all_pages(void)
+{
+    bool programmed = true;
+    error_t status = ERROR_SUCCESS;
+
+    while (programmed && (ERROR_SUCCESS == status)) {
+        status = program_lowest_page(false, &programmed);
+    }
+
+    return status;
+}
@@ -31,10 +31,26 @@
 extern "C" {
 #endif
 
+typedef enum {
+    FLASH_ERASE_CHIP,           // Erase the whole chip when the manager is initialized
+    FLASH_ERASE_SECTOR,         // Erase each sector right before it is first written
+    FLASH_ERASE_SECTOR_AHEAD,   // Erase each sector, and the next one in the background once it is programmed
+} flash_erase_mode_t;
+
 error_t flash_manager_init(const flash_intf_t *flash_intf);
 error_t flash_manager_data(uint32_t addr, const uint8_t *data, uint32_t size);
+// Get space in the page buffer for up to size bytes of data at addr, so
+// it can be decoded in place. The data counts once it is committed and
+// nothing else may be written in between.
+error_t flash_manager_get_span(uint32_t addr, uint32_t size, uint8_t **span, uint32_t *span_size);
+error_t flash_manager_commit(uint32_t addr, uint32_t size);
 error_t flash_manager_uninit(void);
 void flash_manager_set_page_erase(bool enabled);
+void flash_manager_set_erase_mode(flash_erase_mode_t mode, uint32_t erase_end_addr);
+// Accept data for any block from base_addr on in any order, for images whose
+// blocks carry their own address.  Each sector is erased right before its
+// first block is programmed.  Takes effect on the next flash_manager_init.
+void flash_manager_set_random_access(bool enabled, uint32_t base_addr);
 
 #ifdef __cplusplus
 }
@@ -44,6 +44,11 @@ COMPILER_ASSERT(DAPLINK_ROM_UPDATE_START % DAPLINK_SECTOR_SIZE == 0);
 // Update size must be a multiple of sector size
 COMPILER_ASSERT(DAPLINK_ROM_UPDATE_SIZE % DAPLINK_SECTOR_SIZE == 0);
 
+// Value of erased HIC flash.  A HIC can override this in daplink_addr.h
+#ifndef DAPLINK_ERASED_VALUE
+#define DAPLINK_ERASED_VALUE            0xFF
+#endif
+
 typedef enum {
     STATE_CLOSED,
     STATE_OPEN,
@@ -74,6 +79,7 @@ static const flash_intf_t flash_intf = {
     program_page_min_size,
     erase_sector_size,
     target_flash_busy,
+    0,                  // erase_sector_start - IAP erase always blocks
 };
 
 const flash_intf_t *const flash_intf_iap_protected = &flash_intf;
@@ -84,10 +90,12 @@ static bool mass_erase_performed;
 static bool current_sector_set;
 static uint32_t current_sector;
 static uint32_t current_sector_size;
+static bool prev_sector_set;
+static uint32_t prev_sector;
 static bool current_page_set;
 static uint32_t current_page;
 static uint32_t current_page_write_size;
-static uint32_t crc;
+static crc32_ctx_t crc;
 static uint8_t sector_buf[DAPLINK_SECTOR_SIZE];
 
 static error_t init()
@@ -115,10 +123,12 @@ static error_t init()
     current_sector_set = false;
     current_sector = 0;
     current_sector_size = 0;
+    prev_sector_set = false;
+    prev_sector = 0;
     current_page_set = false;
     current_page = 0;
     current_page_write_size = 0;
-    crc = 0;
+    crc32_init(&crc);
     memset(sector_buf, 0, sizeof(sector_buf));
     state = STATE_OPEN;
     return ERROR_SUCCESS;
@@ -188,7 +198,8 @@ static error_t program_page(uint32_t addr, const uint8_t *buf, uint32_t size)
         return ERROR_INTERNAL;
     }
 
-    // Write must be in an erased sector (current_sector is always erased if it is set)
+    // Write must be in an erased sector (current_sector is always erased if it is set).
+    // The sector erased before it may still be finishing its last pages.
     if (!mass_erase_performed) {
         if (!current_sector_set) {
             util_assert(0);
@@ -196,7 +207,8 @@ static error_t program_page(uint32_t addr, const uint8_t *buf, uint32_t size)
             return ERROR_INTERNAL;
         }
 
-        if ((addr < current_sector) || (addr >= current_sector + current_sector_size)) {
+        if (((addr < current_sector) || (addr >= current_sector + current_sector_size)) &&
+                (!prev_sector_set || (addr < prev_sector) || (addr >= current_sector))) {
             util_assert(0);
             state = STATE_ERROR;
             return ERROR_INTERNAL;
@@ -230,11 +242,14 @@ static error_t program_page(uint32_t addr, const uint8_t *buf, uint32_t size)
         return status;
     }
 
-    iap_status = flash_program_page(addr, size, (uint8_t *)buf);
+    // Erased flash already holds this data so skip the write
+    if (!util_is_filled(buf, size, DAPLINK_ERASED_VALUE)) {
+        iap_status = flash_program_page(addr, size, (uint8_t *)buf);
 
-    if (iap_status != 0) {
-        state = STATE_ERROR;
-        return ERROR_IAP_WRITE;
+        if (iap_status != 0) {
+            state = STATE_ERROR;
+            return ERROR_IAP_WRITE;
+        }
     }
 
     if (addr + size >= updt_end) {
@@ -278,6 +293,8 @@ static error_t erase_sector(uint32_t addr)
         return ERROR_IAP_ERASE_SECTOR;
     }
 
+    prev_sector_set = current_sector_set;
+    prev_sector = current_sector;
     current_sector_set = true;
     current_sector = addr;
     current_sector_size = sector_size;
@@ -389,7 +406,7 @@ static error_t intercept_page_write(uint32_t addr, const uint8_t *buf, uint32_t
 
     /* Everything below here is interface specific */
     crc_size = MIN(size, updt_end - addr - 4);
-    crc = crc32_continue(crc, buf, crc_size);
+    crc32_update(&crc, buf, crc_size);
 
     // Intercept the data if it is in the first sector
     if ((addr >= updt_start) && (addr < updt_start + DAPLINK_SECTOR_SIZE)) {
@@ -408,7 +425,7 @@ static error_t intercept_page_write(uint32_t addr, const uint8_t *buf, uint32_t
                                 (buf[size_left - 2] << 16) |
                                 (buf[size_left - 1] << 24);
 
-        if (crc != crc_in_image) {
+        if (crc32_final(&crc) != crc_in_image) {
             return ERROR_BL_UPDT_BAD_CRC;
         }
 
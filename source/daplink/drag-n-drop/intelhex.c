@@ -33,198 +33,309 @@ enum hex_record_t {
     START_LINEAR_ADDR_RECORD = 5
 };
 
-typedef union hex_line_t hex_line_t;
-union __attribute__((packed)) hex_line_t {
-    uint8_t buf[0x25];
-    struct __attribute__((packed)) {
-        uint8_t  byte_count;
-        uint16_t address;
-        uint8_t  record_type;
-        uint8_t  data[0x25 - 0x5];
-        uint8_t  checksum;
-    };
+typedef enum hex_field_t hex_field_t;
+enum hex_field_t {
+    FIELD_START,            // Waiting for the ':' of the next record
+    FIELD_BYTE_COUNT,
+    FIELD_ADDRESS_HIGH,
+    FIELD_ADDRESS_LOW,
+    FIELD_RECORD_TYPE,
+    FIELD_DATA,
+    FIELD_CHECKSUM
 };
 
-/** Swap 16bit value - let compiler figure out the best way
- *  @param val a variable of size uint16_t to be swapped
- *  @return the swapped value
- */
-static uint16_t swap16(uint16_t a)
+// Value of each hex digit with bit 4 set, 0 for anything else. Two valid
+// digits combine to a byte when shifted and or'ed and the low nibble is
+// kept clear of the marker.
+#define NIBBLE_VALID    0x10
+static const uint8_t nibble_table[256] = {
+    ['0'] = 0x10, ['1'] = 0x11, ['2'] = 0x12, ['3'] = 0x13, ['4'] = 0x14,
+    ['5'] = 0x15, ['6'] = 0x16, ['7'] = 0x17, ['8'] = 0x18, ['9'] = 0x19,
+    ['A'] = 0x1A, ['B'] = 0x1B, ['C'] = 0x1C, ['D'] = 0x1D, ['E'] = 0x1E, ['F'] = 0x1F,
+    ['a'] = 0x1A, ['b'] = 0x1B, ['c'] = 0x1C, ['d'] = 0x1D, ['e'] = 0x1E, ['f'] = 0x1F,
+};
+
+// Decoder state, kept between calls so records can span blobs
+static hex_field_t field = FIELD_START;
+static uint8_t high_nibble = 0;             // Pending high digit, 0 if none
+static uint8_t checksum = 0;                // Sum of the record bytes so far
+static uint8_t byte_count = 0;
+static uint8_t record_type = 0;
+static uint8_t data_pos = 0;                // Data bytes of the record decoded
+static uint16_t address = 0;
+static uint8_t ext_addr[2] = {0};
+static uint32_t base_address = 0;           // From the last extended address record
+
+// Output span for the current call
+static uint8_t *span = 0;
+static uint32_t span_addr = 0;
+static uint32_t span_left = 0;
+static uint32_t span_used = 0;
+
+// Output state of parse_hex_blob()
+static uint8_t *blob_buf;
+static uint32_t blob_buf_size;
+static uint32_t blob_buf_cnt;
+static uint32_t blob_buf_address;
+
+void reset_hex_parser(void)
 {
-    return ((a & 0x00ff) << 8) | ((a & 0xff00) >> 8);
+    field = FIELD_START;
+    high_nibble = 0;
+    checksum = 0;
+    byte_count = 0;
+    record_type = 0;
+    data_pos = 0;
+    address = 0;
+    memset(ext_addr, 0, sizeof(ext_addr));
+    base_address = 0;
+    span = 0;
+    span_left = 0;
+    span_used = 0;
 }
 
-/** Converts a character representation of a hex to real value.
- *   @param c is the hex value in char format
- *   @return the value of the hex
+/** Account for the data decoded into the current span
+ *  @param output Destination of the decoded data
+ *  @return false if the output wants decoding to stop
  */
-static uint8_t ctoh(char c)
+static bool span_commit(const hex_output_t *output)
 {
-    return (c & 0x10) ? /*0-9*/ c & 0xf : /*A-F, a-f*/ (c & 0xf) + 9;
+    bool ok = true;
+
+    if (span_used) {
+        ok = output->commit(output->context, span_addr, span_used);
+        span_addr += span_used;
+        span_used = 0;
+    }
+
+    return ok;
 }
 
-/** Calculate checksum on a hex record
- *   @param data is the line of hex record
- *   @param size is the length of the data array
- *   @return 1 if the data provided is a valid hex record otherwise 0
+/** Make sure there is room for the next data byte of the record
+ *  @param output Destination of the decoded data
+ *  @return false if the output wants decoding to stop
  */
-static uint8_t validate_checksum(hex_line_t *record)
+static bool span_reserve(const hex_output_t *output)
 {
-    uint8_t result = 0, i = 0;
+    if (span_left) {
+        return true;
+    }
 
-    for (; i < (record->byte_count + 5); i++) {
-        result += record->buf[i];
+    if (!span_commit(output)) {
+        return false;
     }
 
-    return (result == 0);
-}
+    span_addr = base_address + address + data_pos;
+    span = output->span(output->context, span_addr, byte_count - data_pos, &span_left);
 
-static hex_line_t line = {0}, shadow_line = {0};
-static uint32_t next_address_to_write = 0;
-static uint8_t low_nibble = 0, idx = 0, record_processed = 0, load_unaligned_record = 0;
+    if (0 == span) {
+        span_left = 0;
+    }
 
-void reset_hex_parser(void)
-{
-    memset(line.buf, 0, sizeof(hex_line_t));
-    memset(shadow_line.buf, 0, sizeof(hex_line_t));
-    next_address_to_write = 0;
-    low_nibble = 0;
-    idx = 0;
-    record_processed = 0;
-    load_unaligned_record = 0;
+    return span_left != 0;
 }
 
-hexfile_parse_status_t parse_hex_blob(const uint8_t *hex_blob, const uint32_t hex_blob_size, uint32_t *hex_parse_cnt, uint8_t *bin_buf, const uint32_t bin_buf_size, uint32_t *bin_buf_address, uint32_t *bin_buf_cnt)
+hexfile_parse_status_t hex_decode(const uint8_t *hex_blob, const uint32_t hex_blob_size, uint32_t *hex_parse_cnt, const hex_output_t *output)
 {
-    uint8_t *end = (uint8_t *)hex_blob + hex_blob_size;
-    hexfile_parse_status_t status = HEX_PARSE_UNINIT;
-    // reset the amount of data that is being return'd
-    *bin_buf_cnt = (uint32_t)0;
-
-    // we had an exit state where the address was unaligned to the previous record and data count.
-    //  Need to pop the last record into the buffer before decoding anthing else since it was
-    //  already decoded.
-    if (load_unaligned_record) {
-        // need some help...
-        load_unaligned_record = 0;
-        // move from line buffer back to input buffer
-        memcpy((uint8_t *)bin_buf, (uint8_t *)line.data, line.byte_count);
-        bin_buf += line.byte_count;
-        *bin_buf_cnt = (uint32_t)(*bin_buf_cnt) + line.byte_count;
-        // Store next address to write
-        next_address_to_write = ((next_address_to_write & 0xffff0000) | line.address) + line.byte_count;
-    }
+    const uint8_t *pos = hex_blob;
+    const uint8_t *end = hex_blob + hex_blob_size;
+    hexfile_parse_status_t status = HEX_PARSE_OK;
+    uint32_t count;
+    uint8_t hi, lo, value;
 
-    while (hex_blob != end) {
-        switch ((uint8_t)(*hex_blob)) {
-            // we've hit the end of an ascii line
-            // junk we dont care about could also just run the validate_checksum on &line
-            case '\r':
-            case '\n':
-                if (0 == validate_checksum(&line)) {
-                    status = HEX_PARSE_CKSUM_FAIL;
-                    goto hex_parser_exit;
-                } else {
-                    if (!record_processed) {
-                        record_processed = 1;
-                        // address byteswap...
-                        line.address = swap16(line.address);
-
-                        switch (line.record_type) {
-                            case DATA_RECORD:
-                                // keeping a record of the last hex record
-                                memcpy(shadow_line.buf, line.buf, sizeof(hex_line_t));
-
-                                // verify this is a continous block of memory or need to exit and dump
-                                if (((next_address_to_write & 0xffff0000) | line.address) != next_address_to_write) {
-                                    load_unaligned_record = 1;
-                                    status = HEX_PARSE_UNALIGNED;
-                                    goto hex_parser_exit;
-                                }
-
-                                // move from line buffer back to input buffer
-                                memcpy(bin_buf, line.data, line.byte_count);
-                                bin_buf += line.byte_count;
-                                *bin_buf_cnt = (uint32_t)(*bin_buf_cnt) + line.byte_count;
-                                // Save next address to write
-                                next_address_to_write = ((next_address_to_write & 0xffff0000) | line.address) + line.byte_count;
-                                break;
-
-                            case EOF_RECORD:
-                                // pad rest of the buffer with 0xff
-                                //memset(bin_buf, 0xff, (bin_buf_size - (uint32_t)(*bin_buf_cnt)));
-                                //*bin_buf_cnt = bin_buf_size;
-                                status = HEX_PARSE_EOF;
-                                goto hex_parser_exit;
-
-                            case EXT_SEG_ADDR_RECORD:
-                                // Could have had data in the buffer so must exit and try to program
-                                //  before updating bin_buf_address with next_address_to_write
-                                memset(bin_buf, 0xff, (bin_buf_size - (uint32_t)(*bin_buf_cnt)));
-                                // figure the start address for the buffer before returning
-                                *bin_buf_address = next_address_to_write - (uint32_t)(*bin_buf_cnt);
-                                *hex_parse_cnt = (uint32_t)(hex_blob_size - (end - hex_blob));
-                                // update the address msb's
-                                next_address_to_write = (next_address_to_write & 0x00000000) | ((line.data[0] << 12) | (line.data[1] << 4));
-                                // Need to exit and program if buffer has been filled
-                                status = HEX_PARSE_UNALIGNED;
-                                return status;
-
-                            case EXT_LINEAR_ADDR_RECORD:
-                                // Could have had data in the buffer so must exit and try to program
-                                //  before updating bin_buf_address with next_address_to_write
-                                //  Good catch Gaute!!
-                                memset(bin_buf, 0xff, (bin_buf_size - (uint32_t)(*bin_buf_cnt)));
-                                // figure the start address for the buffer before returning
-                                *bin_buf_address = next_address_to_write - (uint32_t)(*bin_buf_cnt);
-                                *hex_parse_cnt = (uint32_t)(hex_blob_size - (end - hex_blob));
-                                // update the address msb's
-                                next_address_to_write = (next_address_to_write & 0x00000000) | ((line.data[0] << 24) | (line.data[1] << 16));
-                                // Need to exit and program if buffer has been filled
-                                status = HEX_PARSE_UNALIGNED;
-                                return status;
-
-                            default:
-                                break;
-                        }
-                    }
+    span_left = 0;
+    span_used = 0;
+
+    while (pos != end) {
+        if (FIELD_START == field) {
+            // Line endings and anything else between records are skipped
+            if (':' == *pos++) {
+                field = FIELD_BYTE_COUNT;
+                high_nibble = 0;
+                checksum = 0;
+            }
+            continue;
+        }
+
+        // Data is decoded two digits at a time straight into the output
+        if ((FIELD_DATA == field) && (DATA_RECORD == record_type) && (0 == high_nibble) && (end - pos >= 2)) {
+            if (!span_reserve(output)) {
+                status = HEX_PARSE_OUTPUT_STOP;
+                goto hex_decode_exit;
+            }
+
+            count = byte_count - data_pos;
+            count = (count < span_left) ? count : span_left;
+            count = (count < (uint32_t)(end - pos) / 2) ? count : (uint32_t)(end - pos) / 2;
+            span_left -= count;
+
+            while (count--) {
+                hi = nibble_table[pos[0]];
+                lo = nibble_table[pos[1]];
+
+                if (!(hi & lo & NIBBLE_VALID)) {
+                    status = HEX_PARSE_FAILURE;
+                    goto hex_decode_exit;
                 }
 
+                value = (uint8_t)((hi << 4) | (lo & 0x0F));
+                *span++ = value;
+                checksum += value;
+                span_used++;
+                data_pos++;
+                pos += 2;
+            }
+
+            if (data_pos == byte_count) {
+                field = FIELD_CHECKSUM;
+            }
+            continue;
+        }
+
+        // One digit at a time for the record header, the checksum and
+        // bytes split between blobs
+        lo = nibble_table[*pos];
+
+        if (!(lo & NIBBLE_VALID)) {
+            status = HEX_PARSE_FAILURE;
+            goto hex_decode_exit;
+        }
+
+        if (0 == high_nibble) {
+            high_nibble = lo;
+            pos++;
+            continue;
+        }
+
+        if ((FIELD_DATA == field) && (DATA_RECORD == record_type) && !span_reserve(output)) {
+            status = HEX_PARSE_OUTPUT_STOP;
+            goto hex_decode_exit;
+        }
+
+        pos++;
+        value = (uint8_t)((high_nibble << 4) | (lo & 0x0F));
+        high_nibble = 0;
+        checksum += value;
+
+        switch (field) {
+            case FIELD_BYTE_COUNT:
+                byte_count = value;
+                field = FIELD_ADDRESS_HIGH;
                 break;
 
-            // found start of a new record. reset state variables
-            case ':':
-                memset(line.buf, 0, sizeof(hex_line_t));
-                low_nibble = 0;
-                idx = 0;
-                record_processed = 0;
+            case FIELD_ADDRESS_HIGH:
+                address = value << 8;
+                field = FIELD_ADDRESS_LOW;
                 break;
 
-            // decoding lines
-            default:
-                if (low_nibble) {
-                    line.buf[idx] |= ctoh((uint8_t)(*hex_blob)) & 0xf;
-                    idx++;
-                } else {
-                    if (idx < sizeof(hex_line_t)) {
-                        line.buf[idx] = ctoh((uint8_t)(*hex_blob)) << 4;
-                    }
+            case FIELD_ADDRESS_LOW:
+                address |= value;
+                field = FIELD_RECORD_TYPE;
+                break;
+
+            case FIELD_RECORD_TYPE:
+                record_type = value;
+                data_pos = 0;
+                field = byte_count ? FIELD_DATA : FIELD_CHECKSUM;
+                break;
+
+            case FIELD_DATA:
+                if (DATA_RECORD == record_type) {
+                    *span++ = value;
+                    span_left--;
+                    span_used++;
+                } else if (data_pos < sizeof(ext_addr)) {
+                    ext_addr[data_pos] = value;
+                }
+
+                if (++data_pos == byte_count) {
+                    field = FIELD_CHECKSUM;
+                }
+                break;
+
+            case FIELD_CHECKSUM:
+                field = FIELD_START;
+
+                if (0 != checksum) {
+                    status = HEX_PARSE_CKSUM_FAIL;
+                    goto hex_decode_exit;
                 }
 
-                low_nibble = !low_nibble;
+                switch (record_type) {
+                    case EOF_RECORD:
+                        status = HEX_PARSE_EOF;
+                        goto hex_decode_exit;
+
+                    case EXT_SEG_ADDR_RECORD:
+                        base_address = ((ext_addr[0] << 8) | ext_addr[1]) << 4;
+                        break;
+
+                    case EXT_LINEAR_ADDR_RECORD:
+                        base_address = ((ext_addr[0] << 8) | ext_addr[1]) << 16;
+                        break;
+
+                    default:
+                        break;
+                }
+                break;
+
+            default:
                 break;
         }
+    }
+
+hex_decode_exit:
+    // Data of a record still being decoded is handed over as well, a later
+    // checksum failure ends the whole image anyway
+    if (!span_commit(output) && (HEX_PARSE_OK == status)) {
+        status = HEX_PARSE_OUTPUT_STOP;
+    }
+
+    span_left = 0;
+    *hex_parse_cnt = (uint32_t)(pos - hex_blob);
+    return status;
+}
+
+static uint8_t *blob_span(void *context, uint32_t addr, uint32_t size, uint32_t *span_size)
+{
+    // Only contiguous data fits, anything else has to be returned first
+    if (0 == blob_buf_cnt) {
+        blob_buf_address = addr;
+    } else if (addr != blob_buf_address + blob_buf_cnt) {
+        return 0;
+    }
+
+    *span_size = blob_buf_size - blob_buf_cnt;
+    *span_size = (size < *span_size) ? size : *span_size;
+    return blob_buf + blob_buf_cnt;
+}
+
+static bool blob_commit(void *context, uint32_t addr, uint32_t size)
+{
+    blob_buf_cnt += size;
+    return true;
+}
+
+hexfile_parse_status_t parse_hex_blob(const uint8_t *hex_blob, const uint32_t hex_blob_size, uint32_t *hex_parse_cnt, uint8_t *bin_buf, const uint32_t bin_buf_size, uint32_t *bin_buf_address, uint32_t *bin_buf_cnt)
+{
+    const hex_output_t output = {blob_span, blob_commit, 0};
+    hexfile_parse_status_t status;
+
+    blob_buf = bin_buf;
+    blob_buf_size = bin_buf_size;
+    blob_buf_cnt = 0;
+    blob_buf_address = 0;
+
+    status = hex_decode(hex_blob, hex_blob_size, hex_parse_cnt, &output);
 
-        hex_blob++;
+    // A full buffer or data that is not contiguous has to be programmed
+    // before the rest of the blob is decoded
+    if (HEX_PARSE_OUTPUT_STOP == status) {
+        status = HEX_PARSE_UNALIGNED;
     }
 
-    // decoded an entire hex block - verify (cant do this hex_parse_cnt is figured below)
-    //status = (hex_blob_size == (uint32_t)(*hex_parse_cnt)) ? HEX_PARSE_OK : HEX_PARSE_FAILURE;
-    status = HEX_PARSE_OK;
-hex_parser_exit:
-    memset(bin_buf, 0xff, (bin_buf_size - (uint32_t)(*bin_buf_cnt)));
-    // figure the start address for the buffer before returning
-    *bin_buf_address = next_address_to_write - (uint32_t)(*bin_buf_cnt);
-    *hex_parse_cnt = (uint32_t)(hex_blob_size - (end - hex_blob));
+    memset(bin_buf + blob_buf_cnt, 0xff, bin_buf_size - blob_buf_cnt);
+    *bin_buf_address = blob_buf_address;
+    *bin_buf_cnt = blob_buf_cnt;
     return status;
 }
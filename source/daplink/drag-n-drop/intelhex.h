@@ -27,6 +27,7 @@
  */
 
 #include "stdint.h"
+#include "stdbool.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -42,9 +43,23 @@ typedef enum {
     HEX_PARSE_LINE_OVERRUN, /*!< Error state when the record length is longer than the record structure */
     HEX_PARSE_CKSUM_FAIL,   /*!< Error state when the record checksum doesnt properly compute */
     HEX_PARSE_UNINIT,       /*!< Default state. Return of this type is unrecoverable logic error */
-    HEX_PARSE_FAILURE       /*!< Amount of hex data to decode didnt match the parsing logics count of decoded bytes */
+    HEX_PARSE_FAILURE,      /*!< Amount of hex data to decode didnt match the parsing logics count of decoded bytes */
+    HEX_PARSE_OUTPUT_STOP   /*!< The output of hex_decode() could not take more data. Continue from where parsing stopped */
 } hexfile_parse_status_t;
 
+/** Destination of the data decoded by hex_decode()
+ *  @struct hex_output_t
+ */
+typedef struct {
+    /** Get space for up to size bytes of data at addr. Return NULL or a
+     *  span_size of 0 to stop decoding. */
+    uint8_t *(*span)(void *context, uint32_t addr, uint32_t size, uint32_t *span_size);
+    /** Account for size bytes decoded into the last span. Return false to
+     *  stop decoding. */
+    bool (*commit)(void *context, uint32_t addr, uint32_t size);
+    void *context;
+} hex_output_t;
+
 /** Prepare any state that is maintained for the start of a file
  *  @param none
  *  @return none
@@ -63,6 +78,15 @@ void reset_hex_parser(void);
  */
 hexfile_parse_status_t parse_hex_blob(const uint8_t *hex_blob, const uint32_t hex_blob_size, uint32_t *hex_parse_cnt, uint8_t *bin_buf, const uint32_t bin_buf_size, uint32_t *bin_buf_address, uint32_t *bin_buf_cnt);
 
+/** Decode a blob of hex data straight into the space given by an output
+ *  @param hex_blob A block of ascii encoded hexfile data
+ *  @param hex_blob_size The amount of valid data in the hex_blob
+ *  @param hex_parse_cnt The amount of hex_blob data from the call that was parsed
+ *  @param output Where the decoded data goes. Spans are committed before returning.
+ *  @return A member of hex_parse_status_t that describes the state of decoding
+ */
+hexfile_parse_status_t hex_decode(const uint8_t *hex_blob, const uint32_t hex_blob_size, uint32_t *hex_parse_cnt, const hex_output_t *output);
+
 #ifdef __cplusplus
 }
 #endif
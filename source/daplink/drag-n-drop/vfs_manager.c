@@ -380,6 +380,7 @@ static void build_filesystem()
 {
     // Update anything that could have changed file system state
     file_transfer_state = default_transfer_state;
+    flash_decoder_set_image_size(0, false);
     vfs_user_build_filesystem();
     vfs_set_file_change_callback(file_change_handler);
     // Set mass storage parameters
@@ -492,6 +493,7 @@ static void file_data_handler(uint32_t sector, const uint8_t *buf, uint32_t num_
 {
     stream_type_t stream;
     uint32_t size;
+    uint32_t count;
 
     // this is the key for starting a file write - we dont care what file types are sent
     //  just look for something unique (NVIC table, hex, srec, etc) until root dir is updated
@@ -504,9 +506,29 @@ static void file_data_handler(uint32_t sector, const uint8_t *buf, uint32_t num_
         }
     }
 		
+    if (file_transfer_state.stream_started && (STREAM_TYPE_UF2 == file_transfer_state.stream)) {
+        // UF2 blocks carry their own address so sectors are taken in any
+        // order and the stream drops the ones it has seen already. The
+        // file starts at the lowest sector written. Only new blocks count
+        // towards the size transferred, see transfer_stream_data.
+        size = VFS_SECTOR_SIZE * num_of_sectors;
+        file_transfer_state.start_sector = MIN(file_transfer_state.start_sector, sector);
+        file_transfer_state.file_next_sector = MAX(file_transfer_state.file_next_sector, sector + num_of_sectors);
+
+        if (file_transfer_state.stream_finished) {
+            transfer_update_state(ERROR_SUCCESS);
+            return;
+        }
+
+        transfer_stream_data(sector, buf, size);
+        return;
+    }
+
     if (file_transfer_state.stream_started) {
-        // Ignore sectors coming before this file
-        if (sector < file_transfer_state.start_sector) {
+        // Ignore sectors coming before this file.  A fragmented file
+        // can continue below its first sector.
+        if ((sector < file_transfer_state.start_sector) &&
+                (sector != file_transfer_state.file_next_sector)) {
             return;
         }
 
@@ -533,10 +555,18 @@ static void file_data_handler(uint32_t sector, const uint8_t *buf, uint32_t num_
             return;
         }
 
+        // Only take the sectors up to where the file's cluster chain
+        // leaves this write, the rest is checked again below
+        for (count = 1; count < num_of_sectors; count++) {
+            if (vfs_file_next_sector(sector + count - 1) != sector + count) {
+                break;
+            }
+        }
+
         // This sector could be part of the file so record it
-        size = VFS_SECTOR_SIZE * num_of_sectors;
+        size = VFS_SECTOR_SIZE * count;
         file_transfer_state.size_transferred += size;
-        file_transfer_state.file_next_sector = sector + num_of_sectors;
+        file_transfer_state.file_next_sector = vfs_file_next_sector(sector + count - 1);
 
         // If stream processing is done then discard the data
         if (file_transfer_state.stream_finished) {
@@ -547,6 +577,10 @@ static void file_data_handler(uint32_t sector, const uint8_t *buf, uint32_t num_
             return;
         }
         transfer_stream_data(sector, buf, size);
+
+        if ((count < num_of_sectors) && (TRASNFER_FINISHED != file_transfer_state.transfer_state)) {
+            file_data_handler(sector + count, buf + size, num_of_sectors - count);
+        }
     }
 }
 
@@ -669,6 +703,14 @@ static void transfer_update_file_info(vfs_file_t file, uint32_t start_sector, ui
     file_transfer_state.file_size = size;
     vfs_mngr_printf("    updated size=%i\r\n", size);
 
+    // Let the flash decoder pick an erase strategy from the expected image size
+    if (STREAM_TYPE_BIN == stream) {
+        flash_decoder_set_image_size(size, true);
+    } else if (STREAM_TYPE_HEX == stream) {
+        // A typical hex record carries 16 data bytes in 45 characters
+        flash_decoder_set_image_size(size / 45 * 16, false);
+    }
+
     transfer_update_state(ERROR_SUCCESS);
 }
 
@@ -763,6 +805,11 @@ static void transfer_stream_data(uint32_t sector, const uint8_t *data, uint32_t
 		
     vfs_mngr_printf("    stream_write ret=%i\r\n", status);
 
+    if (STREAM_TYPE_UF2 == file_transfer_state.stream) {
+        // Sectors written again or not holding a block do not count
+        file_transfer_state.size_transferred = stream_uf2_size();
+    }
+
     if (ERROR_SUCCESS_DONE == status) {
         // Override status so ERROR_SUCCESS_DONE
         // does not get passed into transfer_update_state
@@ -152,7 +152,7 @@ static uint32_t read_flash_dir(uint32_t sector_offset, uint8_t *data, uint32_t n
 	memset(buf, 0, VFS_SECTOR_SIZE);
 	memcpy(buf, vfs_create_file("FILE    TXT", 0, 0, 650000), VFS_SECTOR_SIZE);
 	
-	return 100;
+	return VFS_SECTOR_SIZE;
 }
 
 
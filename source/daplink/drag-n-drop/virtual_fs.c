@@ -36,7 +36,7 @@
 
 // Virtual file system driver
 // Limitations:
-//   - files must be contiguous
+//   - files must be contiguous unless the host writes the FAT before the data
 //   - data written cannot be read back
 //   - data should only be read once
 
@@ -51,7 +51,7 @@ extern uint8_t flash_start_writing_counter;
 const virtual_media_t virtual_media_tmpl[] = {
     /*  Read CB         Write CB        Region Size                 Region Name     */
     {   read_mbr,       write_none,     VFS_SECTOR_SIZE         },  /* MBR          */
-    {   read_fat,       write_none,     0 /* Set at runtime */  },  /* FAT1         */
+    {   read_fat,       write_fat1,     0 /* Set at runtime */  },  /* FAT1         */
     {   read_fat,       write_none,     0 /* Set at runtime */  },  /* FAT2         */
     {   read_dir,       write_dir,      VFS_SECTOR_SIZE * 2     },  /* Root Dir     */
     /* Raw filesystem contents follow */
@@ -100,9 +100,30 @@ uint32_t fat_idx;
 uint32_t dir_idx;
 uint32_t data_start;
 
+// Sector each virtual media entry ends at, ascending since the entries
+// follow each other.  Used to find the entry for a sector.
+static uint32_t virtual_media_end[ELEMENTS_IN_ARRAY(virtual_media)];
+
+// Number of non-consecutive cluster links kept from the host's FAT writes
+#ifndef VFS_FAT_LINKS_MAX
+#define VFS_FAT_LINKS_MAX       32
+#endif
+
+// A cluster followed by a cluster other than the next one
+typedef struct {
+    uint16_t cluster;
+    uint16_t next;
+} fat_link_t;
+
+static fat_link_t fat_links[VFS_FAT_LINKS_MAX];
+static uint32_t fat_link_count;
+
 // Virtual media must be larger than the template
 COMPILER_ASSERT(sizeof(virtual_media) > sizeof(virtual_media_tmpl));
 
+static uint32_t media_find(uint32_t sector);
+static bool add_media(vfs_read_cb_t read_cb, vfs_write_cb_t write_cb, uint32_t length);
+
 static void write_fat(file_allocation_table_t *fat, uint32_t idx, uint16_t val)
 {
     uint32_t low_idx;
@@ -130,8 +151,11 @@ void vfs_init(const vfs_filename_t drive_name, uint32_t disk_size)
     memset(&fat, 0, sizeof(fat));
     fat_idx = 0;
     memset(&virtual_media, 0, sizeof(virtual_media));
+    memset(&virtual_media_end, 0, sizeof(virtual_media_end));
     memset(&dir_current, 0, sizeof(dir_current));
     dir_idx = 0;
+    memset(&fat_links, 0, sizeof(fat_links));
+    fat_link_count = 0;
     file_count = 0;
     file_change_cb = file_change_cb_stub;
     virtual_media_idx = 0;
@@ -168,6 +192,7 @@ void vfs_init(const vfs_filename_t drive_name, uint32_t disk_size)
 
     for (i = 0; i < ELEMENTS_IN_ARRAY(virtual_media_tmpl); i++) {
         data_start += virtual_media[i].length;
+        virtual_media_end[i] = data_start / VFS_SECTOR_SIZE;
     }
 
     // Initialize FAT
@@ -244,24 +269,11 @@ vfs_file_t vfs_create_file(const vfs_filename_t filename, vfs_read_cb_t read_cb,
     de->first_cluster_low_16 = (first_cluster >> 0) & 0xFFFF;
 
     // Update virtual media
-    if (virtual_media_idx >= ELEMENTS_IN_ARRAY(virtual_media)) {
+    if (!add_media(read_cb, write_cb, clusters * mbr.bytes_per_sector * mbr.sectors_per_cluster)) {
         util_assert(0);
         return VFS_FILE_INVALID;
     }
 
-    virtual_media[virtual_media_idx].read_cb = read_zero;
-    virtual_media[virtual_media_idx].write_cb = write_none;
-
-    if (0 != read_cb) {
-        virtual_media[virtual_media_idx].read_cb = read_cb;
-    }
-
-    if (0 != write_cb) {
-        virtual_media[virtual_media_idx].write_cb = write_cb;
-    }
-
-    virtual_media[virtual_media_idx].length = clusters * mbr.bytes_per_sector * mbr.sectors_per_cluster;
-    virtual_media_idx++;
     file_count += 1;
     return de;
 }
@@ -318,24 +330,11 @@ vfs_file_t vfs_create_dir(const vfs_filename_t filename, vfs_read_cb_t read_cb,
     de->first_cluster_low_16 = (first_cluster >> 0) & 0xFFFF;
 
     // Update virtual media
-    if (virtual_media_idx >= ELEMENTS_IN_ARRAY(virtual_media)) {
+    if (!add_media(read_cb, write_cb, clusters * mbr.bytes_per_sector * mbr.sectors_per_cluster)) {
         util_assert(0);
         return VFS_FILE_INVALID;
     }
 
-    virtual_media[virtual_media_idx].read_cb = read_zero;
-    virtual_media[virtual_media_idx].write_cb = write_none;
-
-    if (0 != read_cb) {
-        virtual_media[virtual_media_idx].read_cb = read_cb;
-    }
-
-    if (0 != write_cb) {
-        virtual_media[virtual_media_idx].write_cb = write_cb;
-    }
-
-    virtual_media[virtual_media_idx].length = clusters * mbr.bytes_per_sector * mbr.sectors_per_cluster;
-    virtual_media_idx++;
     file_count += 1;
     return de;
 }
@@ -377,71 +376,122 @@ void vfs_set_file_change_callback(vfs_file_change_cb_t cb)
 
 void vfs_read(uint32_t requested_sector, uint8_t *buf, uint32_t num_sectors)
 {
-    uint8_t i = 0;
-    uint32_t current_sector;
-    // Zero out the buffer
-    memset(buf, 0, num_sectors * VFS_SECTOR_SIZE);
-    current_sector = 0;
-
-    for (i = 0; i < ELEMENTS_IN_ARRAY(virtual_media); i++) {
-        uint32_t vm_sectors = virtual_media[i].length / VFS_SECTOR_SIZE;
-        uint32_t vm_start = current_sector;
-        uint32_t vm_end = current_sector + vm_sectors;
-
-        // Data can be used in this sector
-        if ((requested_sector >= vm_start) && (requested_sector < vm_end)) {
-            uint32_t sector_offset;
-            uint32_t sectors_to_write = vm_end - requested_sector;
-            sectors_to_write = MIN(sectors_to_write, num_sectors);
-            sector_offset = requested_sector - current_sector;
-            virtual_media[i].read_cb(sector_offset, buf, sectors_to_write);
-            // Update requested sector
-            requested_sector += sectors_to_write;
-            num_sectors -= sectors_to_write;
-        }
+    uint32_t i;
+    uint32_t vm_start;
+    uint32_t sectors_to_write;
+    uint32_t size;
+    uint32_t read_size;
 
-        // If there is no more data to be read then break
-        if (num_sectors == 0) {
+    for (i = media_find(requested_sector); num_sectors > 0; i++) {
+        // Nothing past the last entry
+        if (i >= virtual_media_idx) {
+            memset(buf, 0, num_sectors * VFS_SECTOR_SIZE);
             break;
         }
 
-        // Move to the next virtual media entry
-        current_sector += vm_sectors;
+        vm_start = (0 == i) ? 0 : virtual_media_end[i - 1];
+        sectors_to_write = MIN(virtual_media_end[i] - requested_sector, num_sectors);
+
+        if (0 == sectors_to_write) {
+            // Empty entry
+            continue;
+        }
+
+        // Only zero what the callback did not fill in
+        size = sectors_to_write * VFS_SECTOR_SIZE;
+        read_size = virtual_media[i].read_cb(requested_sector - vm_start, buf, sectors_to_write);
+        read_size = MIN(read_size, size);
+        memset(buf + read_size, 0, size - read_size);
+        // Update requested sector
+        buf += size;
+        requested_sector += sectors_to_write;
+        num_sectors -= sectors_to_write;
     }
 }
 
 void vfs_write(uint32_t requested_sector, const uint8_t *buf, uint32_t num_sectors)
 {
+    uint32_t i;
+    uint32_t vm_start;
+    uint32_t sectors_to_read;
 
-    uint8_t i = 0;
-    uint32_t current_sector;
-    current_sector = 0;
-
-    for (i = 0; i < virtual_media_idx; i++) {
-        uint32_t vm_sectors = virtual_media[i].length / VFS_SECTOR_SIZE;
-        uint32_t vm_start = current_sector;
-        uint32_t vm_end = current_sector + vm_sectors;
-
-        // Data can be used in this sector
-        if ((requested_sector >= vm_start) && (requested_sector < vm_end)) {
-            uint32_t sector_offset;
-            uint32_t sectors_to_read = vm_end - requested_sector;
-            sectors_to_read = MIN(sectors_to_read, num_sectors);
-            sector_offset = requested_sector - current_sector;
-            virtual_media[i].write_cb(sector_offset, buf, sectors_to_read);
-            // Update requested sector
-            requested_sector += sectors_to_read;
-            num_sectors -= sectors_to_read;
+    for (i = media_find(requested_sector); (num_sectors > 0) && (i < virtual_media_idx); i++) {
+        vm_start = (0 == i) ? 0 : virtual_media_end[i - 1];
+        sectors_to_read = MIN(virtual_media_end[i] - requested_sector, num_sectors);
+
+        if (0 == sectors_to_read) {
+            // Empty entry
+            continue;
         }
 
-        // If there is no more data to be read then break
-        if (num_sectors == 0) {
-            break;
+        virtual_media[i].write_cb(requested_sector - vm_start, buf, sectors_to_read);
+        // Update requested sector
+        buf += sectors_to_read * VFS_SECTOR_SIZE;
+        requested_sector += sectors_to_read;
+        num_sectors -= sectors_to_read;
+    }
+}
+
+vfs_sector_t vfs_file_next_sector(vfs_sector_t sector)
+{
+    uint32_t sectors_before_data = data_start / mbr.bytes_per_sector;
+    uint32_t cluster;
+    uint32_t i;
+
+    // Only the last sector of a cluster can be followed by another cluster
+    if ((sector < sectors_before_data) ||
+            ((sector + 1 - sectors_before_data) % mbr.sectors_per_cluster != 0)) {
+        return sector + 1;
+    }
+
+    cluster = (sector - sectors_before_data) / mbr.sectors_per_cluster + 2;
+
+    for (i = 0; i < fat_link_count; i++) {
+        if (fat_links[i].cluster == cluster) {
+            return cluster_to_sector(fat_links[i].next);
         }
+    }
+
+    return sector + 1;
+}
+
+// Find the first virtual media entry that ends after sector, or
+// virtual_media_idx if there is none
+static uint32_t media_find(uint32_t sector)
+{
+    uint32_t low = 0;
+    uint32_t high = virtual_media_idx;
+    uint32_t mid;
+
+    while (low < high) {
+        mid = (low + high) / 2;
+
+        if (virtual_media_end[mid] > sector) {
+            high = mid;
+        } else {
+            low = mid + 1;
+        }
+    }
+
+    return low;
+}
+
+// Append an entry to the virtual media and the sector index
+static bool add_media(vfs_read_cb_t read_cb, vfs_write_cb_t write_cb, uint32_t length)
+{
+    uint32_t start;
 
-        // Move to the next virtual media entry
-        current_sector += vm_sectors;
+    if (virtual_media_idx >= ELEMENTS_IN_ARRAY(virtual_media)) {
+        return false;
     }
+
+    start = (0 == virtual_media_idx) ? 0 : virtual_media_end[virtual_media_idx - 1];
+    virtual_media[virtual_media_idx].read_cb = (0 != read_cb) ? read_cb : read_zero;
+    virtual_media[virtual_media_idx].write_cb = (0 != write_cb) ? write_cb : write_none;
+    virtual_media[virtual_media_idx].length = length;
+    virtual_media_end[virtual_media_idx] = start + length / VFS_SECTOR_SIZE;
+    virtual_media_idx++;
+    return true;
 }
 
 static uint32_t read_zero(uint32_t sector_offset, uint8_t *data, uint32_t num_sectors)
@@ -486,7 +536,50 @@ static uint32_t read_fat(uint32_t sector_offset, uint8_t *data, uint32_t num_sec
     return read_size;
 }
 
-/* No need to handle writes to the fat */
+// Keep the links of the host's FAT that do not go to the next cluster.
+// The second FAT is a copy so only the first is parsed.
+static void write_fat1(uint32_t sector_offset, const uint8_t *data, uint32_t num_sectors)
+{
+    uint32_t first;
+    uint32_t cluster;
+    uint32_t next;
+    uint32_t i;
+    uint32_t j;
+
+    for (i = 0; i < num_sectors; i++) {
+        first = (sector_offset + i) * (VFS_SECTOR_SIZE / 2);
+
+        // Drop the links this sector replaces
+        for (j = 0; j < fat_link_count;) {
+            if ((fat_links[j].cluster >= first) && (fat_links[j].cluster < first + VFS_SECTOR_SIZE / 2)) {
+                fat_links[j] = fat_links[--fat_link_count];
+            } else {
+                j++;
+            }
+        }
+
+        for (j = 0; j < VFS_SECTOR_SIZE / 2; j++) {
+            cluster = first + j;
+            next = data[j * 2] | (data[j * 2 + 1] << 8);
+
+            // Skip free, end of chain and consecutive clusters
+            if ((next < 2) || (next >= 0xFFF0) || (next == cluster + 1)) {
+                continue;
+            }
+
+            // Files with too many fragments fall back to being contiguous
+            if (fat_link_count >= ELEMENTS_IN_ARRAY(fat_links)) {
+                break;
+            }
+
+            fat_links[fat_link_count].cluster = cluster;
+            fat_links[fat_link_count].next = next;
+            fat_link_count++;
+        }
+
+        data += VFS_SECTOR_SIZE;
+    }
+}
 
 static uint32_t read_dir(uint32_t sector_offset, uint8_t *data, uint32_t num_sectors)
 {
@@ -496,8 +589,7 @@ static uint32_t read_dir(uint32_t sector_offset, uint8_t *data, uint32_t num_sec
         return 0;
     }
    
-    // Zero buffer data is VFS_SECTOR_SIZE max
-    memset(data, 0, VFS_SECTOR_SIZE);
+    memset(data, 0, num_sectors * VFS_SECTOR_SIZE);
 
     if (sector_offset == 0) { //Handle the first 512 bytes
         // Copy data that is actually created in the directory
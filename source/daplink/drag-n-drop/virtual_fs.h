@@ -116,6 +116,11 @@ void vfs_read(uint32_t sector, uint8_t *buf, uint32_t num_of_sectors);
 // Write one or more sectors to the virtual filesystem
 void vfs_write(uint32_t sector, const uint8_t *buf, uint32_t num_of_sectors);
 
+// Get the sector that follows this one in its file.  Clusters are taken
+// to follow each other unless the host has linked them otherwise in the
+// FAT, so this also works for files the host has fragmented.
+vfs_sector_t vfs_file_next_sector(vfs_sector_t sector);
+
 
 typedef struct {
     uint8_t boot_sector[11];
@@ -189,6 +194,7 @@ static void write_none(uint32_t offset, const uint8_t *data, uint32_t size);
 
 static uint32_t read_mbr(uint32_t offset, uint8_t *data, uint32_t size);
 static uint32_t read_fat(uint32_t offset, uint8_t *data, uint32_t size);
+static void write_fat1(uint32_t offset, const uint8_t *data, uint32_t size);
 static uint32_t read_dir(uint32_t offset, uint8_t *data, uint32_t size);
  void write_dir(uint32_t offset, const uint8_t *data, uint32_t size);
 static void file_change_cb_stub(const vfs_filename_t filename, vfs_file_change_t change,
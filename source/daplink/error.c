@@ -83,6 +83,14 @@ static const char *const error_message[] = {
     "The hex file you dropped isn't compatible with this mode or device. Are you in MAINTENANCE mode? See HELP FAQ.HTM",
     // ERROR_HEX_INVALID_APP_OFFSET
     "The hex file offset load address is not correct.",
+    // ERROR_ELF_PARSER
+    "The elf file cannot be decoded. Only 32 bit little endian ARM executables are supported.",
+    // ERROR_ELF_UNSUPPORTED
+    "The elf file cannot be programmed. Its loadable segments must follow the program headers and not overlap.",
+    // ERROR_UF2_INVALID
+    "The uf2 file cannot be programmed. A block is malformed or the file has too many blocks.",
+    // ERROR_LZ_INVALID
+    "The compressed image cannot be decoded. Its header is not valid or its window is too large.",
 
     /* Flash decoder errors */
 
@@ -177,6 +185,14 @@ static error_type_t error_type[] = {
     ERROR_TYPE_USER,
     // ERROR_HEX_INVALID_APP_OFFSET
     ERROR_TYPE_USER,
+    // ERROR_ELF_PARSER
+    ERROR_TYPE_USER | ERROR_TYPE_TRANSIENT,
+    // ERROR_ELF_UNSUPPORTED
+    ERROR_TYPE_USER,
+    // ERROR_UF2_INVALID
+    ERROR_TYPE_USER | ERROR_TYPE_TRANSIENT,
+    // ERROR_LZ_INVALID
+    ERROR_TYPE_USER,
 
     /* Flash decoder errors */
 
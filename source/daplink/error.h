@@ -58,6 +58,10 @@ typedef enum {
     ERROR_HEX_PROGRAM,
     ERROR_HEX_INVALID_ADDRESS,
     ERROR_HEX_INVALID_APP_OFFSET,
+    ERROR_ELF_PARSER,
+    ERROR_ELF_UNSUPPORTED,
+    ERROR_UF2_INVALID,
+    ERROR_LZ_INVALID,
 
     /* Flash decoder error */
     ERROR_FD_BL_UPDT_ADDR_WRONG,
@@ -42,6 +42,7 @@
 #include "cortex_m.h"
 #include "sdk.h"
 #include "flash_intf.h"
+#include "rtt.h"
 
 #include "serial_flash.h"
 
@@ -55,8 +56,12 @@
 #define FLAGS_MAIN_POWERDOWN    (1 << 4)
 #define FLAGS_MAIN_DISABLEDEBUG (1 << 5)
 #define FLAGS_MAIN_PROC_USB     (1 << 9)
+// Used by the DAP task when responses are ready
+#define FLAGS_MAIN_HID_SEND     (1 << 10)
 // Used by cdc when an event occurs
 #define FLAGS_MAIN_CDC_EVENT    (1 << 11)
+// Used by the SWO capture when trace data is ready to stream
+#define FLAGS_MAIN_SWO_EVENT    (1 << 12)
 // Used by msd when flashing a new binary
 #define FLAGS_LED_BLINK_30MS    (1 << 6)
 
@@ -105,6 +110,7 @@ static bool usb_test_mode = false;
 
 static U64 stk_timer_30_task[TIMER_TASK_30_STACK / sizeof(U64)];
 static U64 stk_main_task[MAIN_TASK_STACK / sizeof(U64)];
+static U64 stk_dap_task[DAP_TASK_STACK / sizeof(U64)];
 
 extern void flash_prog(uint8_t prog_num);
 
@@ -170,6 +176,13 @@ void main_disable_debug_event(void)
     return;
 }
 
+// Send DAP responses completed by the DAP task
+void main_hid_send_event(void)
+{
+    os_evt_set(FLAGS_MAIN_HID_SEND, main_task_id);
+    return;
+}
+
 // Start CDC processing
 void main_cdc_send_event(void)
 {
@@ -177,6 +190,13 @@ void main_cdc_send_event(void)
     return;
 }
 
+// Process captured SWO data, callable from interrupts
+void main_swo_event(void)
+{
+    isr_evt_set(FLAGS_MAIN_SWO_EVENT, main_task_id);
+    return;
+}
+
 void main_usb_set_test_mode(bool enabled)
 {
     usb_test_mode = enabled;
@@ -188,6 +208,8 @@ void USBD_SignalHandler()
 }
 
 extern void cdc_process_event(void);
+extern void hid_send_responses(void);
+extern __task void hid_process(void);
 __attribute__((weak)) void prerun_board_config(void) {}
 __attribute__((weak)) void prerun_target_config(void) {}
 
@@ -219,15 +241,19 @@ __task void main_task(void)
     gpio_set_cdc_led(cdc_led_value);
     gpio_set_msc_led(msc_led_value);
     // Initialize the DAP
+    swd_lock_init();
     DAP_Setup();
     // do some init with the target before USB and files are configured
     prerun_board_config();
     prerun_target_config();
     // Update versions and IDs
     info_init();
+    // RTT bridge, polled by the DAP task once a terminal opens the CDC port
+    rtt_init();
     // USB
     usbd_init();
     vfs_mngr_fs_enable(true);
+    os_tsk_create_user(hid_process, DAP_TASK_PRIORITY, (void *)stk_dap_task, DAP_TASK_STACK);
     usbd_connect(0);
     usb_state = USB_CONNECTING;
     usb_state_count = USB_CONNECT_DELAY;
@@ -245,6 +271,8 @@ __task void main_task(void)
                        | FLAGS_MAIN_DISABLEDEBUG    // Disable target debug
                        | FLAGS_MAIN_PROC_USB        // process usb events
                        | FLAGS_MAIN_CDC_EVENT       // cdc event
+                       | FLAGS_MAIN_HID_SEND        // dap responses ready
+                       | FLAGS_MAIN_SWO_EVENT       // swo trace ready
                        , NO_TIMEOUT);
         // Find out what event happened
         flags = os_evt_get();
@@ -259,12 +287,16 @@ __task void main_task(void)
         }
 
         if (flags & FLAGS_MAIN_RESET) {
+            swd_lock();
             target_set_state(RESET_RUN);
+            swd_unlock();
         }
 
         if (flags & FLAGS_MAIN_POWERDOWN) {
             // Disable debug
+            swd_lock();
             target_set_state(NO_DEBUG);
+            swd_unlock();
             // Disable board power before USB is disconnected.
             gpio_set_board_power(false);
             // Disconnect USB
@@ -280,16 +312,38 @@ __task void main_task(void)
 
         if (flags & FLAGS_MAIN_DISABLEDEBUG) {
             // Disable debug
+            swd_lock();
             target_set_state(NO_DEBUG);
+            swd_unlock();
+        }
+
+        if (flags & FLAGS_MAIN_HID_SEND) {
+            hid_send_responses();
         }
 
         if (flags & FLAGS_MAIN_CDC_EVENT) {
             cdc_process_event();
         }
 
+        if (flags & FLAGS_MAIN_SWO_EVENT) {
+            SWO_Process(0);
+        }
+
+        // Flush SWO trace that is not complete yet
+        if (flags & FLAGS_MAIN_30MS) {
+            SWO_Process(1);
+        }
+
         if (flags & FLAGS_MAIN_90MS) {
             // Update USB busy status
             vfs_mngr_periodic(90); // FLAGS_MAIN_90MS
+
+            // Saving the tuned SWD clock erases interface flash with
+            // interrupts off, so wait until the target is not being
+            // programmed
+            if (!flash_intf_target->flash_busy()) {
+                swd_clock_save();
+            }
 					
 
             // Update USB connect status
@@ -358,11 +412,15 @@ __task void main_task(void)
             // handle reset button without eventing
             if (!reset_pressed && gpio_get_reset_btn_fwrd() && !flash_intf_target->flash_busy()) { //added checking if flashing on target is in progress
                 // Reset button pressed
+                swd_lock();
                 target_set_state(RESET_HOLD);
+                swd_unlock();
                 reset_pressed = 1;
             } else if (reset_pressed && !gpio_get_reset_btn_fwrd()) {
                 // Reset button released
+                swd_lock();
                 target_set_state(RESET_RUN);
+                swd_unlock();
                 reset_pressed = 0;
             }
 
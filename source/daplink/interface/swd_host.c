@@ -20,6 +20,8 @@
  */
 
 #ifndef TARGET_MCU_CORTEX_A
+#include "string.h"
+
 #include "RTL.h"
 #include "target_reset.h"
 #include "target_config.h"
@@ -27,6 +29,7 @@
 #include "debug_cm.h"
 #include "DAP_config.h"
 #include "DAP.h"
+#include "settings.h"
 
 // Default NVIC and Core debug base addresses
 // TODO: Read these addresses from ROM.
@@ -64,6 +67,15 @@
 
 #endif
 
+// Tune the SWD clock for each target before flash programming. Boards with
+// targets whose RAM must not be touched, even when halted, can disable this.
+#if !defined(SWD_CLOCK_TUNE)
+#define SWD_CLOCK_TUNE      1
+#endif
+
+#define CLOCK_TUNE_IDCODE_READS     8
+#define CLOCK_TUNE_RAM_WORDS        8
+
 typedef struct {
     uint32_t select;
     uint32_t csw;
@@ -75,6 +87,15 @@ typedef struct {
 } DEBUG_STATE;
 
 static DAP_STATE dap_state;
+static OS_MUT swd_mutex;
+
+#if SWD_CLOCK_TUNE
+// Clock last used, so reconnecting to the same target skips the lookup
+static uint32_t tuned_idcode;
+static uint32_t tuned_clock;
+// Set when tuned_clock has not been written to the settings yet
+static uint8_t tuned_unsaved;
+#endif
 
 void int2array(uint8_t *res, uint32_t data, uint8_t len)
 {
@@ -102,6 +123,21 @@ uint8_t swd_transfer_retry(uint32_t req, uint32_t *data)
 }
 
 
+void swd_lock_init(void)
+{
+    os_mut_init(&swd_mutex);
+}
+
+void swd_lock(void)
+{
+    os_mut_wait(&swd_mutex, 0xFFFF);
+}
+
+void swd_unlock(void)
+{
+    os_mut_release(&swd_mutex);
+}
+
 uint8_t swd_init(void)
 {
     //TODO - DAP_Setup puts GPIO pins in a hi-z state which can
@@ -679,10 +715,10 @@ static uint8_t swd_wait_until_halted(void)
     return 0;
 }
 
-uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
+uint8_t swd_flash_syscall_start(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
 {
     DEBUG_STATE state = {{0}, 0};
-    // Call flash algorithm function on target and wait for result.
+    // Call flash algorithm function on target without waiting for the result.
     state.r[0]     = arg1;                   // R0: Argument 1
     state.r[1]     = arg2;                   // R1: Argument 2
     state.r[2]     = arg3;                   // R2: Argument 3
@@ -697,22 +733,39 @@ uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t e
         return 0;
     }
 
+    return 1;
+}
+
+uint8_t swd_flash_syscall_wait(void)
+{
+    uint32_t r0;
+
     if (!swd_wait_until_halted()) {
         return 0;
     }
 
-    if (!swd_read_core_register(0, &state.r[0])) {
+    if (!swd_read_core_register(0, &r0)) {
         return 0;
     }
 
     // Flash functions return 0 if successful.
-    if (state.r[0] != 0) {
+    if (r0 != 0) {
         return 0;
     }
 
     return 1;
 }
 
+uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
+{
+    // Call flash algorithm function on target and wait for result.
+    if (!swd_flash_syscall_start(sysCallParam, entry, arg1, arg2, arg3, arg4)) {
+        return 0;
+    }
+
+    return swd_flash_syscall_wait();
+}
+
 // SWD Reset
 static uint8_t swd_reset(void)
 {
@@ -777,11 +830,328 @@ static uint8_t JTAG2SWD()
     return 1;
 }
 
-uint8_t swd_init_debug(void)
+#if SWD_CLOCK_TUNE
+// Set the SWD clock in Hz the same way as the DAP_SWJ_Clock command
+static void swd_set_clock(uint32_t clock)
+{
+    uint32_t delay;
+
+    if (clock >= (CPU_CLOCK / 2U / (IO_PORT_WRITE_CYCLES + DELAY_FAST_CYCLES))) {
+        DAP_Data.fast_clock  = 1U;
+        DAP_Data.clock_delay = 1U;
+    } else {
+        DAP_Data.fast_clock  = 0U;
+
+        delay = ((CPU_CLOCK / 2U) + (clock - 1U)) / clock;
+        if (delay > IO_PORT_WRITE_CYCLES) {
+            delay -= IO_PORT_WRITE_CYCLES;
+            delay  = (delay + (DELAY_SLOW_CYCLES - 1U)) / DELAY_SLOW_CYCLES;
+        } else {
+            delay  = 1U;
+        }
+
+        DAP_Data.clock_delay = delay;
+    }
+}
+
+// SWD clock in Hz for a clock delay. Rounded up so that swd_set_clock
+// selects the same delay again.
+static uint32_t swd_clock_hz(uint8_t fast_clock, uint32_t clock_delay)
+{
+    uint32_t cycles;
+
+    if (fast_clock) {
+        cycles = IO_PORT_WRITE_CYCLES + DELAY_FAST_CYCLES;
+    } else {
+        cycles = IO_PORT_WRITE_CYCLES + clock_delay * DELAY_SLOW_CYCLES;
+    }
+
+    return ((CPU_CLOCK / 2U) + (cycles - 1U)) / cycles;
+}
+
+// Resynchronise with the target after a clock change may have left the
+// wire or the sticky error flags in a bad state
+static uint8_t swd_clock_reconnect(void)
+{
+    dap_state.select = 0xffffffff;
+    dap_state.csw = 0xffffffff;
+
+    if (!JTAG2SWD()) {
+        return 0;
+    }
+
+    if (!swd_clear_errors()) {
+        return 0;
+    }
+
+    return swd_write_dp(DP_SELECT, 0);
+}
+
+// Check the current clock by reading IDCODE repeatedly, and if a RAM
+// buffer is given by writing and reading back patterns there
+static uint8_t swd_clock_check(uint32_t idcode, uint32_t *ram)
+{
+    uint32_t pattern[CLOCK_TUNE_RAM_WORDS];
+    uint32_t val;
+    uint32_t i;
+    uint32_t pass;
+
+    for (i = 0; i < CLOCK_TUNE_IDCODE_READS; i++) {
+        if (!swd_read_dp(DP_IDCODE, &val) || (val != idcode)) {
+            return 0;
+        }
+    }
+
+    if (ram == NULL) {
+        return 1;
+    }
+
+    // Alternating bits, then their inverse, so every data bit toggles
+    // between neighbouring words and between passes
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < CLOCK_TUNE_RAM_WORDS; i++) {
+            pattern[i] = ((i + pass) & 1) ? 0xAAAAAAAA : 0x55555555;
+            pattern[i] ^= idcode << (i & 7);
+        }
+
+        if (!swd_write_memory(target_device.ram_start, (uint8_t *)pattern, sizeof(pattern))) {
+            return 0;
+        }
+
+        if (!swd_read_memory(target_device.ram_start, (uint8_t *)ram, sizeof(pattern))) {
+            return 0;
+        }
+
+        if (memcmp(pattern, ram, sizeof(pattern)) != 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// Find the fastest clock the target works reliably at. Starting from the
+// connect clock, the clock delay is reduced one step at a time and then
+// the fast clock is tried. The clock is set one step slower than the last
+// one that passed, whether the next step failed or the fast clock passed,
+// so there is always a working step of margin. Returns 0 if tuning failed, in
+// which case the connect clock is selected again. Target RAM is restored
+// either way.
+static uint32_t swd_clock_tune(uint32_t idcode)
+{
+    uint32_t saved[CLOCK_TUNE_RAM_WORDS];
+    uint32_t scratch[CLOCK_TUNE_RAM_WORDS];
+    uint32_t *ram = scratch;
+    uint8_t connect_fast;
+    uint32_t connect_delay;
+    uint32_t clock;
+    uint32_t margin;
+    uint32_t delay;
+
+    // The core is halted and the start of RAM is where the flash algorithm
+    // is loaded, but restore it anyway in case programming is cancelled
+    if ((target_device.ram_end - target_device.ram_start < sizeof(saved)) ||
+            !swd_read_memory(target_device.ram_start, (uint8_t *)saved, sizeof(saved))) {
+        ram = NULL;
+    }
+
+    connect_fast = DAP_Data.fast_clock;
+    connect_delay = DAP_Data.clock_delay;
+    delay = connect_delay;
+    clock = swd_clock_hz(connect_fast, delay);
+    margin = clock;
+
+    while (1) {
+        if (delay > 1) {
+            delay--;
+            DAP_Data.clock_delay = delay;
+        } else if (!DAP_Data.fast_clock) {
+            DAP_Data.fast_clock = 1U;
+        } else {
+            // Fast clock works, keep the same margin below it
+            break;
+        }
+
+        if (!swd_clock_check(idcode, ram)) {
+            break;
+        }
+
+        margin = clock;
+        clock = swd_clock_hz(DAP_Data.fast_clock, delay);
+    }
+
+    swd_set_clock(margin);
+    if (!swd_clock_reconnect() || !swd_clock_check(idcode, NULL)) {
+        // Tuning went wrong, go back to the clock that connected so that
+        // RAM can still be restored
+        DAP_Data.fast_clock = connect_fast;
+        DAP_Data.clock_delay = connect_delay;
+        swd_clock_reconnect();
+        margin = 0;
+    }
+
+    if ((ram != NULL) && !swd_write_memory(target_device.ram_start, (uint8_t *)saved, sizeof(saved))) {
+        return 0;
+    }
+
+    return margin;
+}
+
+// Select the SWD clock for the connected target. A clock tuned earlier
+// for the same target is used when it still works, otherwise the connect
+// clock is kept. This does not touch target RAM.
+static void swd_clock_select(void)
+{
+    uint32_t connect_clock;
+    uint32_t idcode;
+    uint8_t connect_fast;
+    uint32_t connect_delay;
+    uint32_t clock;
+
+    if (!swd_read_dp(DP_IDCODE, &idcode)) {
+        return;
+    }
+
+    connect_fast = DAP_Data.fast_clock;
+    connect_delay = DAP_Data.clock_delay;
+    connect_clock = swd_clock_hz(connect_fast, connect_delay);
+
+    clock = (tuned_idcode == idcode) ? tuned_clock : config_get_swd_clock(idcode);
+    if (clock > connect_clock) {
+        swd_set_clock(clock);
+        if (swd_clock_check(idcode, NULL)) {
+            tuned_idcode = idcode;
+            tuned_clock = clock;
+            return;
+        }
+
+        // Cable or target changed since the clock was tuned
+        tuned_idcode = 0;
+        DAP_Data.fast_clock = connect_fast;
+        DAP_Data.clock_delay = connect_delay;
+        if (!swd_clock_reconnect()) {
+            return;
+        }
+    } else if (clock != 0) {
+        // Tuned to the connect clock already
+        tuned_idcode = idcode;
+        tuned_clock = clock;
+    }
+}
+#endif
+
+void swd_clock_tune_halted(void)
+{
+#if SWD_CLOCK_TUNE
+    uint32_t idcode;
+    uint32_t clock;
+
+    if (!swd_read_dp(DP_IDCODE, &idcode)) {
+        return;
+    }
+
+    // swd_clock_select already found a working tuned clock
+    if (tuned_idcode == idcode) {
+        return;
+    }
+
+    clock = swd_clock_tune(idcode);
+    if (clock == 0) {
+        return;
+    }
+
+    tuned_idcode = idcode;
+    tuned_clock = clock;
+    tuned_unsaved = 1;
+#endif
+}
+
+void swd_clock_save(void)
+{
+#if SWD_CLOCK_TUNE
+    uint32_t idcode;
+    uint32_t clock;
+
+    // Don't wait for a DAP command or a transfer to finish, try again
+    // on the next call instead
+    if (os_mut_wait(&swd_mutex, 0) != OS_R_OK) {
+        return;
+    }
+
+    idcode = tuned_idcode;
+    clock = tuned_clock;
+    if (!tuned_unsaved) {
+        os_mut_release(&swd_mutex);
+        return;
+    }
+    tuned_unsaved = 0;
+    os_mut_release(&swd_mutex);
+
+    config_set_swd_clock(idcode, clock);
+#endif
+}
+
+// Power up the debug and system domains
+static uint8_t swd_power_up(void)
 {
     uint32_t tmp = 0;
     int i = 0;
     int timeout = 100;
+
+    if (!swd_write_dp(DP_CTRL_STAT, CSYSPWRUPREQ | CDBGPWRUPREQ)) {
+        return 0;
+    }
+
+    for (i = 0; i < timeout; i++) {
+        if (!swd_read_dp(DP_CTRL_STAT, &tmp)) {
+            return 0;
+        }
+        if ((tmp & (CDBGPWRUPACK | CSYSPWRUPACK)) == (CDBGPWRUPACK | CSYSPWRUPACK)) {
+            // Break from loop if powerup is complete
+            break;
+        }
+    }
+    if (i == timeout) {
+        // Unable to powerup DP
+        return 0;
+    }
+
+    return swd_write_dp(DP_CTRL_STAT, CSYSPWRUPREQ | CDBGPWRUPREQ | TRNNORMAL | MASKLANE);
+}
+
+// Connect to a running target without resetting, halting or unlocking
+// it, for background access to target memory
+uint8_t swd_attach(void)
+{
+    dap_state.select = 0xffffffff;
+    dap_state.csw = 0xffffffff;
+    swd_init();
+
+    if (!JTAG2SWD()) {
+        return 0;
+    }
+
+    if (!swd_clear_errors()) {
+        return 0;
+    }
+
+    if (!swd_write_dp(DP_SELECT, 0)) {
+        return 0;
+    }
+
+    if (!swd_power_up()) {
+        return 0;
+    }
+
+#if SWD_CLOCK_TUNE
+    swd_clock_select();
+#endif
+
+    return 1;
+}
+
+uint8_t swd_init_debug(void)
+{
     // init dap state with fake values
     dap_state.select = 0xffffffff;
     dap_state.csw = 0xffffffff;
@@ -820,29 +1190,7 @@ uint8_t swd_init_debug(void)
             
         }
         
-        // Power up
-        if (!swd_write_dp(DP_CTRL_STAT, CSYSPWRUPREQ | CDBGPWRUPREQ)) {
-            do_abort = 1;
-            continue;
-        }
-
-        for (i = 0; i < timeout; i++) {
-            if (!swd_read_dp(DP_CTRL_STAT, &tmp)) {
-                do_abort = 1;
-                break;
-            }
-            if ((tmp & (CDBGPWRUPACK | CSYSPWRUPACK)) == (CDBGPWRUPACK | CSYSPWRUPACK)) {
-                // Break from loop if powerup is complete
-                break;
-            }
-        }
-        if ((i == timeout) || (do_abort == 1)) {
-            // Unable to powerup DP
-            do_abort = 1;
-            continue;
-        }
-
-        if (!swd_write_dp(DP_CTRL_STAT, CSYSPWRUPREQ | CDBGPWRUPREQ | TRNNORMAL | MASKLANE)) {
+        if (!swd_power_up()) {
             do_abort = 1;
             continue;
         }
@@ -856,6 +1204,10 @@ uint8_t swd_init_debug(void)
             do_abort = 1;
             continue;
         }
+
+#if SWD_CLOCK_TUNE
+        swd_clock_select();
+#endif
         
         return 1;
     
@@ -34,9 +34,20 @@
 extern "C" {
 #endif
 
+// Serialize target access between the USB thread and the DAP task.
+// Calls may be nested by the task that holds the lock.
+void swd_lock_init(void);
+void swd_lock(void);
+void swd_unlock(void);
 uint8_t swd_init(void);
 uint8_t swd_off(void);
 uint8_t swd_init_debug(void);
+uint8_t swd_attach(void);
+// Tune the SWD clock for the connected target. This writes test patterns
+// to target RAM, so the core must be halted. The result is kept in RAM
+// until swd_clock_save writes it to the settings.
+void swd_clock_tune_halted(void);
+void swd_clock_save(void);
 uint8_t swd_clear_errors(void);
 uint8_t swd_read_dp(uint8_t adr, uint32_t *val);
 uint8_t swd_write_dp(uint8_t adr, uint32_t val);
@@ -50,6 +61,8 @@ uint8_t swd_read_memory(uint32_t address, uint8_t *data, uint32_t size);
 uint8_t swd_write_memory(uint32_t address, uint8_t *data, uint32_t size);
 uint8_t swd_read_core_register(uint32_t n, uint32_t *val);
 uint8_t swd_write_core_register(uint32_t n, uint32_t val);
+uint8_t swd_flash_syscall_start(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4);
+uint8_t swd_flash_syscall_wait(void);
 uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4);
 void swd_set_target_reset(uint8_t asserted);
 uint8_t swd_set_target_state_hw(TARGET_RESET_STATE state);
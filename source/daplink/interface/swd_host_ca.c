@@ -71,6 +71,7 @@ typedef struct {
 } DEBUG_STATE;
 
 static DAP_STATE dap_state;
+static OS_MUT swd_mutex;
 static uint32_t select_state = SELECT_MEM;
 static volatile uint32_t swd_init_debug_flag = 0;
 
@@ -106,6 +107,30 @@ static uint8_t swd_transfer_retry(uint32_t req, uint32_t *data)
 }
 
 
+void swd_lock_init(void)
+{
+    os_mut_init(&swd_mutex);
+}
+
+void swd_lock(void)
+{
+    os_mut_wait(&swd_mutex, 0xFFFF);
+}
+
+void swd_unlock(void)
+{
+    os_mut_release(&swd_mutex);
+}
+
+// Cortex-A targets always run at the connect clock
+void swd_clock_tune_halted(void)
+{
+}
+
+void swd_clock_save(void)
+{
+}
+
 uint8_t swd_init(void)
 {
     //TODO - DAP_Setup puts GPIO pins in a hi-z state which can
@@ -612,10 +637,10 @@ static uint8_t swd_wait_until_halted(void)
     return 0;
 }
 
-uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
+uint8_t swd_flash_syscall_start(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
 {
     DEBUG_STATE state = {{0}, 0};
-    // Call flash algorithm function on target and wait for result.
+    // Call flash algorithm function on target without waiting for the result.
     state.r[0]     = arg1;                   // R0: Argument 1
     state.r[1]     = arg2;                   // R1: Argument 2
     state.r[2]     = arg3;                   // R2: Argument 3
@@ -630,6 +655,13 @@ uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t e
         return 0;
     }
 
+    return 1;
+}
+
+uint8_t swd_flash_syscall_wait(void)
+{
+    uint32_t r0;
+
     if (!swd_wait_until_halted()) {
         return 0;
     }
@@ -638,18 +670,28 @@ uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t e
         return 0;
     }
 
-    if (!swd_read_core_register(0, &state.r[0])) {
+    if (!swd_read_core_register(0, &r0)) {
         return 0;
     }
 
     // Flash functions return 0 if successful.
-    if (state.r[0] != 0) {
+    if (r0 != 0) {
         return 0;
     }
 
     return 1;
 }
 
+uint8_t swd_flash_syscall_exec(const program_syscall_t *sysCallParam, uint32_t entry, uint32_t arg1, uint32_t arg2, uint32_t arg3, uint32_t arg4)
+{
+    // Call flash algorithm function on target and wait for result.
+    if (!swd_flash_syscall_start(sysCallParam, entry, arg1, arg2, arg3, arg4)) {
+        return 0;
+    }
+
+    return swd_flash_syscall_wait();
+}
+
 // SWD Reset
 static uint8_t swd_reset(void)
 {
@@ -46,6 +46,9 @@ static error_t target_flash_erase_chip(void);
 static uint32_t target_flash_program_page_min_size(uint32_t addr);
 static uint32_t target_flash_erase_sector_size(uint32_t addr);
 static uint8_t target_flash_busy(void);
+static error_t target_flash_erase_sector_start(uint32_t addr);
+static error_t target_flash_erase_wait(void);
+static uint8_t target_flash_erased_value(void);
 
 static const flash_intf_t flash_intf = {
     target_flash_init,
@@ -56,34 +59,73 @@ static const flash_intf_t flash_intf = {
     target_flash_program_page_min_size,
     target_flash_erase_sector_size,
     target_flash_busy,
+    target_flash_erase_sector_start,
 };
 
 static state_t state = STATE_CLOSED;
+static bool erase_pending = false;
+static bool target_locked = false;
 
 const flash_intf_t *const flash_intf_target = &flash_intf;
 
+static void target_flash_lock(void)
+{
+    if (!target_locked) {
+        swd_lock();
+        target_locked = true;
+    }
+}
+
+static void target_flash_unlock(void)
+{
+    if (target_locked) {
+        target_locked = false;
+        swd_unlock();
+    }
+}
+
 static error_t target_flash_init()
 {
     const program_target_t *const flash = target_device.flash_algo;
 
+    // The flash algorithm owns the target until uninit, so keep the
+    // DAP task from running commands in between programming calls
+    target_flash_lock();
+
+    // Report busy while the target is being prepared as well, so that
+    // background SWD users keep off the wire
+    state = STATE_OPEN;
+
     if (0 == target_set_state(RESET_PROGRAM)) {
+        state = STATE_CLOSED;
+        target_flash_unlock();
         return ERROR_RESET;
     }
 
+    // The core is halted now, so test patterns can go to target RAM
+    swd_clock_tune_halted();
+
     // Download flash programming algorithm to target and initialise.
     if (0 == swd_write_memory(flash->algo_start, (uint8_t *)flash->algo_blob, flash->algo_size)) {
+        state = STATE_CLOSED;
+        target_flash_unlock();
         return ERROR_ALGO_DL;
     }
 
     if (0 == swd_flash_syscall_exec(&flash->sys_call_s, flash->init, target_device.flash_start, 0, 0, 0)) {
+        state = STATE_CLOSED;
+        target_flash_unlock();
         return ERROR_INIT;
     }
-    state = STATE_OPEN;
+    erase_pending = false;
     return ERROR_SUCCESS;
 }
 
 static error_t target_flash_uninit(void)
 {
+    // Let a background erase finish before the target is reset
+    target_flash_erase_wait();
+
     if (config_get_auto_rst()) {
         // Resume the target if configured to do so
         target_set_state(RESET_RUN);
@@ -96,12 +138,19 @@ static error_t target_flash_uninit(void)
     target_set_state(RESET_RUN); //POST_FLASH_RESET
     state = STATE_CLOSED;
     swd_off();
+    target_flash_unlock();
     return ERROR_SUCCESS;
 }
 
 static error_t target_flash_program_page(uint32_t addr, const uint8_t *buf, uint32_t size)
 {
     const program_target_t *const flash = target_device.flash_algo;
+    error_t status;
+
+    status = target_flash_erase_wait();
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
 
     // check if security bits were set
     if (1 == security_bits_set(addr, (uint8_t *)buf, size)) {
@@ -111,6 +160,15 @@ static error_t target_flash_program_page(uint32_t addr, const uint8_t *buf, uint
     while (size > 0) {
         uint32_t write_size = MIN(size, flash->program_buffer_size);
 
+        // Erased flash already holds this data so skip the download
+        // and the programming syscall entirely
+        if (util_is_filled(buf, write_size, target_flash_erased_value())) {
+            addr += write_size;
+            buf += write_size;
+            size -= write_size;
+            continue;
+        }
+
         // Write page to buffer
         if (!swd_write_memory(flash->program_buffer, (uint8_t *)buf, write_size)) {
             return ERROR_ALGO_DATA_SEQ;
@@ -167,6 +225,12 @@ static error_t target_flash_program_page(uint32_t addr, const uint8_t *buf, uint
 static error_t target_flash_erase_sector(uint32_t addr)
 {
     const program_target_t *const flash = target_device.flash_algo;
+    error_t status;
+
+    status = target_flash_erase_wait();
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
 
     // Check to make sure the address is on a sector boundary
     if ((addr % target_flash_erase_sector_size(addr)) != 0) {
@@ -185,6 +249,11 @@ static error_t target_flash_erase_chip(void)
     error_t status = ERROR_SUCCESS;
     const program_target_t *const flash = target_device.flash_algo;
 
+    status = target_flash_erase_wait();
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
+
     if (0 == swd_flash_syscall_exec(&flash->sys_call_s, flash->erase_chip, 0, 0, 0, 0)) {
         return ERROR_ERASE_ALL;
     }
@@ -197,6 +266,44 @@ static error_t target_flash_erase_chip(void)
     return status;
 }
 
+static error_t target_flash_erase_sector_start(uint32_t addr)
+{
+    const program_target_t *const flash = target_device.flash_algo;
+    error_t status;
+
+    status = target_flash_erase_wait();
+    if (ERROR_SUCCESS != status) {
+        return status;
+    }
+
+    // Check to make sure the address is on a sector boundary
+    if ((addr % target_flash_erase_sector_size(addr)) != 0) {
+        return ERROR_ERASE_SECTOR;
+    }
+
+    // The erase runs on the target while the interface keeps receiving data
+    if (0 == swd_flash_syscall_start(&flash->sys_call_s, flash->erase_sector, addr, 0, 0, 0)) {
+        return ERROR_ERASE_SECTOR;
+    }
+
+    erase_pending = true;
+    return ERROR_SUCCESS;
+}
+
+static error_t target_flash_erase_wait(void)
+{
+    if (!erase_pending) {
+        return ERROR_SUCCESS;
+    }
+
+    erase_pending = false;
+    if (0 == swd_flash_syscall_wait()) {
+        return ERROR_ERASE_SECTOR;
+    }
+
+    return ERROR_SUCCESS;
+}
+
 static uint32_t target_flash_program_page_min_size(uint32_t addr)
 {
     uint32_t size = 256;
@@ -222,3 +329,11 @@ static uint32_t target_flash_erase_sector_size(uint32_t addr)
 static uint8_t target_flash_busy(void){
     return (state == STATE_OPEN);
 }
+
+static uint8_t target_flash_erased_value(void)
+{
+    if (target_device.erased_value & 0x100) {
+        return target_device.erased_value & 0xFF;
+    }
+    return TARGET_FLASH_ERASED_DEFAULT;
+}
@@ -41,7 +41,8 @@ extern "C" {
 //  have to use the largest stack or these have to be defined in multiple places... Not ideal
 //  may want to move away from threads for some of these behaviours to optimize mempory usage (RAM)
 #define TIMER_TASK_30_STACK (136)
-#define DAP_TASK_STACK      (272)
+// The DAP task also runs RTT polling and the sampler, deepest is DAP_SampleStart
+#define DAP_TASK_STACK      (576)
 #define MAIN_TASK_STACK     (800)
 
 #ifdef __cplusplus
@@ -40,9 +40,11 @@ void config_init(void);
 void config_set_auto_rst(bool on);
 void config_set_automation_allowed(bool on);
 void config_set_overflow_detect(bool on);
+void config_set_swd_clock(uint32_t idcode, uint32_t clock);
 bool config_get_auto_rst(void);
 bool config_get_automation_allowed(void);
 bool config_get_overflow_detect(void);
+uint32_t config_get_swd_clock(uint32_t idcode);
 
 // Get/set settings residing in shared ram
 void config_ram_set_hold_in_bl(bool hold);
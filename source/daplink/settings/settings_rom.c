@@ -29,7 +29,14 @@
 
 // 'kvld' in hex - key valid
 #define CFG_KEY             0x6b766c64
-#define SECTOR_BUFFER_SIZE  16
+#define SECTOR_BUFFER_SIZE  48
+// Number of targets a tuned SWD clock is kept for
+#define CFG_SWD_CLOCK_COUNT 4
+
+typedef struct __attribute__((__packed__)) cfg_swd_clock {
+    uint32_t idcode;            // IDCODE of the target the clock was tuned for
+    uint32_t clock;             // Tuned SWD clock in Hz, 0 if not tuned
+} cfg_swd_clock_t;
 
 // WARNING - THIS STRUCTURE RESIDES IN NON-VOLATILE STORAGE!
 // Be careful with changes:
@@ -44,13 +51,14 @@ typedef struct __attribute__((__packed__)) cfg_setting {
     uint8_t auto_rst;
     uint8_t automation_allowed;
     uint8_t overflow_detect;
+    cfg_swd_clock_t swd_clock[CFG_SWD_CLOCK_COUNT]; // Most recently tuned first
 
     // Add new members here
 
 } cfg_setting_t;
 
 // Make sure FORMAT in generate_config.py is updated if size changes
-COMPILER_ASSERT(sizeof(cfg_setting_t) == 9);
+COMPILER_ASSERT(sizeof(cfg_setting_t) == 41);
 
 // Sector buffer must be as big or bigger than settings
 COMPILER_ASSERT(sizeof(cfg_setting_t) < SECTOR_BUFFER_SIZE);
@@ -70,6 +78,7 @@ static const cfg_setting_t config_default = {
     .auto_rst = 0,
     .automation_allowed = 1,
     .overflow_detect = 1,
+    .swd_clock = {{0, 0}},
 };
 
 // Buffer for data to flash
@@ -163,6 +172,28 @@ void config_set_overflow_detect(bool on)
     program_cfg(&config_rom_copy);
 }
 
+void config_set_swd_clock(uint32_t idcode, uint32_t clock)
+{
+    cfg_swd_clock_t *entry = config_rom_copy.swd_clock;
+    uint32_t i;
+
+    if ((entry[0].idcode == idcode) && (entry[0].clock == clock)) {
+        return;
+    }
+
+    // Move the target to the front, dropping the least recently tuned
+    // one when it is new
+    for (i = 0; i < CFG_SWD_CLOCK_COUNT - 1; i++) {
+        if (entry[i].idcode == idcode) {
+            break;
+        }
+    }
+    memmove(&entry[1], &entry[0], i * sizeof(entry[0]));
+    entry[0].idcode = idcode;
+    entry[0].clock = clock;
+    program_cfg(&config_rom_copy);
+}
+
 bool config_get_auto_rst()
 {
     return config_rom_copy.auto_rst;
@@ -177,3 +208,16 @@ bool config_get_overflow_detect()
 {
     return config_rom_copy.overflow_detect;
 }
+
+uint32_t config_get_swd_clock(uint32_t idcode)
+{
+    uint32_t i;
+
+    for (i = 0; i < CFG_SWD_CLOCK_COUNT; i++) {
+        if (config_rom_copy.swd_clock[i].idcode == idcode) {
+            return config_rom_copy.swd_clock[i].clock;
+        }
+    }
+
+    return 0;
+}
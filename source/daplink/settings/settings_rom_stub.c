@@ -43,6 +43,11 @@ void config_set_overflow_detect(bool on)
     // Do nothing
 }
 
+void config_set_swd_clock(uint32_t idcode, uint32_t clock)
+{
+    // Do nothing
+}
+
 bool config_get_auto_rst()
 {
     return false;
@@ -57,3 +62,8 @@ bool config_get_overflow_detect()
 {
     return false;
 }
+
+uint32_t config_get_swd_clock(uint32_t idcode)
+{
+    return 0;
+}
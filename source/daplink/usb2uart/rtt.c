@@ -0,0 +1,432 @@
+/**
+ * @file    rtt.c
+ * @brief   Bridge between a SEGGER RTT control block in target RAM and CDC
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "string.h"
+
+#include "rtt.h"
+#include "circ_buf.h"
+#include "macro.h"
+#include "swd_host.h"
+#include "target_config.h"
+#include "flash_intf.h"
+#include "DAP_config.h"
+#include "DAP.h"
+
+// Control block layout, all fields are 32 bit
+//   char acID[16]
+//   int  MaxNumUpBuffers
+//   int  MaxNumDownBuffers
+//   SEGGER_RTT_BUFFER_UP   aUp[MaxNumUpBuffers]
+//   SEGGER_RTT_BUFFER_DOWN aDown[MaxNumDownBuffers]
+// Each buffer descriptor holds sName, pBuffer, SizeOfBuffer, WrOff,
+// RdOff and Flags
+#define RTT_ID              "SEGGER RTT"
+#define RTT_ID_SIZE         16
+#define RTT_CB_MAX_UP       (RTT_ID_SIZE + 0)
+#define RTT_CB_MAX_DOWN     (RTT_ID_SIZE + 4)
+#define RTT_CB_BUFFERS      (RTT_ID_SIZE + 8)
+#define RTT_BUFFER_SIZE     24
+#define RTT_BUFFER_PTR      4
+#define RTT_BUFFER_WROFF    12
+#define RTT_BUFFER_RDOFF    16
+#define RTT_MAX_BUFFERS     16
+
+// Data buffered on the interface between the target and the CDC port.
+// The up-buffer bounds the data moved per poll.
+#ifndef RTT_UP_BUFFER_SIZE
+#define RTT_UP_BUFFER_SIZE      512
+#endif
+#ifndef RTT_DOWN_BUFFER_SIZE
+#define RTT_DOWN_BUFFER_SIZE    64
+#endif
+
+// Target RAM searched for a control block per poll, in blocks of
+// RTT_SEARCH_BLOCK so the DAP task stays responsive to the host
+#define RTT_SEARCH_BLOCK        128
+#define RTT_SEARCH_PER_POLL     1024
+
+// Poll interval in ticks. It is halved while data is moving and doubled
+// while it is not.
+#define RTT_POLL_MIN_TICKS      1
+#define RTT_POLL_MAX_TICKS      16
+#define RTT_SEARCH_RETRY_TICKS  100
+#define RTT_DISABLED_TICKS      50
+
+typedef enum {
+    RTT_STATE_OFF,
+    RTT_STATE_ATTACH,
+    RTT_STATE_SEARCH,
+    RTT_STATE_RUN,
+} rtt_state_t;
+
+// Descriptor fields read from the target
+typedef struct {
+    uint32_t ptr;
+    uint32_t size;
+    uint32_t wr_off;
+    uint32_t rd_off;
+} rtt_buffer_t;
+
+static volatile bool rtt_enabled;
+static volatile bool rtt_found;
+
+// Only used on the DAP thread
+static rtt_state_t state;
+static uint32_t cb_addr;
+static uint32_t up_desc;
+static uint32_t down_desc;
+static uint32_t search_region;
+static uint32_t search_addr;
+static uint16_t poll_ticks;
+static uint8_t rtt_data[RTT_SEARCH_BLOCK + RTT_ID_SIZE];
+
+// Shared between the DAP and USB threads
+static circ_buf_t up_buffer;
+static uint8_t up_buffer_data[RTT_UP_BUFFER_SIZE];
+static circ_buf_t down_buffer;
+static uint8_t down_buffer_data[RTT_DOWN_BUFFER_SIZE];
+
+void rtt_init(void)
+{
+    rtt_enabled = false;
+    rtt_found = false;
+    state = RTT_STATE_OFF;
+    circ_buf_init(&up_buffer, up_buffer_data, sizeof(up_buffer_data));
+    circ_buf_init(&down_buffer, down_buffer_data, sizeof(down_buffer_data));
+}
+
+void rtt_enable(bool enabled)
+{
+    rtt_enabled = enabled;
+}
+
+bool rtt_active(void)
+{
+    return rtt_found;
+}
+
+int32_t rtt_read_data(uint8_t *data, uint16_t size)
+{
+    return circ_buf_read(&up_buffer, data, size);
+}
+
+int32_t rtt_write_free(void)
+{
+    return circ_buf_count_free(&down_buffer);
+}
+
+int32_t rtt_write_data(uint8_t *data, uint16_t size)
+{
+    return circ_buf_write(&down_buffer, data, size);
+}
+
+#ifndef TARGET_MCU_CORTEX_A
+
+// RAM region to search, the main region followed by the extra ones
+static const region_info_t *rtt_region(uint32_t index, region_info_t *main_region)
+{
+    if (index == 0) {
+        main_region->start = target_device.ram_start;
+        main_region->end = target_device.ram_end;
+        return main_region;
+    }
+
+    if ((index > MAX_EXTRA_RAM_REGION) || (target_device.extra_ram[index - 1].start == 0)) {
+        return NULL;
+    }
+
+    return &target_device.extra_ram[index - 1];
+}
+
+// Check there is a control block at addr and set up the descriptors
+static bool rtt_check_cb(uint32_t addr)
+{
+    uint32_t header[(RTT_ID_SIZE + 8) / 4];
+    uint32_t max_up;
+    uint32_t max_down;
+
+    if (!swd_read_memory(addr, (uint8_t *)header, sizeof(header))) {
+        return false;
+    }
+
+    if (memcmp(header, RTT_ID, sizeof(RTT_ID)) != 0) {
+        return false;
+    }
+
+    max_up = header[RTT_CB_MAX_UP / 4];
+    max_down = header[RTT_CB_MAX_DOWN / 4];
+    if ((max_up == 0) || (max_up > RTT_MAX_BUFFERS) || (max_down > RTT_MAX_BUFFERS)) {
+        return false;
+    }
+
+    cb_addr = addr;
+    up_desc = addr + RTT_CB_BUFFERS;
+    down_desc = (max_down > 0) ? up_desc + max_up * RTT_BUFFER_SIZE : 0;
+    return true;
+}
+
+// Search part of target RAM for the control block. It is 4 byte aligned
+// and blocks overlap so an ID across two blocks is still found.
+static bool rtt_search(void)
+{
+    region_info_t main_region;
+    const region_info_t *region;
+    uint32_t searched = 0;
+    uint32_t size;
+    uint32_t i;
+
+    while (searched < RTT_SEARCH_PER_POLL) {
+        region = rtt_region(search_region, &main_region);
+        if (region == NULL) {
+            search_region = 0;
+            search_addr = 0;
+            return false;
+        }
+
+        if (search_addr < region->start) {
+            search_addr = region->start;
+        }
+
+        if (search_addr + sizeof(RTT_ID) > region->end) {
+            search_region++;
+            search_addr = 0;
+            continue;
+        }
+
+        size = MIN(sizeof(rtt_data), region->end - search_addr);
+        if (!swd_read_memory(search_addr, rtt_data, size)) {
+            // Start over once the target can be attached again
+            search_region = 0;
+            search_addr = 0;
+            return false;
+        }
+
+        for (i = 0; (i < RTT_SEARCH_BLOCK) && (i + sizeof(RTT_ID) <= size); i += 4) {
+            if ((memcmp(&rtt_data[i], RTT_ID, sizeof(RTT_ID)) == 0) && rtt_check_cb(search_addr + i)) {
+                return true;
+            }
+        }
+
+        search_addr += RTT_SEARCH_BLOCK;
+        searched += RTT_SEARCH_BLOCK;
+    }
+
+    return false;
+}
+
+static bool rtt_read_buffer(uint32_t desc, rtt_buffer_t *buffer)
+{
+    if (!swd_read_memory(desc + RTT_BUFFER_PTR, (uint8_t *)buffer, sizeof(*buffer))) {
+        return false;
+    }
+
+    // A target reset or a corrupted block, look for it again
+    return (buffer->size != 0) && (buffer->wr_off < buffer->size) && (buffer->rd_off < buffer->size);
+}
+
+// Move data from the target up-buffer. Returns the number of bytes moved
+// or -1 if the control block is no longer valid.
+static int32_t rtt_poll_up(void)
+{
+    rtt_buffer_t buffer;
+    uint32_t moved = 0;
+    uint32_t size;
+
+    if (!rtt_read_buffer(up_desc, &buffer)) {
+        return -1;
+    }
+
+    while (buffer.rd_off != buffer.wr_off) {
+        if (buffer.wr_off > buffer.rd_off) {
+            size = buffer.wr_off - buffer.rd_off;
+        } else {
+            size = buffer.size - buffer.rd_off;
+        }
+
+        size = MIN(size, circ_buf_count_free(&up_buffer));
+        size = MIN(size, sizeof(rtt_data));
+        if (size == 0) {
+            break;
+        }
+
+        if (!swd_read_memory(buffer.ptr + buffer.rd_off, rtt_data, size)) {
+            return -1;
+        }
+
+        circ_buf_write(&up_buffer, rtt_data, size);
+        buffer.rd_off = (buffer.rd_off + size) % buffer.size;
+        moved += size;
+    }
+
+    if (moved && !swd_write_word(up_desc + RTT_BUFFER_RDOFF, buffer.rd_off)) {
+        return -1;
+    }
+
+    return moved;
+}
+
+// Move data queued by the host to the target down-buffer
+static int32_t rtt_poll_down(void)
+{
+    rtt_buffer_t buffer;
+    uint32_t moved = 0;
+    uint32_t size;
+
+    if ((down_desc == 0) || (circ_buf_count_used(&down_buffer) == 0)) {
+        return 0;
+    }
+
+    if (!rtt_read_buffer(down_desc, &buffer)) {
+        return -1;
+    }
+
+    while (1) {
+        // One byte stays free so a full buffer differs from an empty one
+        if (buffer.rd_off > buffer.wr_off) {
+            size = buffer.rd_off - buffer.wr_off - 1;
+        } else {
+            size = buffer.size - buffer.wr_off - ((buffer.rd_off == 0) ? 1 : 0);
+        }
+
+        size = MIN(size, sizeof(rtt_data));
+        size = circ_buf_read(&down_buffer, rtt_data, size);
+        if (size == 0) {
+            break;
+        }
+
+        if (!swd_write_memory(buffer.ptr + buffer.wr_off, rtt_data, size)) {
+            return -1;
+        }
+
+        buffer.wr_off = (buffer.wr_off + size) % buffer.size;
+        moved += size;
+    }
+
+    if (moved && !swd_write_word(down_desc + RTT_BUFFER_WROFF, buffer.wr_off)) {
+        return -1;
+    }
+
+    return moved;
+}
+
+uint16_t rtt_process(void)
+{
+    int32_t up;
+    int32_t down;
+    bool wire_free;
+
+    // The host debugger and drag-n-drop programming own the wire while
+    // they are active
+    wire_free = (DAP_Data.debug_port == DAP_PORT_DISABLED) && !flash_intf_target->flash_busy();
+
+    if (!rtt_enabled) {
+        if (state != RTT_STATE_OFF) {
+            if (wire_free) {
+                swd_off();
+            }
+            rtt_found = false;
+            state = RTT_STATE_OFF;
+        }
+        return RTT_DISABLED_TICKS;
+    }
+
+    // Attach again afterwards, as the target may have been reset and
+    // the SW-DP state changed
+    if (!wire_free) {
+        if (state != RTT_STATE_OFF) {
+            state = RTT_STATE_ATTACH;
+        }
+        return RTT_POLL_MAX_TICKS;
+    }
+
+    switch (state) {
+        case RTT_STATE_OFF:
+            circ_buf_init(&up_buffer, up_buffer_data, sizeof(up_buffer_data));
+            circ_buf_init(&down_buffer, down_buffer_data, sizeof(down_buffer_data));
+            cb_addr = 0;
+            state = RTT_STATE_ATTACH;
+            // Fall through
+
+        case RTT_STATE_ATTACH:
+            if (!swd_attach()) {
+                rtt_found = false;
+                return RTT_SEARCH_RETRY_TICKS;
+            }
+
+            // Try where the control block was before searching again
+            poll_ticks = RTT_POLL_MIN_TICKS;
+            if ((cb_addr != 0) && rtt_check_cb(cb_addr)) {
+                rtt_found = true;
+                state = RTT_STATE_RUN;
+                return poll_ticks;
+            }
+
+            rtt_found = false;
+            search_region = 0;
+            search_addr = 0;
+            state = RTT_STATE_SEARCH;
+            return RTT_POLL_MIN_TICKS;
+
+        case RTT_STATE_SEARCH:
+            if (rtt_search()) {
+                rtt_found = true;
+                state = RTT_STATE_RUN;
+                return RTT_POLL_MIN_TICKS;
+            }
+
+            // Once all of RAM has been searched wait for the target to
+            // set up a control block, likely after it has started
+            if ((search_region == 0) && (search_addr == 0)) {
+                state = RTT_STATE_ATTACH;
+                return RTT_SEARCH_RETRY_TICKS;
+            }
+
+            return RTT_POLL_MIN_TICKS;
+
+        case RTT_STATE_RUN:
+            up = rtt_poll_up();
+            down = (up < 0) ? -1 : rtt_poll_down();
+            if ((up < 0) || (down < 0)) {
+                state = RTT_STATE_ATTACH;
+                return RTT_POLL_MIN_TICKS;
+            }
+
+            if ((up > 0) || (down > 0)) {
+                poll_ticks = MAX(poll_ticks / 2, RTT_POLL_MIN_TICKS);
+            } else {
+                poll_ticks = MIN(poll_ticks * 2, RTT_POLL_MAX_TICKS);
+            }
+
+            return poll_ticks;
+    }
+
+    return RTT_POLL_MAX_TICKS;
+}
+
+#else
+
+uint16_t rtt_process(void)
+{
+    // Not supported on Cortex-A targets
+    return 0xFFFF;
+}
+
+#endif
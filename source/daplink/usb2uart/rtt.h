@@ -0,0 +1,61 @@
+/**
+ * @file    rtt.h
+ * @brief   Bridge between a SEGGER RTT control block in target RAM and CDC
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RTT_H
+#define RTT_H
+
+#include "stdbool.h"
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Initialize the RTT bridge, it starts disabled
+void rtt_init(void);
+
+// Start or stop looking for a control block in target RAM.
+// Callable from any thread.
+void rtt_enable(bool enabled);
+
+// Return true once a control block has been found. While it has the
+// CDC port carries RTT channel 0 instead of the UART.
+bool rtt_active(void);
+
+// Read data received from the target up-buffer
+int32_t rtt_read_data(uint8_t *data, uint16_t size);
+
+// Get the space free for data going to the target down-buffer
+int32_t rtt_write_free(void);
+
+// Queue data for the target down-buffer
+int32_t rtt_write_data(uint8_t *data, uint16_t size);
+
+// Poll the target. Must only be called from the thread running CMSIS-DAP
+// commands, since both use SWD. Returns the number of ticks until the
+// next call.
+uint16_t rtt_process(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -23,8 +23,10 @@
 #include "rl_usb.h"
 #include "main.h"
 #include "target_reset.h"
+#include "swd_host.h"
 #include "uart.h"
 #include "flash_intf.h"
+#include "rtt.h"
 
 UART_Configuration UART_Config;
 
@@ -116,7 +118,9 @@ int32_t USBD_CDC_ACM_SendBreak(uint16_t dur)
         // reset and send the unique id over CDC
         if (dur != 0) {
             start_break_time = os_time_get();
+            swd_lock();
             target_set_state(RESET_HOLD);
+            swd_unlock();
         } else {
             end_break_time = os_time_get();
 
@@ -143,6 +147,8 @@ int32_t USBD_CDC_ACM_SendBreak(uint16_t dur)
  */
 int32_t USBD_CDC_ACM_PortSetControlLineState(uint16_t ctrl_bmp)
 {
+    // Look for RTT on the target while a terminal has the port open
+    rtt_enable((ctrl_bmp & 1) != 0);
     return (1);
 }
 
@@ -158,7 +164,11 @@ void cdc_process_event()
     }
 
     if (len_data) {
-        len_data = uart_read_data(data, len_data);
+        if (rtt_active()) {
+            len_data = rtt_read_data(data, len_data);
+        } else {
+            len_data = uart_read_data(data, len_data);
+        }
     }
 		
 		//HIER WIRD DER USART GELESEN !! ZEICHENERKENNUNG FR SELECTOR HIER PRFEN
@@ -169,7 +179,11 @@ void cdc_process_event()
         }
     }
 
-    len_data = uart_write_free();
+    if (rtt_active()) {
+        len_data = rtt_write_free();
+    } else {
+        len_data = uart_write_free();
+    }
 
     if (len_data > sizeof(data)) {
         len_data = sizeof(data);
@@ -180,7 +194,13 @@ void cdc_process_event()
     }
 
     if (len_data) {
-        if (uart_write_data(data, len_data)) {
+        if (rtt_active()) {
+            len_data = rtt_write_data(data, len_data);
+        } else {
+            len_data = uart_write_data(data, len_data);
+        }
+
+        if (len_data) {
             main_blink_cdc_led(MAIN_LED_FLASH);
         }
     }
@@ -124,6 +124,38 @@ uint32_t util_div_round(uint32_t dividen, uint32_t divisor)
     return (dividen + divisor / 2) / divisor;
 }
 
+bool util_is_filled(const uint8_t *buf, uint32_t size, uint8_t value)
+{
+    uint32_t pattern = 0x01010101u * value;
+
+    // Compare a byte at a time until the buffer is word aligned
+    while ((size > 0) && ((uint32_t)buf & 3)) {
+        if (*buf != value) {
+            return false;
+        }
+        buf++;
+        size--;
+    }
+
+    while (size >= 4) {
+        if (*(const uint32_t *)buf != pattern) {
+            return false;
+        }
+        buf += 4;
+        size -= 4;
+    }
+
+    while (size > 0) {
+        if (*buf != value) {
+            return false;
+        }
+        buf++;
+        size--;
+    }
+
+    return true;
+}
+
 void _util_assert(bool expression, const char *filename, uint16_t line)
 {
     bool assert_set;
@@ -42,6 +42,9 @@ uint32_t util_div_round_up(uint32_t dividen, uint32_t divisor);
 uint32_t util_div_round_down(uint32_t dividen, uint32_t divisor);
 uint32_t util_div_round(uint32_t dividen, uint32_t divisor);
 
+// Return true if every byte in the buffer is equal to value
+bool util_is_filled(const uint8_t *buf, uint32_t size, uint8_t value);
+
 #if !(defined(DAPLINK_NO_ASSERT_FILENAMES) && defined(DAPLINK_BL))
 // With the filename enabled.
 #define util_assert(expression) _util_assert((expression), __FILE__, __LINE__)
@@ -84,3 +84,22 @@ __weak uint8_t validate_hexfile(const uint8_t *buf)
     // add hex identifier b[0] == ':' && b[8] == {'0', '2', '3', '4', '5'}
     return ((buf[0] == ':') && ((buf[8] == '0') || (buf[8] == '2') || (buf[8] == '3') || (buf[8] == '4') || (buf[8] == '5'))) ? 1 : 0;
 }
+
+__weak uint8_t validate_elffile(const uint8_t *buf)
+{
+    // 32 bit little endian ARM executable: ELF magic, ELFCLASS32,
+    // ELFDATA2LSB, e_type ET_EXEC and e_machine EM_ARM
+    return ((buf[0] == 0x7F) && (buf[1] == 'E') && (buf[2] == 'L') && (buf[3] == 'F') &&
+            (buf[4] == 1) && (buf[5] == 1) &&
+            (buf[16] == 2) && (buf[17] == 0) && (buf[18] == 40) && (buf[19] == 0)) ? 1 : 0;
+}
+
+__weak uint8_t validate_uf2block(const uint8_t *buf)
+{
+    // A UF2 block starts and ends with fixed magic numbers
+    uint32_t magic_start0, magic_start1, magic_end;
+    memcpy(&magic_start0, buf + 0, sizeof(magic_start0));
+    memcpy(&magic_start1, buf + 4, sizeof(magic_start1));
+    memcpy(&magic_end, buf + 508, sizeof(magic_end));
+    return ((magic_start0 == 0x0A324655) && (magic_start1 == 0x9E5D5157) && (magic_end == 0x0AB16F30)) ? 1 : 0;
+}
@@ -30,6 +30,8 @@ extern "C" {
 
 uint8_t validate_bin_nvic(const uint8_t *buf);
 uint8_t validate_hexfile(const uint8_t *buf);
+uint8_t validate_elffile(const uint8_t *buf);
+uint8_t validate_uf2block(const uint8_t *buf);
 
 #ifdef __cplusplus
 }
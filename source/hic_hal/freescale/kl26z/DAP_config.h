@@ -81,20 +81,36 @@ Provides definitions about:
 /// setting can be reduced (valid range is 1 .. 255). Change setting to 4 for High-Speed USB.
 #define DAP_PACKET_COUNT        5              ///< Buffers: 64 = Full-Speed, 4 = High-Speed.
 
+/// Response Buffers shared by the CMSIS-DAP transports.
+/// Responses are kept apart from the request buffers so queued commands can be executed
+/// back to back while the host collects earlier responses. Streaming commands take their
+/// extra response packets from the same pool.
+#define DAP_RESPONSE_COUNT      8              ///< Response Buffers: at least 2.
+
 /// Indicate that UART Serial Wire Output (SWO) trace is available.
 /// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
-#define SWO_UART                0               ///< SWO UART:  1 = available, 0 = not available
+#define SWO_UART                1               ///< SWO UART:  1 = available, 0 = not available
+
+/// SWO UART is captured by the native UART0/DMA driver (swo_uart.c) instead of a CMSIS USART driver.
+#define SWO_UART_NATIVE         1               ///< SWO UART Driver: 1 = native, 0 = CMSIS Driver_USART
 
 /// Maximum SWO UART Baudrate
-#define SWO_UART_MAX_BAUDRATE   10000000U       ///< SWO UART Maximum Baudrate in Hz
+#define SWO_UART_MAX_BAUDRATE   6000000U        ///< SWO UART Maximum Baudrate in Hz
 
 /// Indicate that Manchester Serial Wire Output (SWO) trace is available.
 /// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
-#define SWO_MANCHESTER          0               ///< SWO Manchester:  1 = available, 0 = not available
+#define SWO_MANCHESTER          1               ///< SWO Manchester:  1 = available, 0 = not available
+
+/// Maximum SWO Manchester Baudrate. Edges are decoded in software, which bounds the rate.
+#define SWO_MANCHESTER_MAX_BAUDRATE 250000U     ///< SWO Manchester Maximum Baudrate in Hz
 
 /// SWO Trace Buffer Size.
 #define SWO_BUFFER_SIZE         4096U           ///< SWO Trace Buffer Size in bytes (must be 2^n)
 
+/// Indicate that SWO Streaming Trace is available over the bulk SWO trace endpoint.
+/// This information is returned by the command \ref DAP_Info as part of <b>Capabilities</b>.
+#define SWO_STREAM              1               ///< SWO Streaming Trace: 1 = available, 0 = not available
+
 
 /// Debug Unit is connected to fixed Target Device.
 /// The Debug Unit may be part of an evaluation board and always connected to a fixed
@@ -161,4 +161,28 @@ COMPILER_ASSERT(DAPLINK_HIC_ID == DAPLINK_HIC_ID_KL26);
 #define UART_RX_TX_IRQn         UART1_IRQn
 #define UART_RX_TX_IRQHandler   UART1_IRQHandler
 
+// SWO UART, captured by UART0 through DMA
+// RX PTA1
+#define SWO_UART_PORT           PORTA
+#define SWO_UART_PORT_CLOCK     SIM_SCGC5_PORTA_MASK
+#define PIN_SWO_RX_BIT          (1)
+#define PIN_SWO_RX_MUX_ALT      (2)
+// UART0 is clocked from MCGPLLCLK/2, which is selected for USB
+#define SWO_UART_CLOCK          (48000000U)
+#define SWO_DMA_CHANNEL         (0)
+#define SWO_DMA_IRQn            DMA0_IRQn
+#define SWO_DMA_IRQHandler      DMA0_IRQHandler
+
+// SWO Manchester, edges on the same pin timestamped by TPM2 channel 0
+// and copied out by DMA
+#define PIN_SWO_TPM_MUX_ALT     (3)
+// TPM2 is clocked from MCGPLLCLK/2 like UART0
+#define SWO_TPM_CLOCK           (48000000U)
+#define SWO_EDGE_DMA_CHANNEL    (1)
+#define SWO_EDGE_DMA_IRQn       DMA1_IRQn
+#define SWO_EDGE_DMA_IRQHandler DMA1_IRQHandler
+// TPM2 overflow and channel 1 compare mark the line idle between edges
+#define SWO_TPM_IRQn            TPM2_IRQn
+#define SWO_TPM_IRQHandler      TPM2_IRQHandler
+
 #endif
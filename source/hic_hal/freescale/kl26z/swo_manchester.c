@@ -0,0 +1,312 @@
+/**
+ * @file    swo_manchester.c
+ * @brief   SWO Manchester edge capture using TPM2 and DMA
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "swo_manchester.h"
+#include "IO_Config.h"
+#include "DAP_config.h"
+
+// The bootloader shares this directory but has no SWO support, and the
+// interrupt handlers below would replace its default vectors
+#if defined(DAPLINK_IF) && (SWO_MANCHESTER != 0)
+
+// DMAMUX source for TPM2 channel 0
+#define EDGE_DMA_SOURCE         (34)
+#define EDGE_DMA                (DMA0->DMA[SWO_EDGE_DMA_CHANNEL])
+#define EDGE_TPM_CHANNEL        (TPM2->CONTROLS[0])
+// Software compare half way through the count, with the overflow it
+// checks the line twice per timestamp wrap
+#define HALF_TPM_CHANNEL        (TPM2->CONTROLS[1])
+
+// The DMA wraps its destination in the edge ring through DMOD, so the
+// ring must be a power of two in size and aligned to it
+#define EDGE_COUNT              512
+#define EDGE_DMOD               7       // 1 KByte
+// Edges per DMA transfer, each completion is reported to SWO.c
+#define EDGE_BLOCK              128
+
+static uint16_t edge_buf[EDGE_COUNT] __attribute__((aligned(EDGE_COUNT * 2)));
+
+// Edges written by the completed DMA transfers
+static volatile uint32_t edge_blocks;
+// Edges released
+static uint32_t edge_out;
+static volatile uint8_t edge_running;
+static uint8_t edge_lost;
+
+// Edge counts at which the line had gone a whole half wrap without an
+// edge. The edge after a mark is too far from the one before it for
+// their 16 bit timestamps to tell the time between them.
+#define IDLE_COUNT              8
+static uint32_t idle_mark[IDLE_COUNT];
+static volatile uint32_t idle_in;
+static uint32_t idle_out;
+// Edges at the previous half wrap and at the newest mark
+static uint32_t idle_edges;
+static uint32_t idle_last;
+
+// Get the number of edges written so far
+static uint32_t edge_in(void)
+{
+    uint32_t in;
+
+    // The timer interrupt reads this too, keep it from re-enabling the
+    // DMA interrupt in the middle
+    NVIC_DisableIRQ(SWO_TPM_IRQn);
+    NVIC_DisableIRQ(SWO_EDGE_DMA_IRQn);
+    in = edge_blocks;
+    if (edge_running) {
+        in += EDGE_BLOCK - (EDGE_DMA.DSR_BCR & DMA_DSR_BCR_BCR_MASK) / 2;
+    }
+    NVIC_EnableIRQ(SWO_EDGE_DMA_IRQn);
+    NVIC_EnableIRQ(SWO_TPM_IRQn);
+
+    return in;
+}
+
+static void edge_dma_arm(void)
+{
+    EDGE_DMA.DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+    EDGE_DMA.DSR_BCR = DMA_DSR_BCR_BCR(EDGE_BLOCK * 2);
+    EDGE_DMA.DCR |= DMA_DCR_ERQ_MASK;
+}
+
+uint32_t swo_manchester_initialize(void)
+{
+    NVIC_DisableIRQ(SWO_EDGE_DMA_IRQn);
+    NVIC_DisableIRQ(SWO_TPM_IRQn);
+
+    SIM->SCGC5 |= SWO_UART_PORT_CLOCK;
+    SIM->SCGC6 |= SIM_SCGC6_TPM2_MASK | SIM_SCGC6_DMAMUX_MASK;
+    SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+    SIM->SOPT2 = (SIM->SOPT2 & ~SIM_SOPT2_TPMSRC_MASK) | SIM_SOPT2_TPMSRC(1);
+
+    // Free running over the full 16 bits, no prescaler
+    TPM2->SC = 0;
+    TPM2->CNT = 0;
+    TPM2->MOD = 0xFFFF;
+    EDGE_TPM_CHANNEL.CnSC = 0;
+    HALF_TPM_CHANNEL.CnSC = 0;
+    HALF_TPM_CHANNEL.CnV = 0x8000;
+    HALF_TPM_CHANNEL.CnSC = TPM_CnSC_CHF_MASK;
+    HALF_TPM_CHANNEL.CnSC = TPM_CnSC_MSA_MASK | TPM_CnSC_CHIE_MASK;
+    TPM2->SC = TPM_SC_TOF_MASK;
+    TPM2->SC = TPM_SC_CMOD(1) | TPM_SC_PS(0) | TPM_SC_TOIE_MASK;
+
+    // Manchester SWO idles low
+    SWO_UART_PORT->PCR[PIN_SWO_RX_BIT] = PORT_PCR_MUX(PIN_SWO_TPM_MUX_ALT) | PORT_PCR_PE_MASK;
+
+    // One 16 bit capture value per request, the request is dropped
+    // at the end of each block until the interrupt re-arms it
+    DMAMUX0->CHCFG[SWO_EDGE_DMA_CHANNEL] = 0;
+    EDGE_DMA.DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+    EDGE_DMA.SAR = (uint32_t)&EDGE_TPM_CHANNEL.CnV;
+    EDGE_DMA.DAR = (uint32_t)edge_buf;
+    EDGE_DMA.DCR = DMA_DCR_EINT_MASK | DMA_DCR_CS_MASK | DMA_DCR_SSIZE(2) |
+                   DMA_DCR_DINC_MASK | DMA_DCR_DSIZE(2) | DMA_DCR_DMOD(EDGE_DMOD) |
+                   DMA_DCR_D_REQ_MASK;
+    DMAMUX0->CHCFG[SWO_EDGE_DMA_CHANNEL] = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(EDGE_DMA_SOURCE);
+    edge_running = 0;
+    edge_blocks = 0;
+    edge_out = 0;
+    edge_lost = 0;
+    idle_in = 0;
+    idle_out = 0;
+
+    NVIC_ClearPendingIRQ(SWO_EDGE_DMA_IRQn);
+    NVIC_EnableIRQ(SWO_EDGE_DMA_IRQn);
+    NVIC_ClearPendingIRQ(SWO_TPM_IRQn);
+    NVIC_EnableIRQ(SWO_TPM_IRQn);
+    return 1;
+}
+
+void swo_manchester_uninitialize(void)
+{
+    swo_manchester_stop();
+    NVIC_DisableIRQ(SWO_EDGE_DMA_IRQn);
+    NVIC_DisableIRQ(SWO_TPM_IRQn);
+    DMAMUX0->CHCFG[SWO_EDGE_DMA_CHANNEL] = 0;
+    TPM2->SC = 0;
+    SWO_UART_PORT->PCR[PIN_SWO_RX_BIT] = PORT_PCR_MUX(0);
+    SIM->SCGC6 &= ~SIM_SCGC6_TPM2_MASK;
+}
+
+uint32_t swo_manchester_clock(void)
+{
+    return SWO_TPM_CLOCK;
+}
+
+void swo_manchester_start(void)
+{
+    swo_manchester_stop();
+
+    edge_blocks = 0;
+    edge_out = 0;
+    edge_lost = 0;
+    NVIC_DisableIRQ(SWO_TPM_IRQn);
+    idle_in = 0;
+    idle_out = 0;
+    idle_edges = 0;
+    idle_last = 0;
+    NVIC_EnableIRQ(SWO_TPM_IRQn);
+    EDGE_DMA.DAR = (uint32_t)edge_buf;
+    edge_running = 1;
+    edge_dma_arm();
+
+    // Capture on both edges, the channel flag requests the DMA
+    EDGE_TPM_CHANNEL.CnSC = TPM_CnSC_CHF_MASK;
+    EDGE_TPM_CHANNEL.CnSC = TPM_CnSC_ELSA_MASK | TPM_CnSC_ELSB_MASK |
+                            TPM_CnSC_CHIE_MASK | TPM_CnSC_DMA_MASK;
+}
+
+void swo_manchester_stop(void)
+{
+    uint32_t in;
+
+    if (!edge_running) {
+        return;
+    }
+
+    EDGE_TPM_CHANNEL.CnSC = 0;
+    EDGE_DMA.DCR &= ~DMA_DCR_ERQ_MASK;
+    in = edge_in();
+
+    // Keep a completion that raced with the stop from being counted
+    NVIC_DisableIRQ(SWO_EDGE_DMA_IRQn);
+    edge_running = 0;
+    edge_blocks = in;
+    EDGE_DMA.DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+    NVIC_ClearPendingIRQ(SWO_EDGE_DMA_IRQn);
+    NVIC_EnableIRQ(SWO_EDGE_DMA_IRQn);
+}
+
+uint32_t swo_manchester_read(const uint16_t **edges)
+{
+    uint32_t in = edge_in();
+    uint32_t count = in - edge_out;
+    uint32_t index;
+    uint32_t mark;
+
+    // The DMA has wrapped onto edges that were not read yet
+    if (count >= EDGE_COUNT) {
+        edge_out = in;
+        edge_lost = 1;
+        return 0;
+    }
+
+    // Stop at the next idle mark so swo_manchester_idle() reports it
+    // before the edge after it is read. Marks left behind by an overrun
+    // are dropped.
+    while (idle_out != idle_in) {
+        mark = idle_mark[idle_out % IDLE_COUNT];
+        if ((int32_t)(mark - edge_out) >= 0) {
+            if (count > mark - edge_out) {
+                count = mark - edge_out;
+            }
+            break;
+        }
+        idle_out++;
+    }
+
+    index = edge_out & (EDGE_COUNT - 1);
+    if (count > EDGE_COUNT - index) {
+        count = EDGE_COUNT - index;
+    }
+
+    *edges = &edge_buf[index];
+    return count;
+}
+
+void swo_manchester_release(uint32_t count)
+{
+    edge_out += count;
+}
+
+uint32_t swo_manchester_idle(void)
+{
+    if ((idle_out != idle_in) && (idle_mark[idle_out % IDLE_COUNT] == edge_out)) {
+        idle_out++;
+        return 1;
+    }
+    return 0;
+}
+
+uint32_t swo_manchester_overrun(void)
+{
+    uint32_t lost = edge_lost;
+
+    edge_lost = 0;
+    return lost;
+}
+
+void SWO_EDGE_DMA_IRQHandler(void)
+{
+    uint32_t status = EDGE_DMA.DSR_BCR;
+
+    if (!(status & DMA_DSR_BCR_DONE_MASK)) {
+        return;
+    }
+
+    if (!edge_running) {
+        EDGE_DMA.DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+        return;
+    }
+
+    // An edge arriving now is held in the channel value register
+    // until the DMA is re-armed. DAR carries on through the ring.
+    edge_blocks += EDGE_BLOCK;
+    edge_dma_arm();
+
+    if (status & (DMA_DSR_BCR_CE_MASK | DMA_DSR_BCR_BES_MASK | DMA_DSR_BCR_BED_MASK)) {
+        edge_lost = 1;
+    }
+
+    swo_manchester_event();
+}
+
+void SWO_TPM_IRQHandler(void)
+{
+    uint32_t in;
+
+    // Runs twice per timestamp wrap, on the overflow and half way
+    TPM2->SC |= TPM_SC_TOF_MASK;
+    HALF_TPM_CHANNEL.CnSC |= TPM_CnSC_CHF_MASK;
+
+    if (!edge_running) {
+        return;
+    }
+
+    // No edge in a whole half wrap, so the next one may be a wrap or
+    // more after the last. Mark each quiet spell once.
+    in = edge_in();
+    if ((in == idle_edges) && (in != idle_last)) {
+        if (idle_in - idle_out < IDLE_COUNT) {
+            idle_mark[idle_in % IDLE_COUNT] = in;
+            idle_in++;
+        } else {
+            edge_lost = 1;
+        }
+        idle_last = in;
+        swo_manchester_event();
+    }
+    idle_edges = in;
+}
+
+#endif
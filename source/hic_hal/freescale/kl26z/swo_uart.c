@@ -0,0 +1,229 @@
+/**
+ * @file    swo_uart.c
+ * @brief   SWO UART capture using UART0 and DMA
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "swo_uart.h"
+#include "IO_Config.h"
+#include "DAP_config.h"
+#include "DAP.h"
+
+// The bootloader shares this directory but has no SWO support, and the
+// interrupt handlers below would replace its default vectors
+#if defined(DAPLINK_IF) && (SWO_UART != 0) && (SWO_UART_NATIVE != 0)
+
+// DMAMUX source for UART0 receive
+#define SWO_DMA_SOURCE          (2)
+#define SWO_DMA                 (DMA0->DMA[SWO_DMA_CHANNEL])
+
+// The UART0 receiver takes 4 to 32 samples per bit
+#define OSR_MIN                 4
+#define OSR_MAX                 32
+#define SBR_MAX                 0x1FFF
+
+#define UART0_S1_ERRORS         (UART0_S1_OR_MASK | UART0_S1_NF_MASK | UART0_S1_FE_MASK | UART0_S1_PF_MASK)
+
+// Size of the receive in progress, 0 if stopped
+static volatile uint32_t rx_size;
+
+uint32_t swo_uart_initialize(void)
+{
+    NVIC_DisableIRQ(SWO_DMA_IRQn);
+    NVIC_DisableIRQ(UART0_IRQn);
+
+    SIM->SCGC5 |= SWO_UART_PORT_CLOCK;
+    SIM->SCGC4 |= SIM_SCGC4_UART0_MASK;
+    SIM->SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+    SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+    SIM->SOPT2 = (SIM->SOPT2 & ~SIM_SOPT2_UART0SRC_MASK) | SIM_SOPT2_UART0SRC(1);
+
+    // 8N1, receiver off until a capture is started
+    UART0->C2 = 0;
+    UART0->C1 = 0;
+    UART0->C3 = 0;
+    UART0->C5 = UART0_C5_RDMAE_MASK;
+    UART0->S1 = UART0_S1_ERRORS;
+
+    // SWO idles high
+    SWO_UART_PORT->PCR[PIN_SWO_RX_BIT] = PORT_PCR_MUX(PIN_SWO_RX_MUX_ALT) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK;
+
+    // One byte from the data register per request, the request
+    // is dropped once the byte count reaches zero
+    DMAMUX0->CHCFG[SWO_DMA_CHANNEL] = 0;
+    SWO_DMA.DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+    SWO_DMA.SAR = (uint32_t)&UART0->D;
+    SWO_DMA.DCR = DMA_DCR_EINT_MASK | DMA_DCR_CS_MASK | DMA_DCR_SSIZE(1) |
+                  DMA_DCR_DINC_MASK | DMA_DCR_DSIZE(1) | DMA_DCR_D_REQ_MASK;
+    DMAMUX0->CHCFG[SWO_DMA_CHANNEL] = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(SWO_DMA_SOURCE);
+    rx_size = 0;
+
+    NVIC_ClearPendingIRQ(SWO_DMA_IRQn);
+    NVIC_EnableIRQ(SWO_DMA_IRQn);
+    NVIC_ClearPendingIRQ(UART0_IRQn);
+    NVIC_EnableIRQ(UART0_IRQn);
+    return 1;
+}
+
+void swo_uart_uninitialize(void)
+{
+    swo_uart_abort();
+    NVIC_DisableIRQ(SWO_DMA_IRQn);
+    NVIC_DisableIRQ(UART0_IRQn);
+    DMAMUX0->CHCFG[SWO_DMA_CHANNEL] = 0;
+    SWO_UART_PORT->PCR[PIN_SWO_RX_BIT] = PORT_PCR_MUX(0);
+    SIM->SCGC4 &= ~SIM_SCGC4_UART0_MASK;
+}
+
+uint32_t swo_uart_set_baudrate(uint32_t baudrate)
+{
+    uint32_t osr;
+    uint32_t sbr;
+    uint32_t actual;
+    uint32_t error;
+    uint32_t best_osr = 0;
+    uint32_t best_sbr = 0;
+    uint32_t best_error = 0xFFFFFFFF;
+
+    if (baudrate == 0) {
+        return 0;
+    }
+
+    // Keep the highest oversampling ratio giving the smallest error
+    for (osr = OSR_MIN; osr <= OSR_MAX; osr++) {
+        sbr = (SWO_UART_CLOCK + (baudrate * osr) / 2) / (baudrate * osr);
+        if ((sbr == 0) || (sbr > SBR_MAX)) {
+            continue;
+        }
+        actual = SWO_UART_CLOCK / (osr * sbr);
+        error = (actual > baudrate) ? (actual - baudrate) : (baudrate - actual);
+        if (error <= best_error) {
+            best_error = error;
+            best_osr = osr;
+            best_sbr = sbr;
+        }
+    }
+
+    // More than ~3% off and the frames can not be sampled reliably
+    if ((best_sbr == 0) || (best_error > baudrate / 32)) {
+        return 0;
+    }
+
+    UART0->BDH = UART0_BDH_SBR(best_sbr >> 8);
+    UART0->BDL = UART0_BDL_SBR(best_sbr);
+    UART0->C4 = UART0_C4_OSR(best_osr - 1);
+    // Sampling on both edges is required below 8 samples per bit
+    if (best_osr < 8) {
+        UART0->C5 |= UART0_C5_BOTHEDGE_MASK;
+    } else {
+        UART0->C5 &= ~UART0_C5_BOTHEDGE_MASK;
+    }
+
+    return SWO_UART_CLOCK / (best_osr * best_sbr);
+}
+
+void swo_uart_receive(uint8_t *buf, uint32_t count)
+{
+    SWO_DMA.DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+    SWO_DMA.DAR = (uint32_t)buf;
+    SWO_DMA.DSR_BCR = DMA_DSR_BCR_BCR(count);
+    rx_size = count;
+    SWO_DMA.DCR |= DMA_DCR_ERQ_MASK;
+
+    // Errors are reported once per receive
+    UART0->S1 = UART0_S1_ERRORS;
+    UART0->C3 |= UART0_C3_ORIE_MASK | UART0_C3_FEIE_MASK;
+    UART0->C2 |= UART0_C2_RE_MASK;
+}
+
+uint32_t swo_uart_abort(void)
+{
+    uint32_t count;
+
+    // Keep a completion that raced with the abort from being reported
+    NVIC_DisableIRQ(SWO_DMA_IRQn);
+    UART0->C2 &= ~UART0_C2_RE_MASK;
+    UART0->C3 &= ~(UART0_C3_ORIE_MASK | UART0_C3_FEIE_MASK);
+    SWO_DMA.DCR &= ~DMA_DCR_ERQ_MASK;
+    count = swo_uart_rx_count();
+    SWO_DMA.DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+    rx_size = 0;
+    NVIC_ClearPendingIRQ(SWO_DMA_IRQn);
+    NVIC_EnableIRQ(SWO_DMA_IRQn);
+
+    return count;
+}
+
+uint32_t swo_uart_rx_count(void)
+{
+    uint32_t size = rx_size;
+
+    if (size == 0) {
+        return 0;
+    }
+
+    return size - (SWO_DMA.DSR_BCR & DMA_DSR_BCR_BCR_MASK);
+}
+
+void SWO_DMA_IRQHandler(void)
+{
+    uint32_t status = SWO_DMA.DSR_BCR;
+    uint32_t count;
+
+    if (!(status & DMA_DSR_BCR_DONE_MASK)) {
+        return;
+    }
+
+    SWO_DMA.DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+    count = rx_size;
+    rx_size = 0;
+
+    if (status & (DMA_DSR_BCR_CE_MASK | DMA_DSR_BCR_BES_MASK | DMA_DSR_BCR_BED_MASK)) {
+        swo_uart_error(DAP_SWO_STREAM_ERROR);
+        count = 0;
+    }
+
+    // The receiver stays on so a byte arriving now is held in the data
+    // register until the next receive is started from this callback
+    swo_uart_receive_done(count);
+}
+
+void UART0_IRQHandler(void)
+{
+    uint8_t s1 = UART0->S1;
+    uint8_t flags = 0;
+
+    if (s1 & UART0_S1_OR_MASK) {
+        flags |= DAP_SWO_BUFFER_OVERRUN;
+    }
+
+    if (s1 & (UART0_S1_FE_MASK | UART0_S1_PF_MASK)) {
+        flags |= DAP_SWO_STREAM_ERROR;
+    }
+
+    UART0->S1 = s1 & UART0_S1_ERRORS;
+
+    // An overrun repeats for every byte while the trace buffer is full
+    UART0->C3 &= ~(UART0_C3_ORIE_MASK | UART0_C3_FEIE_MASK);
+
+    if (flags) {
+        swo_uart_error(flags);
+    }
+}
+
+#endif
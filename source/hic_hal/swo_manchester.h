@@ -0,0 +1,71 @@
+/**
+ * @file    swo_manchester.h
+ * @brief   SWO Manchester edge capture driver
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SWO_MANCHESTER_H
+#define SWO_MANCHESTER_H
+
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Used by SWO.c when SWO_MANCHESTER is set in DAP_config.h. The driver
+// only timestamps the edges on the SWO pin, SWO.c decodes them.
+
+// Power up the capture timer and its DMA channel. Returns 1 on success.
+extern uint32_t swo_manchester_initialize(void);
+extern void swo_manchester_uninitialize(void);
+
+// Get the frequency in Hz the edge timestamps count at. They are
+// 16 bits wide and wrap around, see swo_manchester_idle().
+extern uint32_t swo_manchester_clock(void);
+
+// Start or stop capturing edges. Starting drops the edges captured before.
+extern void swo_manchester_start(void);
+extern void swo_manchester_stop(void);
+
+// Get the edges captured and not yet released, in the order they
+// happened. Returns how many of them are contiguous at *edges.
+extern uint32_t swo_manchester_read(const uint16_t **edges);
+
+// Release count edges returned by swo_manchester_read()
+extern void swo_manchester_release(uint32_t count);
+
+// Return 1 if the line went at least half a timestamp wrap without an
+// edge before the next edge swo_manchester_read() returns, so the time
+// since the edge before it is unknown. swo_manchester_read() stops at
+// that point until this has been called.
+extern uint32_t swo_manchester_idle(void);
+
+// Return 1 if edges were lost because they were not read in time.
+// The flag is cleared.
+extern uint32_t swo_manchester_overrun(void);
+
+// Implemented by SWO.c, called from the driver's interrupt handlers
+// each time a block of edges has been captured or the line went idle
+extern void swo_manchester_event(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
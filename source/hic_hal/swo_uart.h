@@ -0,0 +1,60 @@
+/**
+ * @file    swo_uart.h
+ * @brief   Native SWO UART capture driver
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SWO_UART_H
+#define SWO_UART_H
+
+#include "stdint.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Used by SWO.c when SWO_UART_NATIVE is set in DAP_config.h, in place of
+// a CMSIS USART driver. Only receive is needed.
+
+// Power up the UART and its DMA channel. Returns 1 on success.
+extern uint32_t swo_uart_initialize(void);
+extern void swo_uart_uninitialize(void);
+
+// Set the baudrate, receive must be stopped. Returns the actual
+// baudrate or 0 if it can not be reached.
+extern uint32_t swo_uart_set_baudrate(uint32_t baudrate);
+
+// Start receiving count bytes into buf. swo_uart_receive_done() is
+// called from the interrupt handler once all of them have arrived.
+extern void swo_uart_receive(uint8_t *buf, uint32_t count);
+
+// Stop receiving. Returns the number of bytes received so far.
+extern uint32_t swo_uart_abort(void);
+
+// Get the number of bytes received so far
+extern uint32_t swo_uart_rx_count(void);
+
+// Implemented by SWO.c, called from the driver's interrupt handlers
+extern void swo_uart_receive_done(uint32_t count);
+extern void swo_uart_error(uint8_t flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
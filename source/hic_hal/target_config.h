@@ -44,6 +44,11 @@ extern "C" {
 #define MAX_EXTRA_FLASH_REGION                3
 #define MAX_EXTRA_RAM_REGION                  3
 
+//Value of an erased flash byte when a target does not specify one
+#define TARGET_FLASH_ERASED_DEFAULT           0xFF
+//Encode an erased flash value so that an unset (zero) field selects the default
+#define TARGET_FLASH_ERASED_VALUE(value)      (0x100 | ((value) & 0xFF))
+
 typedef struct region_info {
     uint32_t start;
     uint32_t end;
@@ -62,6 +67,7 @@ typedef struct target_cfg {
     uint32_t ram_end;               /*!< Highest contigous RAM address the application uses */
     program_target_t *flash_algo;   /*!< A pointer to the flash algorithm structure */
     uint8_t erase_reset;            /*!< Reset after performing an erase */
+    uint16_t erased_value;          /*!< Value of erased flash, set with TARGET_FLASH_ERASED_VALUE() (0xFF when unset) */
     const sector_info_t* sectors_info; 
     int sector_info_length;
     region_info_t extra_flash[MAX_EXTRA_FLASH_REGION + 1]; //!< Extra flash regions.
@@ -32,5 +32,6 @@ target_cfg_t target_device = {
     .flash_end          = 0x08030000,
     .ram_start          = 0x20000000,
     .ram_end            = 0x20005000,
-    .flash_algo         = (program_target_t *) &flash
+    .flash_algo         = (program_target_t *) &flash,
+    .erased_value       = TARGET_FLASH_ERASED_VALUE(0x00),
 };
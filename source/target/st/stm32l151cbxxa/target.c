@@ -33,4 +33,5 @@ target_cfg_t target_device = {
     .ram_start      = 0x20000000,
     .ram_end        = 0x20000000 + KB(32),
     .flash_algo     = (program_target_t *) &flash,
+    .erased_value   = TARGET_FLASH_ERASED_VALUE(0x00),
 };
@@ -0,0 +1,152 @@
+/**
+ * @file    usbd_bulk.c
+ * @brief   Vendor bulk class driver (CMSIS-DAP v2)
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "RTL.h"
+#include "rl_usb.h"
+#include "usb_for_lib.h"
+
+
+/*
+ *  USB Device Bulk Class user callbacks
+ */
+
+__weak void usbd_bulk_init(void)
+{
+
+}
+
+__weak void usbd_bulk_data_received(void)
+{
+
+}
+
+__weak void usbd_bulk_data_sent(void)
+{
+
+}
+
+__weak void usbd_bulk_swo_sent(void)
+{
+
+}
+
+
+/*
+ *  Read the packet waiting on the Bulk Out Endpoint
+ *    Parameters:      buf:  buffer for the data
+ *                     len:  size of the buffer
+ *    Return Value:    number of bytes read
+ *
+ *  The endpoint keeps NAKing the host until the packet has been read,
+ *  so usbd_bulk_data_received() may defer this call until there is
+ *  room for the data.
+ */
+
+U32 usbd_bulk_read(U8 *buf, U32 len)
+{
+    return USBD_ReadEP(usbd_bulk_ep_bulkout, buf, len);
+}
+
+
+/*
+ *  Start a transfer on the Bulk In Endpoint
+ *    Parameters:      buf:  data to send
+ *                     len:  number of bytes to send
+ *    Return Value:    number of bytes written
+ *
+ *  usbd_bulk_data_sent() is called once the host has taken the data.
+ */
+
+U32 usbd_bulk_write(U8 *buf, U32 len)
+{
+    return USBD_WriteEP(usbd_bulk_ep_bulkin | 0x80, buf, len);
+}
+
+
+/*
+ *  Start a transfer on the SWO Trace In Endpoint
+ *    Parameters:      buf:  data to send
+ *                     len:  number of bytes to send
+ *    Return Value:    number of bytes written
+ *
+ *  usbd_bulk_swo_sent() is called once the host has taken the data.
+ */
+
+U32 usbd_bulk_swo_write(U8 *buf, U32 len)
+{
+    return USBD_WriteEP(usbd_bulk_ep_swoin | 0x80, buf, len);
+}
+
+
+/*
+ *  USB Device Bulk In Endpoint Event Callback
+ *    Parameters:      event: not used (just for compatibility)
+ *    Return Value:    None
+ */
+
+void USBD_BULK_EP_BULKIN_Event(U32 event)
+{
+    usbd_bulk_data_sent();
+}
+
+
+/*
+ *  USB Device Bulk Out Endpoint Event Callback
+ *    Parameters:      event: not used (just for compatibility)
+ *    Return Value:    None
+ */
+
+void USBD_BULK_EP_BULKOUT_Event(U32 event)
+{
+    usbd_bulk_data_received();
+}
+
+
+/*
+ *  USB Device SWO Trace In Endpoint Event Callback
+ *    Parameters:      event: not used (just for compatibility)
+ *    Return Value:    None
+ */
+
+void USBD_BULK_EP_SWOIN_Event(U32 event)
+{
+    usbd_bulk_swo_sent();
+}
+
+
+/*
+ *  USB Device Bulk In/Out Endpoint Event Callback
+ *    Parameters:      event: USB Device Event
+ *                       USBD_EVT_OUT: Output Event
+ *                       USBD_EVT_IN:  Input Event
+ *    Return Value:    None
+ */
+
+void USBD_BULK_EP_BULK_Event(U32 event)
+{
+    if (event & USBD_EVT_OUT) {
+        USBD_BULK_EP_BULKOUT_Event(0);
+    }
+
+    if (event & USBD_EVT_IN) {
+        USBD_BULK_EP_BULKIN_Event(0);
+    }
+}
@@ -47,6 +47,7 @@ U32 Length;     /* R/W Length */
 
 U8 BulkStage;   /* Bulk Stage */
 U32 BulkLen;    /* Bulk In/Out Length */
+U8 *BulkData;   /* Bulk Out Data, in USBD_MSC_BlockBuf for writes */
 
 
 /* Dummy Weak Functions that need to be provided by user */
@@ -251,14 +252,17 @@ void USBD_MSC_MemoryWrite(void)
         BulkLen = 0;
     }
 
-    if (Offset + BulkLen > USBD_MSC_BlockSize) {
+    if (Offset + BulkLen > USBD_MSC_BlockGroup * USBD_MSC_BlockSize) {
         // This write would have overflowed USBD_MSC_BlockBuf
         util_assert(0);
         return;
     }
 
-    for (n = 0; n < BulkLen; n++) {
-        USBD_MSC_BlockBuf[Offset + n] = USBD_MSC_BulkBuf[n];
+    // The packet is normally received in place
+    if (BulkData != &USBD_MSC_BlockBuf[Offset]) {
+        for (n = 0; n < BulkLen; n++) {
+            USBD_MSC_BlockBuf[Offset + n] = BulkData[n];
+        }
     }
 
     Offset += BulkLen;
@@ -1139,7 +1143,17 @@ void USBD_MSC_EP_BULKIN_Event(U32 event)
 
 void USBD_MSC_EP_BULKOUT_Event(U32 event)
 {
-    BulkLen = USBD_ReadEP(usbd_msc_ep_bulkout, USBD_MSC_BulkBuf, USBD_MSC_BulkBufSize);
+    BulkData = USBD_MSC_BulkBuf;
+
+    // Receive write data straight into the block buffer when a whole
+    // packet fits there, so it is not copied
+    if ((BulkStage == MSC_BS_DATA_OUT) &&
+            ((USBD_MSC_CBW.CB[0] == SCSI_WRITE10) || (USBD_MSC_CBW.CB[0] == SCSI_WRITE12)) &&
+            (Offset + USBD_MSC_BulkBufSize <= USBD_MSC_BlockGroup * USBD_MSC_BlockSize)) {
+        BulkData = &USBD_MSC_BlockBuf[Offset];
+    }
+
+    BulkLen = USBD_ReadEP(usbd_msc_ep_bulkout, BulkData, USBD_MSC_BulkBufSize);
     USBD_MSC_BulkOut();
 }
 
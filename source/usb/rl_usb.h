@@ -51,6 +51,16 @@ extern void  usbd_msc_read_sect(U32 block, U8 *buf, U32 num_of_blocks);
 extern void  usbd_msc_write_sect(U32 block, U8 *buf, U32 num_of_blocks);
 extern void  usbd_msc_start_stop(BOOL start);
 
+/* USB Device user functions imported to USB Bulk Class module                */
+extern void  usbd_bulk_init(void);
+extern void  usbd_bulk_data_received(void);
+extern void  usbd_bulk_data_sent(void);
+extern void  usbd_bulk_swo_sent(void);
+/* USB Device Bulk class functions                                            */
+extern U32   usbd_bulk_read(U8 *buf, U32 len);
+extern U32   usbd_bulk_write(U8 *buf, U32 len);
+extern U32   usbd_bulk_swo_write(U8 *buf, U32 len);
+
 /* USB Device user functions imported to USB Audio Class module               */
 extern void  usbd_adc_init(void);
 
@@ -95,6 +95,22 @@ const U16 USBD_MSC_BulkBufSize = USBD_MSC_MAX_PACKET;
 U8 USBD_MSC_BulkBuf[USBD_MSC_MAX_PACKET];
 #endif
 
+#ifndef USBD_BULK_EP_SWOIN
+#define USBD_BULK_EP_SWOIN               0
+#endif
+
+#if    (USBD_BULK_ENABLE)
+const U8 usbd_bulk_ep_bulkin = USBD_BULK_EP_BULKIN;
+const U8 usbd_bulk_ep_bulkout = USBD_BULK_EP_BULKOUT;
+const U8 usbd_bulk_ep_swoin = USBD_BULK_EP_SWOIN;
+const U16 usbd_bulk_maxpacketsize[2] = {USBD_BULK_WMAXPACKETSIZE, USBD_BULK_HS_WMAXPACKETSIZE};
+#else
+const U8 usbd_bulk_ep_bulkin;
+const U8 usbd_bulk_ep_bulkout;
+const U8 usbd_bulk_ep_swoin;
+const U16 usbd_bulk_maxpacketsize[2];
+#endif
+
 #if    (USBD_ADC_ENABLE)
 const U8 usbd_adc_cif_num = USBD_ADC_CIF_NUM;
 const U8 usbd_adc_sif1_num = USBD_ADC_SIF1_NUM;
@@ -642,6 +658,143 @@ BOOL USBD_EndPoint0_Out_MSC_ReqToIF(void)
 }
 #endif  /* (USBD_MSC_ENABLE) */
 
+#if    (USBD_BULK_ENABLE)
+#ifdef __RTX
+#error "Bulk endpoints are not supported with RTX endpoint tasks"
+#else
+#if    (USBD_BULK_EP_BULKIN != USBD_BULK_EP_BULKOUT)
+#if    (USBD_BULK_EP_BULKIN == 1)
+#define USBD_EndPoint1                 USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 2)
+#define USBD_EndPoint2                 USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 3)
+#define USBD_EndPoint3                 USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 4)
+#define USBD_EndPoint4                 USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 5)
+#define USBD_EndPoint5                 USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 6)
+#define USBD_EndPoint6                 USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 7)
+#define USBD_EndPoint7                 USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 8)
+#define USBD_EndPoint8                 USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 9)
+#define USBD_EndPoint9                 USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 10)
+#define USBD_EndPoint10                USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 11)
+#define USBD_EndPoint11                USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 12)
+#define USBD_EndPoint12                USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 13)
+#define USBD_EndPoint13                USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 14)
+#define USBD_EndPoint14                USBD_BULK_EP_BULKIN_Event
+#elif  (USBD_BULK_EP_BULKIN == 15)
+#define USBD_EndPoint15                USBD_BULK_EP_BULKIN_Event
+#endif
+
+#if    (USBD_BULK_EP_BULKOUT == 1)
+#define USBD_EndPoint1                 USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 2)
+#define USBD_EndPoint2                 USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 3)
+#define USBD_EndPoint3                 USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 4)
+#define USBD_EndPoint4                 USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 5)
+#define USBD_EndPoint5                 USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 6)
+#define USBD_EndPoint6                 USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 7)
+#define USBD_EndPoint7                 USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 8)
+#define USBD_EndPoint8                 USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 9)
+#define USBD_EndPoint9                 USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 10)
+#define USBD_EndPoint10                USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 11)
+#define USBD_EndPoint11                USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 12)
+#define USBD_EndPoint12                USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 13)
+#define USBD_EndPoint13                USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 14)
+#define USBD_EndPoint14                USBD_BULK_EP_BULKOUT_Event
+#elif  (USBD_BULK_EP_BULKOUT == 15)
+#define USBD_EndPoint15                USBD_BULK_EP_BULKOUT_Event
+#endif
+#else
+#if    (USBD_BULK_EP_BULKIN == 1)
+#define USBD_EndPoint1                 USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 2)
+#define USBD_EndPoint2                 USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 3)
+#define USBD_EndPoint3                 USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 4)
+#define USBD_EndPoint4                 USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 5)
+#define USBD_EndPoint5                 USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 6)
+#define USBD_EndPoint6                 USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 7)
+#define USBD_EndPoint7                 USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 8)
+#define USBD_EndPoint8                 USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 9)
+#define USBD_EndPoint9                 USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 10)
+#define USBD_EndPoint10                USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 11)
+#define USBD_EndPoint11                USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 12)
+#define USBD_EndPoint12                USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 13)
+#define USBD_EndPoint13                USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 14)
+#define USBD_EndPoint14                USBD_BULK_EP_BULK_Event
+#elif  (USBD_BULK_EP_BULKIN == 15)
+#define USBD_EndPoint15                USBD_BULK_EP_BULK_Event
+#endif
+#endif
+#if    (USBD_BULK_EP_SWOIN != 0)
+#if    (USBD_BULK_EP_SWOIN == 1)
+#define USBD_EndPoint1                 USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 2)
+#define USBD_EndPoint2                 USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 3)
+#define USBD_EndPoint3                 USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 4)
+#define USBD_EndPoint4                 USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 5)
+#define USBD_EndPoint5                 USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 6)
+#define USBD_EndPoint6                 USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 7)
+#define USBD_EndPoint7                 USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 8)
+#define USBD_EndPoint8                 USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 9)
+#define USBD_EndPoint9                 USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 10)
+#define USBD_EndPoint10                USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 11)
+#define USBD_EndPoint11                USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 12)
+#define USBD_EndPoint12                USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 13)
+#define USBD_EndPoint13                USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 14)
+#define USBD_EndPoint14                USBD_BULK_EP_SWOIN_Event
+#elif  (USBD_BULK_EP_SWOIN == 15)
+#define USBD_EndPoint15                USBD_BULK_EP_SWOIN_Event
+#endif
+#endif
+#endif
+#endif  /* (USBD_BULK_ENABLE) */
+
 #if    (USBD_ADC_ENABLE == 0)
 BOOL USBD_EndPoint0_Setup_ADC_ReqToIF(void)
 {
@@ -1270,6 +1423,9 @@ void usbd_class_init(void)
 #if (USBD_MSC_ENABLE)
     usbd_msc_init();
 #endif
+#if (USBD_BULK_ENABLE)
+    usbd_bulk_init();
+#endif
 #if (USBD_ADC_ENABLE)
     usbd_adc_init();
 #endif
@@ -1513,6 +1669,7 @@ void USBD_RTX_TaskInit(void)
                                            CDC_ABSTRACT_CONTROL_MANAGEMENT_SIZE + CDC_UNION_SIZE + USB_ENDPOINT_DESC_SIZE                       + \
                                            /* CDC Interface 2 */                                                                                  \
                                            USB_INTERFACE_DESC_SIZE + USB_ENDPOINT_DESC_SIZE + USB_ENDPOINT_DESC_SIZE)
+#define USBD_BULK_DESC_LEN                (USB_INTERFACE_DESC_SIZE + (2 + (USBD_BULK_EP_SWOIN != 0)) * USB_ENDPOINT_DESC_SIZE)
 #define USBD_HID_DESC_LEN                 (USB_INTERFACE_DESC_SIZE + USB_HID_DESC_SIZE                                                          + \
                                           (USB_ENDPOINT_DESC_SIZE*(1+(USBD_HID_EP_INTOUT != 0))))
 #define USBD_HID_DESC_OFS                 (USB_CONFIGUARTION_DESC_SIZE + USB_INTERFACE_DESC_SIZE                                                + \
@@ -1522,6 +1679,7 @@ void USBD_RTX_TaskInit(void)
                                            USBD_CDC_ACM_DESC_LEN * USBD_CDC_ACM_ENABLE + \
                                            USBD_HID_DESC_LEN     * USBD_HID_ENABLE     + \
                                            (USB_INTERFACE_DESC_SIZE) * USBD_WEBUSB_ENABLE + \
+                                           USBD_BULK_DESC_LEN    * USBD_BULK_ENABLE    + \
                                            USBD_MSC_DESC_LEN     * USBD_MSC_ENABLE)
 
 /*------------------------------------------------------------------------------
@@ -1660,9 +1818,9 @@ const U8 USBD_DeviceQualifier_HS[] = { 0 };
 
 #if (USBD_WINUSB_ENABLE)
 
-#define USBD_WINUSB_DESC_SET_LEN           170
 #define FUNCTION_SUBSET_LEN                160
 #define DEVICE_INTERFACE_GUIDS_FEATURE_LEN 132
+#define USBD_WINUSB_DESC_SET_LEN           (WINUSB_DESCRIPTOR_SET_HEADER_SIZE + FUNCTION_SUBSET_LEN * (1 + USBD_BULK_ENABLE))
 
 const U8 USBD_WinUSBDescriptorSetDescriptor[] = {
     WBVAL(WINUSB_DESCRIPTOR_SET_HEADER_SIZE), /* wLength */
@@ -1692,7 +1850,34 @@ const U8 USBD_WinUSBDescriptorSetDescriptor[] = {
     '4',0,'6',0,'F',0,'E',0,'-',0,
     '9',0,'3',0,'3',0,'B',0,'-',
     0,'3',0,'1',0,'C',0,'B',0,'9',0,'C',0,'5',0,'A',0,'A',0,'3',0,'B',0,'9',0,
+    '}',0,0,0,0,0,
+#if (USBD_BULK_ENABLE)
+    /* CMSIS-DAP v2 bulk interface */
+    WBVAL(WINUSB_FUNCTION_SUBSET_HEADER_SIZE),/* wLength */
+    WBVAL(WINUSB_SUBSET_HEADER_FUNCTION_TYPE),/* wDescriptorType */
+    USBD_BULK_IF_NUM,                         /* bFirstInterface */
+    0,                                        /* bReserved */
+    WBVAL(FUNCTION_SUBSET_LEN),               /* wSubsetLength */
+    WBVAL(WINUSB_FEATURE_COMPATIBLE_ID_SIZE), /* wLength */
+    WBVAL(WINUSB_FEATURE_COMPATIBLE_ID_TYPE), /* wDescriptorType */
+    'W', 'I', 'N', 'U', 'S', 'B', 0, 0,       /* CompatibleId*/
+    0, 0, 0, 0, 0, 0, 0, 0,                   /* SubCompatibleId*/
+    WBVAL(DEVICE_INTERFACE_GUIDS_FEATURE_LEN),/* wLength */
+    WBVAL(WINUSB_FEATURE_REG_PROPERTY_TYPE),  /* wDescriptorType */
+    WBVAL(WINUSB_PROP_DATA_TYPE_REG_MULTI_SZ), /* wPropertyDataType */
+    WBVAL(42), /* wPropertyNameLength */
+    'D',0,'e',0,'v',0,'i',0,'c',0,'e',0,
+    'I',0,'n',0,'t',0,'e',0,'r',0,'f',0,'a',0,'c',0,'e',0,
+    'G',0,'U',0,'I',0,'D',0,'s',0,0,0,
+    WBVAL(80), /* wPropertyDataLength */
+    '{',0,
+    'C',0,'D',0,'B',0,'3',0,'B',0,'5',0,'A',0,'D',0,'-',0,
+    '2',0,'9',0,'3',0,'B',0,'-',0,
+    '4',0,'6',0,'6',0,'3',0,'-',0,
+    'A',0,'A',0,'3',0,'6',0,'-',0,
+    '1',0,'A',0,'A',0,'E',0,'4',0,'6',0,'4',0,'6',0,'3',0,'7',0,'7',0,'6',0,
     '}',0,0,0,0,0
+#endif
 };
 
 #else
@@ -1873,6 +2058,70 @@ const U8 USBD_BinaryObjectStoreDescriptor[] = { 0 };
   WBVAL(USBD_MSC_WMAXPACKETSIZE),       /* wMaxPacketSize */                                                \
   0x00,                                 /* bInterval: ignore for Bulk transfer */
 
+#define BULK_DESC                                                                                           \
+/* Interface, Alternate Setting 0, VENDOR_SPECIFIC Class */                                                 \
+  USB_INTERFACE_DESC_SIZE,              /* bLength */                                                       \
+  USB_INTERFACE_DESCRIPTOR_TYPE,        /* bDescriptorType */                                               \
+  USBD_BULK_IF_NUM,                     /* bInterfaceNumber */                                              \
+  0x00,                                 /* bAlternateSetting */                                             \
+  0x02 + (USBD_BULK_EP_SWOIN != 0),     /* bNumEndpoints */                                                 \
+  USB_DEVICE_CLASS_VENDOR_SPECIFIC,     /* bInterfaceClass */                                               \
+  0x00,                                 /* bInterfaceSubClass */                                            \
+  0x00,                                 /* bInterfaceProtocol */                                            \
+  USBD_BULK_IF_STR_NUM,                 /* iInterface */                                                    \
+
+#define BULK_EP                         /* CMSIS-DAP v2 Endpoints for Low-speed/Full-speed */               \
+/* Endpoint, EP Bulk OUT */                                                                                 \
+  USB_ENDPOINT_DESC_SIZE,               /* bLength */                                                       \
+  USB_ENDPOINT_DESCRIPTOR_TYPE,         /* bDescriptorType */                                               \
+  USB_ENDPOINT_OUT(USBD_BULK_EP_BULKOUT),/* bEndpointAddress */                                             \
+  USB_ENDPOINT_TYPE_BULK,               /* bmAttributes */                                                  \
+  WBVAL(USBD_BULK_WMAXPACKETSIZE),      /* wMaxPacketSize */                                                \
+  0x00,                                 /* bInterval: ignore for Bulk transfer */                           \
+                                                                                                            \
+/* Endpoint, EP Bulk IN */                                                                                  \
+  USB_ENDPOINT_DESC_SIZE,               /* bLength */                                                       \
+  USB_ENDPOINT_DESCRIPTOR_TYPE,         /* bDescriptorType */                                               \
+  USB_ENDPOINT_IN(USBD_BULK_EP_BULKIN), /* bEndpointAddress */                                              \
+  USB_ENDPOINT_TYPE_BULK,               /* bmAttributes */                                                  \
+  WBVAL(USBD_BULK_WMAXPACKETSIZE),      /* wMaxPacketSize */                                                \
+  0x00,                                 /* bInterval: ignore for Bulk transfer */
+
+#define BULK_SWO_EP                     /* CMSIS-DAP v2 SWO Trace Endpoint for Low-speed/Full-speed */      \
+/* Endpoint, EP Bulk IN */                                                                                  \
+  USB_ENDPOINT_DESC_SIZE,               /* bLength */                                                       \
+  USB_ENDPOINT_DESCRIPTOR_TYPE,         /* bDescriptorType */                                               \
+  USB_ENDPOINT_IN(USBD_BULK_EP_SWOIN),  /* bEndpointAddress */                                              \
+  USB_ENDPOINT_TYPE_BULK,               /* bmAttributes */                                                  \
+  WBVAL(USBD_BULK_WMAXPACKETSIZE),      /* wMaxPacketSize */                                                \
+  0x00,                                 /* bInterval: ignore for Bulk transfer */
+
+#define BULK_EP_HS                      /* CMSIS-DAP v2 Endpoints for High-speed */                         \
+/* Endpoint, EP Bulk OUT */                                                                                 \
+  USB_ENDPOINT_DESC_SIZE,               /* bLength */                                                       \
+  USB_ENDPOINT_DESCRIPTOR_TYPE,         /* bDescriptorType */                                               \
+  USB_ENDPOINT_OUT(USBD_BULK_EP_BULKOUT),/* bEndpointAddress */                                             \
+  USB_ENDPOINT_TYPE_BULK,               /* bmAttributes */                                                  \
+  WBVAL(USBD_BULK_HS_WMAXPACKETSIZE),   /* wMaxPacketSize */                                                \
+  0x00,                                 /* bInterval */                                                     \
+                                                                                                            \
+/* Endpoint, EP Bulk IN */                                                                                  \
+  USB_ENDPOINT_DESC_SIZE,               /* bLength */                                                       \
+  USB_ENDPOINT_DESCRIPTOR_TYPE,         /* bDescriptorType */                                               \
+  USB_ENDPOINT_IN(USBD_BULK_EP_BULKIN), /* bEndpointAddress */                                              \
+  USB_ENDPOINT_TYPE_BULK,               /* bmAttributes */                                                  \
+  WBVAL(USBD_BULK_HS_WMAXPACKETSIZE),   /* wMaxPacketSize */                                                \
+  0x00,                                 /* bInterval */
+
+#define BULK_SWO_EP_HS                  /* CMSIS-DAP v2 SWO Trace Endpoint for High-speed */                \
+/* Endpoint, EP Bulk IN */                                                                                  \
+  USB_ENDPOINT_DESC_SIZE,               /* bLength */                                                       \
+  USB_ENDPOINT_DESCRIPTOR_TYPE,         /* bDescriptorType */                                               \
+  USB_ENDPOINT_IN(USBD_BULK_EP_SWOIN),  /* bEndpointAddress */                                              \
+  USB_ENDPOINT_TYPE_BULK,               /* bmAttributes */                                                  \
+  WBVAL(USBD_BULK_HS_WMAXPACKETSIZE),   /* wMaxPacketSize */                                                \
+  0x00,                                 /* bInterval */
+
 #define MSC_EP_HS                       /* MSC Endpoints for High-speed */                                  \
 /* Endpoint, EP Bulk IN */                                                                                  \
   USB_ENDPOINT_DESC_SIZE,               /* bLength */                                                       \
@@ -2198,6 +2447,14 @@ const U8 USBD_ConfigDescriptor[] = {
     WEBUSB_DESC
 #endif
 
+#if (USBD_BULK_ENABLE)
+    BULK_DESC
+    BULK_EP
+#if (USBD_BULK_EP_SWOIN != 0)
+    BULK_SWO_EP
+#endif
+#endif
+
     /* Terminator */                                                                                            \
     0                                     /* bLength */                                                       \
 };
@@ -2262,6 +2519,14 @@ const U8 USBD_ConfigDescriptor_HS[] = {
     WEBUSB_DESC
 #endif
 
+#if (USBD_BULK_ENABLE)
+    BULK_DESC
+    BULK_EP_HS
+#if (USBD_BULK_EP_SWOIN != 0)
+    BULK_SWO_EP_HS
+#endif
+#endif
+
     /* Terminator */                                                                                            \
     0                                     /* bLength */                                                       \
 };
@@ -2312,6 +2577,14 @@ const U8 USBD_OtherSpeedConfigDescriptor[] = {
     WEBUSB_DESC
 #endif
 
+#if (USBD_BULK_ENABLE)
+    BULK_DESC
+    BULK_EP_HS
+#if (USBD_BULK_EP_SWOIN != 0)
+    BULK_SWO_EP_HS
+#endif
+#endif
+
 #if (USBD_MSC_ENABLE)
     MSC_DESC
     MSC_EP_HS
@@ -2367,6 +2640,14 @@ const U8 USBD_OtherSpeedConfigDescriptor_HS[] = {
     WEBUSB_DESC
 #endif
 
+#if (USBD_BULK_ENABLE)
+    BULK_DESC
+    BULK_EP
+#if (USBD_BULK_EP_SWOIN != 0)
+    BULK_SWO_EP
+#endif
+#endif
+
 #if (USBD_MSC_ENABLE)
     MSC_DESC
     MSC_EP
@@ -2415,6 +2696,9 @@ const struct {
 #if (USBD_WEBUSB_ENABLE)
     USBD_STR_DEF(WEBUSB_STRDESC);
 #endif
+#if (USBD_BULK_ENABLE)
+    USBD_STR_DEF(BULK_STRDESC);
+#endif
 #if (USBD_MSC_ENABLE)
     USBD_STR_DEF(MSC_STRDESC);
 #endif
@@ -2441,6 +2725,9 @@ const struct {
 #if (USBD_WEBUSB_ENABLE)
     USBD_STR_VAL(WEBUSB_STRDESC),
 #endif
+#if (USBD_BULK_ENABLE)
+    USBD_STR_VAL(BULK_STRDESC),
+#endif
 #if (USBD_MSC_ENABLE)
     USBD_STR_VAL(MSC_STRDESC),
 #endif
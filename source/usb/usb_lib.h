@@ -68,6 +68,11 @@ extern const U8 *usbd_msc_inquiry_data;
 extern const U16 USBD_MSC_BulkBufSize;
 extern       U8 USBD_MSC_BulkBuf[];
 
+extern const U8 usbd_bulk_ep_bulkin;
+extern const U8 usbd_bulk_ep_bulkout;
+extern const U8 usbd_bulk_ep_swoin;
+extern const U16 usbd_bulk_maxpacketsize[2];
+
 extern const U8 usbd_adc_enable;
 extern const U8 usbd_adc_cif_num;
 extern const U8 usbd_adc_sif1_num;
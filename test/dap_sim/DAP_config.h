@@ -0,0 +1,186 @@
+/**
+ * @file    DAP_config.h
+ * @brief   CMSIS-DAP configuration for the host simulator
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __DAP_CONFIG_H__
+#define __DAP_CONFIG_H__
+
+#include "sim_swd.h"
+
+// The clock settings match the KL26Z HIC so the cycle figures reported
+// by the benchmark are those of a real debug unit.
+#define CPU_CLOCK               48000000        ///< Specifies the CPU Clock in Hz
+#define IO_PORT_WRITE_CYCLES    1               ///< I/O Cycles: 2=default, 1=Cortex-M0+ fast I/0
+#define DAP_SWD                 1               ///< SWD Mode:  1 = available, 0 = not available
+#define DAP_JTAG                1               ///< JTAG Mode: 1 = available, 0 = not available.
+#define DAP_JTAG_DEV_CNT        8               ///< Maximum number of JTAG devices on scan chain
+#define DAP_DEFAULT_PORT        1               ///< Default JTAG/SWJ Port Mode: 1 = SWD, 2 = JTAG.
+#define DAP_DEFAULT_SWJ_CLOCK   5000000         ///< Default SWD/JTAG clock frequency in Hz.
+#define DAP_PACKET_SIZE         64              ///< USB: 64 = Full-Speed, 1024 = High-Speed.
+#define DAP_PACKET_COUNT        5               ///< Buffers: 64 = Full-Speed, 4 = High-Speed.
+#define SWO_UART                0               ///< SWO UART:  1 = available, 0 = not available
+#define SWO_UART_MAX_BAUDRATE   10000000U       ///< SWO UART Maximum Baudrate in Hz
+#define SWO_MANCHESTER          0               ///< SWO Manchester:  1 = available, 0 = not available
+#define SWO_BUFFER_SIZE         4096U           ///< SWO Trace Buffer Size in bytes (must be 2^n)
+#define SWO_STREAM              0               ///< SWO Streaming Trace: 1 = available, 0 = not available
+#define TARGET_DEVICE_FIXED     0               ///< Target Device: 1 = known, 0 = unknown;
+#define TARGET_DEVICE_VENDOR    ""              ///< String indicating the Silicon Vendor
+#define TARGET_DEVICE_NAME      ""              ///< String indicating the Target Device
+
+// DAP.c times pin waits with SysTick, which never expires here since
+// the simulated pins settle immediately
+typedef struct {
+    uint32_t CTRL;
+    uint32_t LOAD;
+    uint32_t VAL;
+} SysTick_Type;
+
+extern SysTick_Type sim_systick;
+
+#define SysTick                         (&sim_systick)
+#define SysTick_CTRL_ENABLE_Pos         0U
+#define SysTick_CTRL_CLKSOURCE_Pos      2U
+#define SysTick_CTRL_COUNTFLAG_Msk      (1UL << 16U)
+
+static __inline void PORT_JTAG_SETUP(void)
+{
+    sim_swdio_output(1);
+}
+
+static __inline void PORT_SWD_SETUP(void)
+{
+    sim_swclk_write(1);
+    sim_swdio_write(1);
+    sim_swdio_output(1);
+    sim_nreset_write(1);
+}
+
+static __inline void PORT_OFF(void)
+{
+    sim_swdio_output(0);
+}
+
+static __forceinline uint32_t PIN_SWCLK_TCK_IN(void)
+{
+    return sim_swclk_read();
+}
+
+static __forceinline void     PIN_SWCLK_TCK_SET(void)
+{
+    sim_swclk_write(1);
+}
+
+static __forceinline void     PIN_SWCLK_TCK_CLR(void)
+{
+    sim_swclk_write(0);
+}
+
+static __forceinline uint32_t PIN_SWDIO_TMS_IN(void)
+{
+    return sim_swdio_read();
+}
+
+static __forceinline void     PIN_SWDIO_TMS_SET(void)
+{
+    sim_swdio_write(1);
+}
+
+static __forceinline void     PIN_SWDIO_TMS_CLR(void)
+{
+    sim_swdio_write(0);
+}
+
+static __forceinline uint32_t PIN_SWDIO_IN(void)
+{
+    return sim_swdio_read();
+}
+
+static __forceinline void     PIN_SWDIO_OUT(uint32_t bit)
+{
+    sim_swdio_write(bit);
+}
+
+static __forceinline void     PIN_SWDIO_OUT_ENABLE(void)
+{
+    sim_swdio_output(1);
+}
+
+static __forceinline void     PIN_SWDIO_OUT_DISABLE(void)
+{
+    sim_swdio_output(0);
+}
+
+// JTAG is compiled but no TAP is modelled, TDO reads as high
+static __forceinline uint32_t PIN_TDI_IN(void)
+{
+    return (0);
+}
+
+static __forceinline void     PIN_TDI_OUT(uint32_t bit)
+{
+    ;
+}
+
+static __forceinline uint32_t PIN_TDO_IN(void)
+{
+    return (1);
+}
+
+static __forceinline uint32_t PIN_nTRST_IN(void)
+{
+    return (1);
+}
+
+static __forceinline void     PIN_nTRST_OUT(uint32_t bit)
+{
+    ;
+}
+
+static __forceinline uint32_t PIN_nRESET_IN(void)
+{
+    return sim_nreset_read();
+}
+
+static __forceinline void     PIN_nRESET_OUT(uint32_t bit)
+{
+    sim_nreset_write(bit);
+}
+
+static __inline void LED_CONNECTED_OUT(uint32_t bit)
+{
+    ;
+}
+
+static __inline void LED_RUNNING_OUT(uint32_t bit)
+{
+    ;
+}
+
+static __inline void DAP_SETUP(void)
+{
+    sim_reset();
+}
+
+static __inline uint32_t RESET_TARGET(void)
+{
+    return (0);
+}
+
+#endif /* __DAP_CONFIG_H__ */
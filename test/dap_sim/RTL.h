@@ -0,0 +1,59 @@
+/**
+ * @file    RTL.h
+ * @brief   RTX calls used by the simulated sources
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef RTL_H
+#define RTL_H
+
+#include <stdint.h>
+
+typedef uint8_t  U8;
+typedef uint16_t U16;
+typedef uint32_t U32;
+typedef U32 OS_MUT[3];
+
+#define OS_R_OK         0x00
+
+// Delays take no simulated time
+static inline void os_dly_wait(U16 delay_time)
+{
+    (void)delay_time;
+}
+
+// Single threaded, so mutexes never block
+static inline void os_mut_init(OS_MUT *mutex)
+{
+    (void)mutex;
+}
+
+static inline U8 os_mut_wait(OS_MUT *mutex, U16 timeout)
+{
+    (void)mutex;
+    (void)timeout;
+    return 0;
+}
+
+static inline U8 os_mut_release(OS_MUT *mutex)
+{
+    (void)mutex;
+    return 0;
+}
+
+#endif
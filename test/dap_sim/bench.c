@@ -0,0 +1,498 @@
+/**
+ * @file    bench.c
+ * @brief   Run CMSIS-DAP commands against the simulated SW-DP and report cost
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Usage: dap_bench [-c swclk_hz] [-w wait_every] [trace_file]
+//
+// Without a trace file a set of built in workloads is run and every one
+// of them checks the data that ends up in (or comes out of) the model.
+// A trace file replays recorded commands, one packet per line:
+//
+//   > 05 00 01 02          request bytes in hex
+//   < 05 01 01             expected leading response bytes, optional
+//
+// Lines starting with # are comments. The exit status is non-zero if
+// any check or expected response fails.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "DAP_config.h"
+#include "DAP.h"
+#include "debug_cm.h"
+#include "swd_host.h"
+#include "target_config.h"
+#include "settings.h"
+#include "sim_swd.h"
+
+#define BENCH_SIZE          4096
+#define BENCH_ADDR          (SIM_RAM_START + 0x100)
+#define TAR_WRAP            0x400
+#define CSW_WORD            (CSW_RESERVED | CSW_MSTRDBG | CSW_HPROT | CSW_DBGSTAT | CSW_SADDRINC | CSW_SIZE32)
+
+// Transfer Block: ID, count and ack in the response, ID, index, count
+// and request in the request
+#define BLOCK_READ_WORDS    ((DAP_PACKET_SIZE - 4) / 4)
+#define BLOCK_WRITE_WORDS   ((DAP_PACKET_SIZE - 5) / 4)
+
+SysTick_Type sim_systick;
+
+typedef struct {
+    uint32_t packets;
+    uint64_t host_ns;
+} bench_t;
+
+static uint8_t request[DAP_PACKET_SIZE];
+static uint8_t response[DAP_PACKET_SIZE];
+static uint32_t swj_clock = 10000000;
+static uint32_t failures;
+
+// Flash algorithms load at the start of RAM, clear of BENCH_ADDR
+target_cfg_t target_device = {
+    .ram_start = SIM_RAM_START,
+    .ram_end = SIM_RAM_START + SIM_RAM_SIZE,
+};
+
+// Settings kept in RAM, counting how often the clock is saved
+static uint32_t saved_idcode;
+static uint32_t saved_clock;
+static uint32_t saved_count;
+
+void config_set_swd_clock(uint32_t idcode, uint32_t clock)
+{
+    saved_idcode = idcode;
+    saved_clock = clock;
+    saved_count++;
+}
+
+uint32_t config_get_swd_clock(uint32_t idcode)
+{
+    return (idcode == saved_idcode) ? saved_clock : 0;
+}
+
+void target_before_init_debug(void)
+{
+}
+
+uint8_t target_unlock_sequence(void)
+{
+    return 1;
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint32_t dap(bench_t *bench, uint32_t len)
+{
+    uint64_t start;
+    uint32_t num;
+
+    memset(&request[len], 0, sizeof(request) - len);
+    start = now_ns();
+    num = DAP_ExecuteCommand(request, response);
+    if (bench) {
+        bench->host_ns += now_ns() - start;
+        bench->packets++;
+    }
+    return num & 0xFFFF;
+}
+
+static void put32(uint8_t *buf, uint32_t value)
+{
+    buf[0] = (uint8_t)(value >> 0);
+    buf[1] = (uint8_t)(value >> 8);
+    buf[2] = (uint8_t)(value >> 16);
+    buf[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t get32(const uint8_t *buf)
+{
+    return ((uint32_t)buf[0] << 0) | ((uint32_t)buf[1] << 8) |
+           ((uint32_t)buf[2] << 16) | ((uint32_t)buf[3] << 24);
+}
+
+static void check(int ok, const char *what)
+{
+    if (!ok) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// Single DAP_Transfer of one register
+static uint32_t transfer(bench_t *bench, uint8_t req, uint32_t *data)
+{
+    request[0] = ID_DAP_Transfer;
+    request[1] = 0;
+    request[2] = 1;
+    request[3] = req;
+    put32(&request[4], data ? *data : 0);
+    dap(bench, (req & DAP_TRANSFER_RnW) ? 4 : 8);
+    if ((req & DAP_TRANSFER_RnW) && data) {
+        *data = get32(&response[3]);
+    }
+    return response[2];
+}
+
+static void connect(void)
+{
+    static const uint8_t swj_switch[] = {
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x9E, 0xE7,
+        0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00,
+    };
+    uint32_t data;
+
+    DAP_Setup();
+
+    request[0] = ID_DAP_Connect;
+    request[1] = DAP_PORT_SWD;
+    dap(NULL, 2);
+
+    request[0] = ID_DAP_SWJ_Clock;
+    put32(&request[1], swj_clock);
+    dap(NULL, 5);
+
+    request[0] = ID_DAP_TransferConfigure;
+    request[1] = 0;
+    request[2] = 100;
+    request[3] = 0;
+    request[4] = 0;
+    request[5] = 0;
+    dap(NULL, 6);
+
+    request[0] = ID_DAP_SWJ_Sequence;
+    request[1] = 8 * sizeof(swj_switch);
+    memcpy(&request[2], swj_switch, sizeof(swj_switch));
+    dap(NULL, 2 + sizeof(swj_switch));
+
+    check((transfer(NULL, DP_IDCODE | DAP_TRANSFER_RnW, &data) == DAP_TRANSFER_OK) &&
+          (data == SIM_IDCODE), "read IDCODE");
+    data = 0x1E;
+    transfer(NULL, DP_ABORT, &data);
+    data = 0x50000000;
+    transfer(NULL, DP_CTRL_STAT, &data);
+    data = 0;
+    transfer(NULL, DP_SELECT, &data);
+    data = CSW_WORD;
+    check(transfer(NULL, DAP_TRANSFER_APnDP | AP_CSW, &data) == DAP_TRANSFER_OK, "write CSW");
+}
+
+static void fill_pattern(uint8_t *buf, uint32_t size, uint32_t seed)
+{
+    uint32_t i;
+
+    for (i = 0; i < size; i++) {
+        buf[i] = (uint8_t)((i * 7) ^ (i >> 8) ^ seed);
+    }
+}
+
+// Read the way debuggers do: TAR before each packet, split at the
+// auto increment block
+static void block_read(bench_t *bench, uint32_t addr, uint8_t *data, uint32_t size)
+{
+    uint32_t n;
+    uint32_t words;
+
+    while (size) {
+        words = (TAR_WRAP - (addr & (TAR_WRAP - 1))) / 4;
+        words = (words < BLOCK_READ_WORDS) ? words : BLOCK_READ_WORDS;
+        words = (words < size / 4) ? words : size / 4;
+        check(transfer(bench, DAP_TRANSFER_APnDP | AP_TAR, &addr) == DAP_TRANSFER_OK, "write TAR");
+        request[0] = ID_DAP_TransferBlock;
+        request[1] = 0;
+        request[2] = (uint8_t)words;
+        request[3] = 0;
+        request[4] = DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | AP_DRW;
+        dap(bench, 5);
+        n = response[1] | (response[2] << 8);
+        check((n == words) && (response[3] == DAP_TRANSFER_OK), "transfer block read");
+        memcpy(data, &response[4], words * 4);
+        addr += words * 4;
+        data += words * 4;
+        size -= words * 4;
+    }
+}
+
+static void block_write(bench_t *bench, uint32_t addr, const uint8_t *data, uint32_t size)
+{
+    uint32_t n;
+    uint32_t words;
+
+    while (size) {
+        words = (TAR_WRAP - (addr & (TAR_WRAP - 1))) / 4;
+        words = (words < BLOCK_WRITE_WORDS) ? words : BLOCK_WRITE_WORDS;
+        words = (words < size / 4) ? words : size / 4;
+        check(transfer(bench, DAP_TRANSFER_APnDP | AP_TAR, &addr) == DAP_TRANSFER_OK, "write TAR");
+        request[0] = ID_DAP_TransferBlock;
+        request[1] = 0;
+        request[2] = (uint8_t)words;
+        request[3] = 0;
+        request[4] = DAP_TRANSFER_APnDP | AP_DRW;
+        memcpy(&request[5], data, words * 4);
+        dap(bench, 5 + words * 4);
+        n = response[1] | (response[2] << 8);
+        check((n == words) && (response[3] == DAP_TRANSFER_OK), "transfer block write");
+        addr += words * 4;
+        data += words * 4;
+        size -= words * 4;
+    }
+}
+
+// One DAP_Transfer packet of single word reads, each with its own TAR
+static void scattered_read(bench_t *bench, uint32_t count)
+{
+    uint32_t i;
+    uint32_t n;
+    uint32_t slots = (DAP_PACKET_SIZE - 3) / 9;
+    uint8_t *req;
+
+    while (count) {
+        n = (count < slots) ? count : slots;
+        req = &request[3];
+        for (i = 0; i < n; i++) {
+            *req++ = DAP_TRANSFER_APnDP | AP_TAR;
+            put32(req, BENCH_ADDR + ((count - i) * 36) % BENCH_SIZE);
+            req += 4;
+            *req++ = DAP_TRANSFER_APnDP | DAP_TRANSFER_RnW | AP_DRW;
+        }
+        request[0] = ID_DAP_Transfer;
+        request[1] = 0;
+        request[2] = (uint8_t)(2 * n);
+        dap(bench, req - request);
+        check((response[1] == 2 * n) && (response[2] == DAP_TRANSFER_OK), "scattered read");
+        count -= n;
+    }
+}
+
+static void report(const char *name, bench_t *bench, uint32_t bytes)
+{
+    double transfers = sim_stats.transfers ? sim_stats.transfers : 1;
+    double wire_us = (double)sim_stats.swclk_cycles * 1000000.0 / swj_clock;
+
+    printf("%-26s %6u %8u %10llu %7.1f %9.1f %8.1f %8.2f\n", name,
+           bench->packets, sim_stats.transfers,
+           (unsigned long long)sim_stats.swclk_cycles,
+           sim_stats.swclk_cycles / transfers,
+           wire_us,
+           bench->host_ns / transfers,
+           bytes ? (bytes / wire_us) : 0.0);
+
+    if (sim_stats.protocol_errors) {
+        check(0, "SWD protocol errors seen by the model");
+    }
+}
+
+static void start(bench_t *bench)
+{
+    memset(bench, 0, sizeof(*bench));
+    connect();
+    memset(&sim_stats, 0, sizeof(sim_stats));
+}
+
+static void run_workloads(void)
+{
+    static uint8_t expect[BENCH_SIZE];
+    static uint8_t data[BENCH_SIZE];
+    bench_t bench;
+    uint32_t i;
+    uint32_t value;
+
+    printf("%-26s %6s %8s %10s %7s %9s %8s %8s\n", "workload", "pkts", "xfers",
+           "swclk", "clk/xf", "wire us", "ns/xf", "MB/s");
+
+    // Connecting must not tune, tuning only runs once the core is
+    // halted for programming
+    start(&bench);
+    fill_pattern(expect, 64, 0xC3);
+    memcpy(sim_memory(SIM_RAM_START, 64), expect, 64);
+    check(swd_init_debug(), "swd_init_debug without clock tune");
+    check((DAP_Data.fast_clock == 0) && (saved_count == 0), "clock not tuned on connect");
+    check(memcmp(sim_memory(SIM_RAM_START, 64), expect, 64) == 0, "RAM untouched on connect");
+
+    // The model never fails so tuning reaches the fast clock and keeps
+    // one step of margin below it. It must leave RAM as it was and only
+    // be saved once, when asked to.
+    bench.host_ns = now_ns();
+    swd_clock_tune_halted();
+    bench.host_ns = now_ns() - bench.host_ns;
+    check((DAP_Data.fast_clock == 0) && (DAP_Data.clock_delay == 1), "clock tuned one step below fast clock");
+    check(memcmp(sim_memory(SIM_RAM_START, 64), expect, 64) == 0, "RAM restored after clock tune");
+    check(saved_count == 0, "tuned clock not saved during connect");
+    swd_clock_save();
+    swd_clock_save();
+    check((saved_count == 1) && (saved_idcode == SIM_IDCODE), "tuned clock saved");
+    report("swd_host clock tune", &bench, 0);
+
+    start(&bench);
+    bench.host_ns = now_ns();
+    check(swd_init_debug(), "swd_init_debug with tuned clock");
+    bench.host_ns = now_ns() - bench.host_ns;
+    check((DAP_Data.fast_clock == 0) && (DAP_Data.clock_delay == 1) && (saved_count == 1),
+          "tuned clock reused");
+    report("swd_host tuned connect", &bench, 0);
+
+    start(&bench);
+    fill_pattern(expect, BENCH_SIZE, 0x5A);
+    memcpy(sim_memory(BENCH_ADDR, BENCH_SIZE), expect, BENCH_SIZE);
+    block_read(&bench, BENCH_ADDR, data, BENCH_SIZE);
+    check(memcmp(data, expect, BENCH_SIZE) == 0, "transfer block read data");
+    report("TransferBlock read 4KB", &bench, BENCH_SIZE);
+
+    start(&bench);
+    fill_pattern(expect, BENCH_SIZE, 0xA5);
+    block_write(&bench, BENCH_ADDR, expect, BENCH_SIZE);
+    check(memcmp(sim_memory(BENCH_ADDR, BENCH_SIZE), expect, BENCH_SIZE) == 0, "transfer block write data");
+    report("TransferBlock write 4KB", &bench, BENCH_SIZE);
+
+    start(&bench);
+    scattered_read(&bench, 256);
+    report("Transfer scattered x256", &bench, 0);
+
+    start(&bench);
+    sim_config.wait_every = sim_config.wait_every ? sim_config.wait_every : 5;
+    fill_pattern(expect, BENCH_SIZE, 0x3C);
+    memcpy(sim_memory(BENCH_ADDR, BENCH_SIZE), expect, BENCH_SIZE);
+    block_read(&bench, BENCH_ADDR, data, BENCH_SIZE);
+    check(memcmp(data, expect, BENCH_SIZE) == 0, "transfer block read data with WAIT");
+    report("TransferBlock read + WAIT", &bench, BENCH_SIZE);
+    sim_config.wait_every = 0;
+
+    start(&bench);
+    check(swd_init_debug(), "swd_init_debug");
+    fill_pattern(expect, BENCH_SIZE, 0x99);
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    bench.host_ns = now_ns();
+    check(swd_write_memory(BENCH_ADDR, expect, BENCH_SIZE), "swd_write_memory");
+    check(swd_read_memory(BENCH_ADDR, data, BENCH_SIZE), "swd_read_memory");
+    bench.host_ns = now_ns() - bench.host_ns;
+    check(memcmp(sim_memory(BENCH_ADDR, BENCH_SIZE), expect, BENCH_SIZE) == 0, "swd_write_memory data");
+    check(memcmp(data, expect, BENCH_SIZE) == 0, "swd_read_memory data");
+    report("swd_host write+read 4KB", &bench, 2 * BENCH_SIZE);
+
+    start(&bench);
+    check(swd_init_debug(), "swd_init_debug");
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    bench.host_ns = now_ns();
+    for (i = 0; i < 16; i++) {
+        check(swd_write_core_register(i, 0x1000 + i), "swd_write_core_register");
+    }
+    for (i = 0; i < 16; i++) {
+        check(swd_read_core_register(i, &value) && (value == 0x1000 + i), "swd_read_core_register");
+    }
+    bench.host_ns = now_ns() - bench.host_ns;
+    report("swd_host core regs x32", &bench, 0);
+}
+
+static int hex_line(const char *line, uint8_t *buf, uint32_t max)
+{
+    uint32_t len = 0;
+    unsigned int value;
+    int used;
+
+    while (sscanf(line, " %2x%n", &value, &used) == 1) {
+        if (len == max) {
+            return -1;
+        }
+        buf[len++] = (uint8_t)value;
+        line += used;
+    }
+
+    return len;
+}
+
+static void run_trace(const char *path)
+{
+    static uint8_t expect[DAP_PACKET_SIZE];
+    char line[4 * DAP_PACKET_SIZE];
+    uint32_t line_no = 0;
+    uint32_t resp_len = 0;
+    bench_t bench;
+    FILE *file;
+    int len;
+
+    file = fopen(path, "r");
+    if (file == NULL) {
+        perror(path);
+        exit(2);
+    }
+
+    memset(&bench, 0, sizeof(bench));
+    DAP_Setup();
+    memset(&sim_stats, 0, sizeof(sim_stats));
+
+    while (fgets(line, sizeof(line), file)) {
+        line_no++;
+        if (line[0] == '>') {
+            len = hex_line(line + 1, request, sizeof(request));
+            if (len <= 0) {
+                printf("%s:%u: bad request\n", path, line_no);
+                failures++;
+                continue;
+            }
+            resp_len = dap(&bench, len);
+        } else if (line[0] == '<') {
+            len = hex_line(line + 1, expect, sizeof(expect));
+            if ((len < 0) || ((uint32_t)len > resp_len) || memcmp(expect, response, len)) {
+                printf("%s:%u: response does not match\n", path, line_no);
+                failures++;
+            }
+        }
+    }
+
+    fclose(file);
+    printf("%-26s %6s %8s %10s %7s %9s %8s %8s\n", "trace", "pkts", "xfers",
+           "swclk", "clk/xf", "wire us", "ns/xf", "MB/s");
+    report(path, &bench, 0);
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-c") && (i + 1 < argc)) {
+            swj_clock = strtoul(argv[++i], NULL, 0);
+        } else if (!strcmp(argv[i], "-w") && (i + 1 < argc)) {
+            sim_config.wait_every = strtoul(argv[++i], NULL, 0);
+        } else if (argv[i][0] == '-') {
+            printf("usage: %s [-c swclk_hz] [-w wait_every] [trace_file]\n", argv[0]);
+            return 2;
+        } else {
+            run_trace(argv[i]);
+            return failures ? 1 : 0;
+        }
+    }
+
+    run_workloads();
+
+    if (failures) {
+        printf("%u checks failed\n", failures);
+        return 1;
+    }
+
+    return 0;
+}
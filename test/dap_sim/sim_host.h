@@ -0,0 +1,31 @@
+/**
+ * @file    sim_host.h
+ * @brief   Map the embedded compiler keywords used by the firmware to GCC
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SIM_HOST_H
+#define SIM_HOST_H
+
+#define __inline                inline
+#define __forceinline           inline __attribute__((always_inline))
+#define __weak                  __attribute__((weak))
+#define __task
+#define __nop()                 __asm__ volatile ("nop")
+
+#endif
@@ -0,0 +1,629 @@
+/**
+ * @file    sim_swd.c
+ * @brief   Cycle counting model of an ADIv5 SW-DP with a MEM-AP
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <string.h>
+
+#include "sim_swd.h"
+
+// The model samples SWDIO on the rising edge of SWCLK and drives its own
+// bits from the falling edge, which is how SW_DP.c clocks the wire.
+
+#define LINE_RESET_BITS     50
+#define TURNAROUND          1
+
+#define ACK_OK              0x1
+#define ACK_WAIT            0x2
+#define ACK_FAULT           0x4
+
+// DP CTRL/STAT bits
+#define CSYSPWRUPACK        (1UL << 31)
+#define CSYSPWRUPREQ        (1UL << 30)
+#define CDBGPWRUPACK        (1UL << 29)
+#define CDBGPWRUPREQ        (1UL << 28)
+#define CDBGRSTREQ          (1UL << 26)
+#define WDATAERR            (1UL << 7)
+#define STICKYERR           (1UL << 5)
+#define STICKYCMP           (1UL << 4)
+#define STICKYORUN          (1UL << 1)
+
+// DP ABORT bits
+#define ORUNERRCLR          (1UL << 4)
+#define WDERRCLR            (1UL << 3)
+#define STKERRCLR           (1UL << 2)
+#define STKCMPCLR           (1UL << 1)
+
+// MEM-AP registers
+#define AP_REG_CSW          0x00
+#define AP_REG_TAR          0x04
+#define AP_REG_DRW          0x0C
+#define AP_REG_BD0          0x10
+#define AP_REG_BASE         0xF8
+#define AP_REG_IDR          0xFC
+
+#define AP_IDR_AHB          0x04770031
+#define AP_BASE_ROM         0xE00FF003
+#define CSW_DEVICEEN        (1UL << 6)
+
+// Debug registers of the core
+#define SCS_START           0xE000E000
+#define SCS_SIZE            0x1000
+#define PPB_START           0xE0000000
+#define PPB_END             0xE0100000
+#define DHCSR               0xE000EDF0
+#define DCRSR               0xE000EDF4
+#define DCRDR               0xE000EDF8
+#define CPUID               0xE000ED00
+#define DBGKEY              0xA05F0000
+#define C_HALT              (1UL << 1)
+#define S_REGRDY            (1UL << 16)
+#define S_HALT              (1UL << 17)
+#define REGWnR              (1UL << 16)
+#define CORE_REG_COUNT      32
+
+typedef enum {
+    STATE_IDLE,
+    STATE_REQUEST,
+    STATE_TURN_TO_TARGET,
+    STATE_ACK,
+    STATE_READ_DATA,
+    STATE_TURN_TO_HOST,
+    STATE_WRITE_TURN,
+    STATE_WRITE_DATA,
+    STATE_LOCKOUT,
+} swd_state_t;
+
+sim_stats_t sim_stats;
+sim_config_t sim_config;
+
+static uint8_t flash[SIM_FLASH_SIZE];
+static uint8_t ram[SIM_RAM_SIZE];
+static uint8_t scs[SCS_SIZE];
+static uint32_t core_reg[CORE_REG_COUNT];
+
+// Pins
+static uint32_t swclk;
+static uint32_t swdio_host;
+static uint32_t swdio_host_oe;
+static uint32_t swdio_target;
+static uint32_t swdio_target_oe;
+static uint32_t nreset;
+
+// Wire protocol
+static swd_state_t state;
+static uint32_t bit_count;
+static uint32_t ones;
+static uint32_t request;
+static uint32_t ack;
+static uint32_t shift;
+static uint32_t ap_accesses;
+
+// Debug port and access port
+static uint32_t dp_ctrl_stat;
+static uint32_t dp_select;
+static uint32_t dp_rdbuff;
+static uint32_t ap_csw;
+static uint32_t ap_tar;
+static uint32_t core_halted;
+
+static uint32_t parity32(uint32_t value)
+{
+    value ^= value >> 16;
+    value ^= value >> 8;
+    value ^= value >> 4;
+    value ^= value >> 2;
+    value ^= value >> 1;
+    return value & 1;
+}
+
+uint8_t *sim_memory(uint32_t addr, uint32_t size)
+{
+    if ((addr >= SIM_FLASH_START) && (addr + size <= SIM_FLASH_START + SIM_FLASH_SIZE)) {
+        return &flash[addr - SIM_FLASH_START];
+    }
+
+    if ((addr >= SIM_RAM_START) && (addr + size <= SIM_RAM_START + SIM_RAM_SIZE)) {
+        return &ram[addr - SIM_RAM_START];
+    }
+
+    if ((addr >= SCS_START) && (addr + size <= SCS_START + SCS_SIZE)) {
+        return &scs[addr - SCS_START];
+    }
+
+    return NULL;
+}
+
+static uint32_t bus_read(uint32_t addr, uint32_t *value)
+{
+    uint8_t *mem;
+
+    addr &= ~3UL;
+
+    if (addr == DHCSR) {
+        *value = (scs[DHCSR - SCS_START] & 0xFF) | S_REGRDY | (core_halted ? S_HALT : 0);
+        return 1;
+    }
+
+    mem = sim_memory(addr, 4);
+    if (mem != NULL) {
+        memcpy(value, mem, 4);
+        return 1;
+    }
+
+    // Other system peripherals read as zero
+    if ((addr >= PPB_START) && (addr < PPB_END)) {
+        *value = 0;
+        return 1;
+    }
+
+    return 0;
+}
+
+static void scs_write(uint32_t addr, uint32_t value)
+{
+    uint32_t reg;
+
+    if (addr == DHCSR) {
+        if ((value & 0xFFFF0000) != DBGKEY) {
+            return;
+        }
+        core_halted = (value & C_HALT) ? 1 : 0;
+    } else if (addr == DCRSR) {
+        reg = value & (CORE_REG_COUNT - 1);
+        if (value & REGWnR) {
+            memcpy(&core_reg[reg], &scs[DCRDR - SCS_START], 4);
+        } else {
+            memcpy(&scs[DCRDR - SCS_START], &core_reg[reg], 4);
+        }
+    } else if (addr == CPUID) {
+        return;
+    }
+
+    memcpy(&scs[addr - SCS_START], &value, 4);
+}
+
+static uint32_t bus_write(uint32_t addr, uint32_t value, uint32_t size)
+{
+    uint32_t lane = addr & 3;
+    uint32_t bytes = 1UL << size;
+    uint8_t *mem;
+
+    if ((addr >= SCS_START) && (addr < SCS_START + SCS_SIZE)) {
+        scs_write(addr & ~3UL, value);
+        return 1;
+    }
+
+    if ((addr >= PPB_START) && (addr < PPB_END)) {
+        return 1;
+    }
+
+    // Flash only changes through a flash algorithm so writes are dropped
+    if ((addr >= SIM_FLASH_START) && (addr < SIM_FLASH_START + SIM_FLASH_SIZE)) {
+        return 1;
+    }
+
+    mem = sim_memory(addr, bytes);
+    if (mem == NULL) {
+        return 0;
+    }
+
+    value >>= lane * 8;
+    memcpy(mem, &value, bytes);
+    return 1;
+}
+
+static void tar_increment(void)
+{
+    uint32_t step = 1UL << (ap_csw & 7);
+
+    if (((ap_csw >> 4) & 3) == 0) {
+        return;
+    }
+
+    ap_tar = (ap_tar & ~(SIM_TAR_WRAP - 1UL)) | ((ap_tar + step) & (SIM_TAR_WRAP - 1UL));
+}
+
+static uint32_t ap_read(uint32_t reg)
+{
+    uint32_t value = 0;
+
+    if ((dp_select >> 24) != 0) {
+        return 0;
+    }
+
+    switch (reg) {
+        case AP_REG_CSW:
+            return ap_csw | CSW_DEVICEEN;
+
+        case AP_REG_TAR:
+            return ap_tar;
+
+        case AP_REG_DRW:
+            if (!bus_read(ap_tar, &value)) {
+                dp_ctrl_stat |= STICKYERR;
+            }
+            tar_increment();
+            return value;
+
+        case AP_REG_BASE:
+            return AP_BASE_ROM;
+
+        case AP_REG_IDR:
+            return AP_IDR_AHB;
+
+        default:
+            if ((reg >= AP_REG_BD0) && (reg < AP_REG_BD0 + 0x10)) {
+                if (!bus_read((ap_tar & ~0xFUL) + (reg - AP_REG_BD0), &value)) {
+                    dp_ctrl_stat |= STICKYERR;
+                }
+            }
+            return value;
+    }
+}
+
+static void ap_write(uint32_t reg, uint32_t value)
+{
+    if ((dp_select >> 24) != 0) {
+        return;
+    }
+
+    switch (reg) {
+        case AP_REG_CSW:
+            ap_csw = value & ~CSW_DEVICEEN;
+            break;
+
+        case AP_REG_TAR:
+            ap_tar = value;
+            sim_stats.tar_writes++;
+            break;
+
+        case AP_REG_DRW:
+            if (!bus_write(ap_tar, value, ap_csw & 7)) {
+                dp_ctrl_stat |= STICKYERR;
+            }
+            tar_increment();
+            break;
+
+        default:
+            if ((reg >= AP_REG_BD0) && (reg < AP_REG_BD0 + 0x10)) {
+                if (!bus_write((ap_tar & ~0xFUL) + (reg - AP_REG_BD0), value, 2)) {
+                    dp_ctrl_stat |= STICKYERR;
+                }
+            }
+            break;
+    }
+}
+
+static uint32_t dp_read(uint32_t addr)
+{
+    uint32_t value;
+
+    switch (addr) {
+        case 0x0:
+            return SIM_IDCODE;
+
+        case 0x4:
+            value = dp_ctrl_stat;
+            if (value & CDBGPWRUPREQ) {
+                value |= CDBGPWRUPACK;
+            }
+            if (value & CSYSPWRUPREQ) {
+                value |= CSYSPWRUPACK;
+            }
+            return value;
+
+        case 0x8:
+        case 0xC:
+        default:
+            return dp_rdbuff;
+    }
+}
+
+static void dp_write(uint32_t addr, uint32_t value)
+{
+    switch (addr) {
+        case 0x0:
+            if (value & STKCMPCLR) {
+                dp_ctrl_stat &= ~STICKYCMP;
+            }
+            if (value & STKERRCLR) {
+                dp_ctrl_stat &= ~STICKYERR;
+            }
+            if (value & WDERRCLR) {
+                dp_ctrl_stat &= ~WDATAERR;
+            }
+            if (value & ORUNERRCLR) {
+                dp_ctrl_stat &= ~STICKYORUN;
+            }
+            break;
+
+        case 0x4:
+            dp_ctrl_stat = (dp_ctrl_stat & (STICKYERR | STICKYCMP | WDATAERR | STICKYORUN)) |
+                           (value & (CSYSPWRUPREQ | CDBGPWRUPREQ | CDBGRSTREQ | 0x00FFFF0CUL));
+            break;
+
+        case 0x8:
+            dp_select = value;
+            break;
+
+        default:
+            break;
+    }
+}
+
+// Decide the acknowledge for a request and do the read side of it
+static void request_start(void)
+{
+    uint32_t apndp = (request >> 1) & 1;
+    uint32_t rnw = (request >> 2) & 1;
+    uint32_t addr = (request >> 1) & 0xC;
+    uint32_t reg = (dp_select & 0xF0) | addr;
+
+    sim_stats.transfers++;
+    ack = ACK_OK;
+
+    if (apndp) {
+        ap_accesses++;
+        if (sim_config.wait_every && ((ap_accesses % sim_config.wait_every) == 0)) {
+            ack = ACK_WAIT;
+        }
+    }
+
+    if ((ack == ACK_OK) && (dp_ctrl_stat & (STICKYERR | WDATAERR | STICKYORUN)) &&
+            (apndp || (rnw && (addr == 0xC)))) {
+        ack = ACK_FAULT;
+    }
+
+    switch (ack) {
+        case ACK_OK:
+            sim_stats.acks_ok++;
+            break;
+
+        case ACK_WAIT:
+            sim_stats.acks_wait++;
+            return;
+
+        default:
+            sim_stats.acks_fault++;
+            return;
+    }
+
+    if (rnw) {
+        if (apndp) {
+            // AP reads are posted, the result of the previous one is returned
+            shift = dp_rdbuff;
+            dp_rdbuff = ap_read(reg);
+        } else {
+            shift = dp_read(addr);
+        }
+    }
+}
+
+static void request_finish(uint32_t data)
+{
+    uint32_t apndp = (request >> 1) & 1;
+    uint32_t addr = (request >> 1) & 0xC;
+
+    if (apndp) {
+        ap_write((dp_select & 0xF0) | addr, data);
+    } else {
+        dp_write(addr, data);
+    }
+}
+
+static void swclk_falling(void)
+{
+    switch (state) {
+        case STATE_ACK:
+            swdio_target_oe = 1;
+            swdio_target = (ack >> bit_count) & 1;
+            break;
+
+        case STATE_READ_DATA:
+            swdio_target_oe = 1;
+            if (bit_count < 32) {
+                swdio_target = (shift >> bit_count) & 1;
+            } else {
+                swdio_target = parity32(shift);
+            }
+            break;
+
+        default:
+            swdio_target_oe = 0;
+            break;
+    }
+}
+
+static void swclk_rising(void)
+{
+    uint32_t bit = swdio_host_oe ? swdio_host : 1;
+
+    sim_stats.swclk_cycles++;
+
+    // At least 50 ones from the host reset the line in any state
+    if (swdio_host_oe && bit) {
+        if (++ones >= LINE_RESET_BITS) {
+            if (ones == LINE_RESET_BITS) {
+                sim_stats.line_resets++;
+            }
+            state = STATE_IDLE;
+            return;
+        }
+    } else {
+        ones = 0;
+    }
+
+    switch (state) {
+        case STATE_IDLE:
+            if (bit) {
+                state = STATE_REQUEST;
+                request = 1;
+                bit_count = 1;
+            }
+            break;
+
+        case STATE_REQUEST:
+            request |= bit << bit_count;
+            if (++bit_count < 8) {
+                break;
+            }
+            // Stop bit low, park bit high and even parity over APnDP..A3
+            if (((request & 0xC0) != 0x80) ||
+                    (parity32((request >> 1) & 0xF) != ((request >> 5) & 1))) {
+                state = STATE_LOCKOUT;
+                break;
+            }
+            request_start();
+            state = STATE_TURN_TO_TARGET;
+            bit_count = 0;
+            break;
+
+        case STATE_TURN_TO_TARGET:
+            if (++bit_count >= TURNAROUND) {
+                state = STATE_ACK;
+                bit_count = 0;
+            }
+            break;
+
+        case STATE_ACK:
+            if (++bit_count < 3) {
+                break;
+            }
+            bit_count = 0;
+            if (ack != ACK_OK) {
+                state = STATE_TURN_TO_HOST;
+            } else if ((request >> 2) & 1) {
+                state = STATE_READ_DATA;
+            } else {
+                state = STATE_WRITE_TURN;
+            }
+            break;
+
+        case STATE_READ_DATA:
+            if (++bit_count == 33) {
+                state = STATE_TURN_TO_HOST;
+                bit_count = 0;
+            }
+            break;
+
+        case STATE_TURN_TO_HOST:
+            if (++bit_count >= TURNAROUND) {
+                state = STATE_IDLE;
+            }
+            break;
+
+        case STATE_WRITE_TURN:
+            if (++bit_count >= TURNAROUND) {
+                state = STATE_WRITE_DATA;
+                bit_count = 0;
+                shift = 0;
+            }
+            break;
+
+        case STATE_WRITE_DATA:
+            if (bit_count < 32) {
+                shift |= bit << bit_count;
+            } else if (bit != parity32(shift)) {
+                sim_stats.protocol_errors++;
+                dp_ctrl_stat |= WDATAERR;
+            } else {
+                request_finish(shift);
+            }
+            if (++bit_count == 33) {
+                state = STATE_IDLE;
+            }
+            break;
+
+        case STATE_LOCKOUT:
+            break;
+    }
+}
+
+void sim_reset(void)
+{
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    memset(scs, 0, sizeof(scs));
+    memset(core_reg, 0, sizeof(core_reg));
+    memcpy(&scs[CPUID - SCS_START], &(uint32_t){0x410CC601}, 4);
+    swclk = 1;
+    swdio_host = 1;
+    swdio_host_oe = 0;
+    swdio_target_oe = 0;
+    nreset = 1;
+    state = STATE_LOCKOUT;
+    bit_count = 0;
+    ones = 0;
+    ap_accesses = 0;
+    dp_ctrl_stat = 0;
+    dp_select = 0;
+    dp_rdbuff = 0;
+    ap_csw = 0;
+    ap_tar = 0;
+    core_halted = 0;
+}
+
+void sim_swclk_write(uint32_t level)
+{
+    sim_stats.pin_writes++;
+
+    if (swclk && !level) {
+        swclk_falling();
+    } else if (!swclk && level) {
+        swclk_rising();
+    }
+
+    swclk = level;
+}
+
+uint32_t sim_swclk_read(void)
+{
+    return swclk;
+}
+
+void sim_swdio_write(uint32_t level)
+{
+    sim_stats.pin_writes++;
+    swdio_host = level & 1;
+}
+
+uint32_t sim_swdio_read(void)
+{
+    if (swdio_target_oe) {
+        return swdio_target;
+    }
+
+    return swdio_host_oe ? swdio_host : 1;
+}
+
+void sim_swdio_output(uint32_t enable)
+{
+    swdio_host_oe = enable;
+}
+
+void sim_nreset_write(uint32_t level)
+{
+    sim_stats.pin_writes++;
+    nreset = level & 1;
+}
+
+uint32_t sim_nreset_read(void)
+{
+    return nreset;
+}
@@ -0,0 +1,81 @@
+/**
+ * @file    sim_swd.h
+ * @brief   Cycle counting model of an ADIv5 SW-DP with a MEM-AP
+ *
+ * DAPLink Interface Firmware
+ * Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+ * SPDX-License-Identifier: Apache-2.0
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License"); you may
+ * not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ * http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef SIM_SWD_H
+#define SIM_SWD_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Memory map of the simulated target
+#define SIM_FLASH_START     0x00000000
+#define SIM_FLASH_SIZE      0x00020000
+#define SIM_RAM_START       0x20000000
+#define SIM_RAM_SIZE        0x00010000
+
+// MEM-AP address auto increment wraps within this block, which is the
+// smallest block ADIv5 allows, so a missing TAR re-issue is caught
+#define SIM_TAR_WRAP        0x400
+
+#define SIM_IDCODE          0x0BC11477
+
+typedef struct {
+    uint64_t swclk_cycles;      // SWCLK rising edges
+    uint64_t pin_writes;        // Writes to SWCLK, SWDIO or nRESET
+    uint32_t transfers;         // Packet requests seen by the SW-DP
+    uint32_t acks_ok;
+    uint32_t acks_wait;
+    uint32_t acks_fault;
+    uint32_t protocol_errors;   // Bad parity or malformed requests
+    uint32_t line_resets;
+    uint32_t tar_writes;
+} sim_stats_t;
+
+// Model behaviour that can be changed between runs
+typedef struct {
+    uint32_t wait_every;        // Answer every nth AP access with WAIT, 0 for never
+} sim_config_t;
+
+extern sim_stats_t sim_stats;
+extern sim_config_t sim_config;
+
+void sim_reset(void);
+
+// Pin layer used by the host DAP_config.h
+void sim_swclk_write(uint32_t level);
+uint32_t sim_swclk_read(void);
+void sim_swdio_write(uint32_t level);
+uint32_t sim_swdio_read(void);
+void sim_swdio_output(uint32_t enable);
+void sim_nreset_write(uint32_t level);
+uint32_t sim_nreset_read(void);
+
+// Direct access to target memory for checking results
+uint8_t *sim_memory(uint32_t addr, uint32_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,139 @@
+#
+# DAPLink Interface Firmware
+# Copyright (c) 2009-2016, ARM Limited, All Rights Reserved
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License"); you may
+# not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+# WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+"""Compress a binary image into the .lz format programmed by file_stream.c"""
+
+from __future__ import absolute_import
+
+import argparse
+import struct
+
+MAGIC = b'DLZS'
+FLAG_ADDR_VALID = 0x01
+# Candidates tried per position, more compresses better but slower
+MAX_CHAIN = 64
+
+
+def dec_or_hex(val):
+    return int(val, 0)
+
+
+class BitWriter(object):
+
+    def __init__(self):
+        self.data = bytearray()
+        self.value = 0
+        self.count = 0
+
+    def write(self, value, bits):
+        for bit in range(bits - 1, -1, -1):
+            self.value = (self.value << 1) | ((value >> bit) & 1)
+            self.count += 1
+            if self.count == 8:
+                self.data.append(self.value)
+                self.value = 0
+                self.count = 0
+
+    def flush(self):
+        if self.count:
+            self.data.append(self.value << (8 - self.count))
+            self.value = 0
+            self.count = 0
+        return bytes(self.data)
+
+
+def compress(data, window_bits, lookahead_bits):
+    window = 1 << window_bits
+    max_length = 1 << lookahead_bits
+    # A back reference has to be shorter than the literals it replaces
+    min_length = (1 + window_bits + lookahead_bits) // 9 + 1
+    chains = {}
+    out = BitWriter()
+    pos = 0
+
+    def insert(index):
+        key = bytes(data[index:index + 2])
+        chain = chains.setdefault(key, [])
+        chain.append(index)
+        if len(chain) > MAX_CHAIN:
+            del chain[0]
+
+    while pos < len(data):
+        best_length = 0
+        best_distance = 0
+        limit = min(max_length, len(data) - pos)
+        for start in reversed(chains.get(bytes(data[pos:pos + 2]), [])):
+            if pos - start > window:
+                break
+            length = 0
+            while length < limit and data[start + length] == data[pos + length]:
+                length += 1
+            if length > best_length:
+                best_length = length
+                best_distance = pos - start
+                if length == limit:
+                    break
+
+        if best_length >= min_length:
+            out.write(0, 1)
+            out.write(best_distance - 1, window_bits)
+            out.write(best_length - 1, lookahead_bits)
+        else:
+            best_length = 1
+            out.write(1, 1)
+            out.write(data[pos], 8)
+
+        for index in range(pos, pos + best_length):
+            insert(index)
+        pos += best_length
+
+    return out.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Image compressor')
+    parser.add_argument("bin", type=str, default=None,
+                        help="Input binary file")
+    parser.add_argument("--output", type=str, required=True,
+                        help="Output file, copy it to the drive with a .lz extension")
+    parser.add_argument("--address", type=dec_or_hex, default=None,
+                        help="Load address, taken from the vector table like a "
+                             ".bin file if not given")
+    parser.add_argument("--window", type=int, default=8,
+                        help="log2 of the window size, at most 8 for the "
+                             "default firmware build and 10 on the LPC4322 "
+                             "and SAM3U2C")
+    parser.add_argument("--lookahead", type=int, default=5,
+                        help="log2 of the longest match")
+    args = parser.parse_args()
+
+    assert 4 <= args.window <= 15
+    assert 3 <= args.lookahead < args.window
+    with open(args.bin, 'rb') as file_handle:
+        data = bytearray(file_handle.read())
+    assert len(data) > 0
+
+    flags = 0 if args.address is None else FLAG_ADDR_VALID
+    header = MAGIC + struct.pack('<BBBBII', args.window, args.lookahead, flags, 0,
+                                 args.address or 0, len(data))
+    with open(args.output, 'wb') as file_handle:
+        file_handle.write(header + compress(data, args.window, args.lookahead))
+
+
+if __name__ == "__main__":
+    main()
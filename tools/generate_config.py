@@ -28,8 +28,11 @@ CFG_KEY = 0x6b766c64
 # 8  - auto_rst
 # 8  - automation_allowed
 # 8  - overflow_detect
+# 4 x
+#   32 - swd_clock[].idcode
+#   32 - swd_clock[].clock
 # 0  - 'end' member omitted
-FORMAT = '<LHBBB'
+FORMAT = '<LHBBB8L'
 FORMAT_LENGTH = struct.calcsize(FORMAT)
 MINIMUM_ALIGN = 1 << 10  # 1k aligned
 
@@ -39,7 +42,8 @@ def create_hex(filename, addr, auto_rst, automation_allowed,
     file_format = 'hex'
     intel_hex = IntelHex()
     intel_hex.puts(addr, struct.pack(FORMAT, CFG_KEY, FORMAT_LENGTH, auto_rst,
-                                     automation_allowed, overflow_detect))
+                                     automation_allowed, overflow_detect,
+                                     *([0] * 8)))
     pad_addr = addr + FORMAT_LENGTH
     pad_byte_count = pad_size - (FORMAT_LENGTH % pad_size)
     pad_data = '\xFF' * pad_byte_count